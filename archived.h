@@ -1,4 +1,14 @@
-#include <forward_list>
+#ifndef ARCHIVED_H
+#define ARCHIVED_H
+
+#include "archived_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 /** @file */
 
 /**
@@ -19,406 +29,2143 @@ template< class Version >
   );
 
 /**
- @brief A class to keep track of an incrementally updated variable.
-
- # Overview
-
- The class archived<Value> keeps track of a variable of
- type Value that is incrementally upgraded.
+ @brief diff_to_current() compresses the whole path to the head:
+ every commit on the way gets the head as successor.
+ Pays off when versions on the path are queried again.
+*/
+class full_compression
+{
+};
 
- It is possible to retrieve intermediate versions,
- which later on allow a computation of the difference
- between that version and the current version.
+/**
+ @brief diff_to_current() lets every other commit on the path
+ skip its successor, writing half the path.
+*/
+class path_halving
+{
+};
 
+/**
+ @brief diff_to_current() lets every commit on the path
+ skip its successor.
+*/
+class path_splitting
+{
+};
 
- ## Versions:
+/**
+ @brief diff_to_current() only reads the path and writes nothing,
+ for versions that are queried once.
+ Garbage is then only released by compact().
+*/
+class no_compression
+{
+};
 
- An archived<> provides the concept of a version.
- A version is associated with the archived<> that created it.
- A version has a validity, it is either valid or invalid.
+/**
+ @brief diff_to_current() reads the path first. If another version
+ holds a commit on it, the path is shared and compressed fully.
+ Otherwise, only the queried commit gets the head as successor,
+ so a version queried once costs one write
+ and a version queried again finds the head right away.
+ Needs Policy::track_references.
+*/
+class adaptive_compression
+{
+};
 
- A version is only valid as long as the associated
- archived<> exists.
+/**
+ @brief increment_by() maintains skip links, so diff_to_current()
+ reads at most about 2 log2(n) commits and writes nothing,
+ n the number of increments since the last reset.
+
+ The commit of the n-th increment gets a link to the commit 2^j
+ increments later, for every j up to the trailing zero bits of n,
+ once that commit exists. An increment thus lets the commits
+ it completes skip their successors: at most log2(n) of them,
+ fewer than two on average. With Policy::track_references,
+ skipped commits no version refers to are released right away.
+
+ value() and compact() do not compress while the skip links are
+ maintained. clear_history() compresses fully and starts them anew.
+*/
+class deamortized_compression
+{
+};
 
- Valid versions can be used to compute the difference between 
- the value of the associated archived<> at creation time of the version
- and the current one.
+/**
+ @brief The default policy of archived<>.
 
- A version is valid when acquired via an archived<>, but can be invalidated
- by certain actions on the associated archived<>. 
+ A policy selects how an archived<> stores and walks its commits.
+ Derive from archived_defaults and hide the members to change.
 */
-template< class Value >
-class archived
+class archived_defaults
 {
  public:
-  class version;
+  typedef heap_pages pages; /**< @brief The source of the commit arena's
+                                 chunks, e.g. huge_pages. */
+
+  static const bool split_payload = false;
+    /**< @brief Whether diffs are kept apart from the commits,
+         see archived_payloads. */
+
+  static const std::size_t prefetch_distance = 16;
+    /**< @brief How many commits ahead archive_pool<> prefetches
+         when it folds a path, 0 disables prefetching. */
+
+  typedef full_compression compression;
+    /**< @brief How diff_to_current() compresses the path it walks,
+         e.g. path_halving, path_splitting, no_compression,
+         adaptive_compression or deamortized_compression. */
+
+  static const bool track_references = false;
+    /**< @brief Whether commits count the versions and commits
+         referring to them, so compact() and clear_history()
+         can release the commits no version reaches.
+         Versions then write to their commit when copied or destroyed,
+         and have to be destroyed before their archived<>. */
+
+  static const bool track_changes = false;
+    /**< @brief Whether an archive_pool<> records the commits
+         and archives it changes, as pool_checkpoint needs. */
+};
 
-  typedef Value value_type; /**< @brief The archived value's type. */
-  typedef version version_type; /**< @brief The type of versions provided. */
+/**
+ @internal @brief Where an archived<> keeps the diffs of its commits.
 
- private:
-  class commit;
+ With Split false, a commit holds its diff itself,
+ and a payload is the diff.
 
-  typedef commit commit_type; /**< @internal @brief Commit type. 
-                                   A commit is an atomic diff
-                                   and points to the successing commit. */
-  typedef std::forward_list< commit_type > storage_type;
-                              /**< @internal @brief The container for commits.
-                                   A forward list, because iterators shall
-                                   continue to be valid if a new commit
-                                   is added. */
-  typedef typename storage_type::iterator iterator_type;
-                            /**< @internal @brief Iterator type for storage. */
+ With Split true, diffs are kept in a chunk_arena<> of their own
+ and a payload points to the diff. Commits are then small and dense,
+ so following links, checking for the head and sweeping in compact()
+ do not load the cache lines of large diffs.
+ Diffs are only loaded when they are combined,
+ which costs a query of a compressed version one more cache miss.
+*/
+template< class Value , class Pages , bool Split >
+class archived_payloads
+{
+ public:
+  typedef Value payload_type; /**< @internal @brief Stored per commit. */
 
-  friend version_type; /**< @internal */
+  /**
+   @internal @brief Returns the payload of a new commit.
+  */
+  payload_type create();
 
-  mutable storage_type storage_; /**< @internal @brief Storage for commits. 
-                                  Should always begin with a head_commit.  */
-  version_type last_; /**< @internal @brief Version of the initial commit. */
-  
   /**
-   @internal @brief Modifies the commit referenced by old
-   to contain a diff to the current value.
-   The succesor of *old is set to the head_commit
+   @internal @brief Makes all diffs reusable.
   */
-  static void compute_diff_to_current
-  (
-    const iterator_type &
-     old /**< The old commit to be updated */
-  );
+  void clear();
 
   /**
-   @internal @brief Creates a commit with zero diff
-   that is its own successor and stores it at the beginnin of storage.
-  */ 
-  void create_head_commit();
+   @internal @brief Takes back the diffs of the last count commits.
+  */
+  void shrink
+  (
+    std::size_t
+     count /**< The number of commits. */
+  );
 
   /**
-   @internal @brief Checks whether an iterator references the head_commit
-   The head_commit can be recognized as being its own succesor.
-  */ 
-  static bool is_head_commit
+   @internal @brief Returns the diff of a payload.
+  */
+  static Value & diff
   (
-    const iterator_type &
-     iterator_to_commit /**< The iterator to the commit that is checked */
+    payload_type &
+     payload /**< The payload of a commit. */
   );
+};
 
-  friend value_type
-   diff_to_current<version_type>( const version_type & old );
-     /**< @internal */
+/**
+ @internal @brief Diffs kept apart from the commits.
+*/
+template< class Value , class Pages >
+class archived_payloads< Value , Pages , true >
+{
+ public:
+  typedef Value * payload_type; /**< @internal @brief Stored per commit. */
 
+ private:
+  chunk_arena< Value , Pages > diffs_; /**< @internal @brief The diffs. */
 
  public:
   /**
-   @brief Constructor that initializes the archived<> with initial_value.
-   After construction, the archived<>'s current value is initial_value.
+   @internal @brief Returns the payload of a new commit,
+   pointing to a zero diff.
   */
-  explicit archived
-  (
-    const value_type &
-     initial_value /**< The initial value. */
-  );
+  payload_type create();
 
-  archived( const archived< Value > & other ) = delete;
-  archived( archived< Value > && other ) = delete;
-  archived< Value > & operator= ( const archived< Value > & other ) = delete;
-  archived< Value > & operator= ( archived< Value > && other ) = delete;
+  /**
+   @internal @brief Makes all diffs reusable.
+  */
+  void clear();
 
   /**
-   @brief Increments the value by increment. 
-   Uses operator+= on the value.
-   Returns a new version.
+   @internal @brief Takes back the diffs of the last count commits.
+  */
+  void shrink
+  (
+    std::size_t
+     count /**< The number of commits. */
+  );
 
-   @return A new version.
+  /**
+   @internal @brief Returns the diff of a payload.
   */
-  version_type increment_by
+  static Value & diff
   (
-    const value_type &
-     increment /**< The value to increment by. */
+    payload_type &
+     payload /**< The payload of a commit. */
   );
+};
 
+/**
+ @internal @brief The skip links an archived<> maintains
+ on increment_by(), none unless Compression is
+ deamortized_compression.
+*/
+template< class Iterator , class Compression >
+class archived_skip_links
+{
+ public:
   /**
-   @brief Returns the current value.
+   @internal @brief Checks whether skip links are maintained,
+   which compression would undo.
+  */
+  bool active() const;
 
-   @return the current value.
+  /**
+   @internal @brief Forgets all skip links,
+   the next commit registered is the first.
   */
-  value_type value() const;
+  void clear();
+};
+
+/**
+ @internal @brief Skip links of deamortized_compression.
+ The commits whose links are still to be extended,
+ by the level of their next link.
+*/
+template< class Iterator >
+class archived_skip_links< Iterator , deamortized_compression >
+{
+  std::uint64_t head_index_; /**< @internal @brief The number of commits
+                                  registered, the index of the head. */
+  std::vector< Iterator > levels_; /**< @internal @brief By level j,
+                                        the last commit registered
+                                        whose index is a multiple of 2^j. */
 
+ public:
   /**
-   @brief Clears the stored history data.
-   Leaves current value unchanged.
-   All associated versions are invalidated.
-   Returns a new (valid) version.
+   @internal @brief Constructs an empty set of skip links.
+  */
+  archived_skip_links();
 
-   @return A new version.
+  /**
+   @internal @brief Checks whether skip links are maintained,
+   which compression would undo.
   */
-  version_type clear_history();
+  bool active() const;
 
   /**
-   @brief Clears the stored history data.
-   Sets current value to initial_value.
-   All associated versions are invalidated.
-   Returns a new (valid) version.
+   @internal @brief Forgets all skip links,
+   the next commit registered is the first.
+  */
+  void clear();
 
-   @return A new version.
+  /**
+   @internal @brief Registers the old head, right after
+   it got its successor.
+
+   @return The number of levels due, i.e. the commits whose
+   next link reaches the new head.
   */
-  version_type reset
+  std::size_t push
   (
-    const value_type &
-     initial_value /**< The new value. */
+    const Iterator &
+     old_head /**< The commit that was the head. */
   );
 
   /**
-   @brief Returns a new version.
-
-   @return A new version.
+   @internal @brief Returns the commit whose link of level j
+   is due. For j from 1 to push()'s result, in that order,
+   its successor links to the new head.
   */
-  version_type current() const;
+  const Iterator & level
+  (
+    std::size_t
+     j /**< The level. */
+  ) const;
 };
 
 /**
- @internal @brief A commit is an atomic diff.
- It contains an iterator to its successor and the value of the diff.
+ @internal @brief The reference count of a commit,
+ none unless Track. Without it, no commit is known to be garbage,
+ commits are only reused by reset().
 */
-template< class Value >
-class archived< Value >::commit
-  : public std::pair< archived< Value >::iterator_type , Value >
+template< bool Track >
+class archived_references
 {
-};
+ public:
+  class holder;
 
-/**
- @brief A version of an archived<>
+  /**
+   @internal @brief Prepares a new commit of generation,
+   without references.
+  */
+  void renew
+  (
+    std::uint32_t
+     generation /**< The generation of the archive. */
+  );
 
- An archived<> provides the concept of a version.
- A version is associated with the archived<> that created it.
- A version has a validity, it is either valid or invalid.
+  /**
+   @internal @brief Marks the commit as released.
+  */
+  void retire();
 
- A version is only valid as long as the associated
- archived<> exists.
+  /**
+   @internal @brief Checks whether the commit is released.
+  */
+  bool retired() const;
 
- Valid versions can be used to compute the difference between 
- the value of the associated archived<> at creation time of the version
- and the current one.
+  /**
+   @internal @brief Adds a reference.
+  */
+  void acquire();
 
- A version is valid when acquired via an archived<>, but can be invalidated
- by certain actions on the associated archived<>. 
+  /**
+   @internal @brief Drops a reference.
+
+   @return true, if that was the last one.
+  */
+  bool release();
+
+  /**
+   @internal @brief Checks whether the commit has no references.
+  */
+  bool garbage() const;
+};
+
+/**
+ @internal @brief The reference count of a commit,
+ and the generation of the archive that created it.
 */
-template< class Value >
-class archived< Value >::version
+template<>
+class archived_references< true >
 {
  public:
-  typedef Value value_type; /**< @brief The associated archived value's type. */
-  typedef archived< Value > archive_type; 
-                            /**< @brief The associated archived's type */
+  class holder;
 
  private:
-  typedef archive_type::iterator_type iterator_type;
-  
-  friend archived< Value >; /**< @internal */
-
-  iterator_type archive_iterator_; /**< @internal @brief Points to the
-                                        first commit after the version. */
-  
-  friend value_type
-   diff_to_current<version_type>( const version & old );
-    /**< @internal */
+  std::uint32_t references_; /**< @internal @brief Versions and commits
+                                  referring to the commit, and the archive
+                                  while it is the head. */
+  std::uint32_t generation_; /**< @internal @brief The generation of
+                                  the archive that created the commit,
+                                  0 while released. */
 
+ public:
   /**
-   @internal @brief A constructor initializing archive_iterator_
-   with archive_iterator.
+   @internal @brief Prepares a new commit of generation,
+   without references.
   */
-  explicit version
+  void renew
   (
-    const iterator_type &
-     archive_iterator /**< The initial archive_iterator_ */
+    std::uint32_t
+     generation /**< The generation of the archive. */
   );
 
- public:
   /**
-   @brief Default Constructor.
-   A default constructed version is not valid.
+   @internal @brief Marks the commit as released.
   */
-  version();
+  void retire();
 
   /**
-   @brief Default Copy Constructor
-   A copy constructed version has the same same
-   properties as the source.
+   @internal @brief Checks whether the commit is released.
   */
-  version
-  (
-    const version &
-     other /**< The source of the copy. */
-  ) = default;
+  bool retired() const;
 
   /**
-   @brief Default Move Constructor
-   A move constructed version has the same same
-   properties as the source.
+   @internal @brief Adds a reference.
   */
-  version
-  (
-    version &&
-     other /**< The source of the move. */
-  ) = default;
+  void acquire();
 
   /**
-   @brief Default Assignment operator
-   Copies from other.
-   An assigned version has the same same
-   properties as the source.
+   @internal @brief Drops a reference.
 
-   @return A reference to *this
+   @return true, if that was the last one.
   */
-  version & operator=
-  (
-    const version &
-     other /**< The source of the copy. */
-  ) = default;
-  
+  bool release();
+
   /**
-   @brief Default Move Assignment operator
-   Moves from other.
-   A move assigned version has the same same
-   properties as the source.
+   @internal @brief Checks whether the commit has no references.
+  */
+  bool garbage() const;
 
-   @return A reference to *this
+  /**
+   @internal @brief Checks whether more than one commit
+   or version refers to the commit.
   */
-  version & operator=
-  (
-    version &&
-     other /**< The source of the copy. */
-  ) = default;
+  bool shared() const;
 };
 
-
-
-/*
-  Implementation of archived<> class members
+/**
+ @internal @brief The reference a version holds to its commit,
+ nothing unless Track.
 */
+template< bool Track >
+class archived_references< Track >::holder
+{
+ public:
+  /**
+   @internal @brief Constructs a holder of no commit.
+  */
+  holder();
 
-template< class Value>
- void
-  archived< Value >::compute_diff_to_current
+  /**
+   @internal @brief Constructs a holder for commit.
+  */
+  explicit holder
   (
-    const typename archived< Value >::iterator_type &
-     old
-  )
-{
-  auto next = old->first;
-  if( ! is_head_commit( next ) )
+    const archived_references &
+     commit /**< The commit to hold. */
+  );
+
+  /**
+   @internal @brief Adds a reference to commit,
+   if it still belongs to the held generation.
+  */
+  void take
+  (
+    archived_references *
+     commit /**< The held commit, or null. */
+  ) const;
+
+  /**
+   @internal @brief Drops the reference to commit,
+   if it still belongs to the held generation.
+  */
+  void drop
+  (
+    archived_references *
+     commit /**< The held commit, or null. */
+  ) const;
+};
+
+/**
+ @internal @brief The reference a version holds to its commit,
+ valid while the commit belongs to the generation it was taken in.
+*/
+class archived_references< true >::holder
+{
+  std::uint32_t generation_; /**< @internal @brief The generation of
+                                  the commit when the version was taken. */
+
+ public:
+  /**
+   @internal @brief Constructs a holder of no commit.
+  */
+  holder();
+
+  /**
+   @internal @brief Constructs a holder for commit.
+  */
+  explicit holder
+  (
+    const archived_references &
+     commit /**< The commit to hold. */
+  );
+
+  /**
+   @internal @brief Adds a reference to commit,
+   if it still belongs to the held generation.
+  */
+  void take
+  (
+    archived_references *
+     commit /**< The held commit, or null. */
+  ) const;
+
+  /**
+   @internal @brief Drops the reference to commit,
+   if it still belongs to the held generation.
+  */
+  void drop
+  (
+    archived_references *
+     commit /**< The held commit, or null. */
+  ) const;
+};
+
+/**
+ @brief A class to keep track of an incrementally updated variable.
+
+ # Overview
+
+ The class archived<Value> keeps track of a variable of
+ type Value that is incrementally upgraded.
+
+ It is possible to retrieve intermediate versions,
+ which later on allow a computation of the difference
+ between that version and the current version.
+
+
+ ## Versions:
+
+ An archived<> provides the concept of a version.
+ A version is associated with the archived<> that created it.
+ A version has a validity, it is either valid or invalid.
+
+ A version is only valid as long as the associated
+ archived<> exists.
+
+ Valid versions can be used to compute the difference between 
+ the value of the associated archived<> at creation time of the version
+ and the current one.
+
+ A version is valid when acquired via an archived<>, but can be invalidated
+ by certain actions on the associated archived<>. 
+
+ If Policy::track_references, versions are reference counted
+ by the commit they point to, so a version, valid or not,
+ has to be destroyed before its archived<>.
+
+ An archived<> can be moved, e.g. to be stored in a std::vector<>.
+ Its commits stay in place, so its versions stay valid
+ and follow it to the new archived<>. An archived<> that is
+ move assigned to hands its own history to the source of the move,
+ so its outstanding versions can still be destroyed.
+
+
+ ## Storage:
+
+ Commits are kept in a chunk_arena<>, in the order they were created.
+ A commit's successor is created right after it, so an uncompressed
+ chain is a walk through adjacent memory, which hardware prefetchers
+ follow.
+
+ The walk is iterative, so histories of any length can be walked.
+ Policy::compression selects how much of the walked path
+ diff_to_current() compresses, see archived_defaults.
+ value() and compact() always compress fully.
+ Long histories are walked with fewer TLB misses if Policy::pages
+ is huge_pages.
+
+ If Policy::split_payload is true, the diffs are kept in an arena
+ of their own, and a commit is its links and metadata only,
+ see archived_payloads. That pays off for large Value types.
+
+ reset() rewinds the arena in O(1). The commits are kept and
+ overwritten by the next history, so an archive that is reset
+ periodically neither frees nor allocates commits once warm.
+ Unless they are trivially destructible, each new commit also destroys
+ the last commit kept beyond the new history, and its diff,
+ see chunk_arena. So diffs owning memory of a long history are
+ released once the new history has half as many commits, at the latest.
+
+ ## Compaction:
+
+ compact() compresses all commits toward the head.
+ It works in steps of bounded cost, so it can be spread over idle time,
+ see compactor.
+
+ If Policy::track_references, every commit counts the versions
+ and the commits referring to it. A commit that is neither
+ referred to nor the head can not be reached by any diff_to_current()
+ and is garbage. compact() then also returns garbage commits
+ to a free list, from which later commits are taken.
+ The step that completes a pass relinks the free list in storage
+ order, so later commits fill the front of the storage,
+ and takes back the free commits at its end. Chunks left empty
+ are returned to Policy::pages, except those allocated before
+ the last reset(), as versions of older generations may still
+ refer to them. That step visits every commit once more.
+ Without reference counts, commits are kept until reset().
+*/
+template< class Value , class Policy = archived_defaults >
+class archived
+{
+ public:
+  class version;
+
+  typedef Value value_type; /**< @brief The archived value's type. */
+  typedef version version_type; /**< @brief The type of versions provided. */
+
+ private:
+  class commit;
+
+  typedef commit commit_type; /**< @internal @brief Commit type. 
+                                   A commit is an atomic diff
+                                   and points to the successing commit. */
+  typedef chunk_arena< commit_type , typename Policy::pages > storage_type;
+                              /**< @internal @brief The container for commits.
+                                   An arena, because commits shall
+                                   stay in place if a new commit
+                                   is added. */
+  typedef commit_type * iterator_type;
+                            /**< @internal @brief Iterator type for storage. */
+  typedef archived_payloads< Value , typename Policy::pages ,
+                             Policy::split_payload > payloads_type;
+                            /**< @internal @brief The container for diffs. */
+  typedef archived_skip_links< iterator_type ,
+                               typename Policy::compression > links_type;
+                            /**< @internal @brief The skip links. */
+  typedef archived_references< Policy::track_references > references_type;
+                            /**< @internal @brief The reference count
+                                 of a commit. */
+
+  static_assert( Policy::track_references ||
+                 ! std::is_same< typename Policy::compression ,
+                                 adaptive_compression >::value ,
+                 "adaptive_compression needs Policy::track_references." );
+
+  friend version_type; /**< @internal */
+
+  mutable storage_type storage_; /**< @internal @brief Storage for commits. */
+  payloads_type payloads_; /**< @internal @brief Storage for diffs,
+                                empty unless Policy::split_payload. */
+  iterator_type head_; /**< @internal @brief The head_commit. */
+  iterator_type free_; /**< @internal @brief Released commits,
+                            linked through their successors. */
+  std::size_t commits_; /**< @internal @brief Commits not released. */
+  std::uint32_t generation_; /**< @internal @brief Counts resets,
+                                  stamped into commits and versions. */
+  bool changed_; /**< @internal @brief Whether there were increments
+                      since the last compaction pass started. */
+  bool sweeping_; /**< @internal @brief Whether a compaction pass
+                       is in progress. */
+  links_type links_; /**< @internal @brief Skip links maintained
+                          by increment_by(). */
+  std::size_t sweep_chunk_; /**< @internal @brief The chunk the pass is in. */
+  std::size_t sweep_offset_; /**< @internal @brief The commit the pass
+                                  is at, within sweep_chunk_. */
+  std::size_t pinned_chunks_; /**< @internal @brief The chunks allocated
+                                   at the last reset(), which versions
+                                   of older generations may refer to. */
+  version_type last_; /**< @internal @brief Version of the initial commit. */
+  
+  /**
+   @internal @brief Modifies the commit referenced by old
+   to contain a diff to the current value.
+   The succesor of *old is set to the head_commit,
+   and so are the successors of all commits on the way.
+   Calls release for commits on the way that lost
+   their last reference.
+   If Value::operator+= throws, the links of the commits not folded
+   yet are restored, so the history stays intact.
+
+   @return The number of commits modified.
+  */
+  template< class Release >
+  static std::size_t compress
+  (
+    const iterator_type &
+     old , /**< The old commit to be updated */
+    Release
+     release /**< Called with every commit that became garbage. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   compressing the path as Policy::compression says.
+   Garbage is left to compact().
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old /**< The old commit to be updated */
+  );
+
+  /**
+   @internal @brief Modifies the commit referenced by old
+   to contain a diff to the current value, see compress().
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit to be updated */
+    full_compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   letting every other commit on the way skip its successor.
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit. */
+    path_halving
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   letting every commit on the way skip its successor.
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit. */
+    path_splitting
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   without modifying any commit.
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit. */
+    no_compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   compressing the path fully if it is shared,
+   and else only old.
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit. */
+    adaptive_compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Computes the diff of old to the current value,
+   walking the skip links without modifying any commit.
+
+   @return The diff of old to the current value.
+  */
+  static value_type compute_diff_to_current
+  (
+    const iterator_type &
+     old , /**< The old commit. */
+    deamortized_compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Extends the skip links after an increment,
+   nothing unless Compression is deamortized_compression.
+  */
+  template< class Compression >
+  void link_head
+  (
+    const iterator_type &
+     old_head , /**< The commit that was the head. */
+    Compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Extends the skip links after an increment:
+   lets the commits whose next link reaches the head
+   skip their successors, and releases what became garbage.
+  */
+  void link_head
+  (
+    const iterator_type &
+     old_head , /**< The commit that was the head. */
+    deamortized_compression
+     strategy /**< Selects the strategy. */
+  );
+
+  /**
+   @internal @brief Lets the commit position skip its successor.
+   The diffs of both are combined.
+
+   @return true, if the successor lost its last reference.
+  */
+  static bool skip_successor
+  (
+    const iterator_type &
+     position /**< A commit whose successor is not the head. */
+  );
+
+  /**
+   @internal @brief Returns the diff of a commit.
+  */
+  static value_type & diff
+  (
+    const iterator_type &
+     position /**< The commit. */
+  );
+
+  /**
+   @internal @brief Takes a commit from the free list or storage.
+   It has zero diff, no references and is its own successor.
+  */
+  iterator_type create_commit();
+
+  /**
+   @internal @brief Returns a garbage commit to the free list,
+   and every successor that only it referred to.
+  */
+  void release_commit
+  (
+    iterator_type
+     garbage /**< The commit without references. */
+  );
+
+  /**
+   @internal @brief Relinks the free list in storage order,
+   so new commits are taken from the front of the storage,
+   and takes back the released commits at its end.
+   Chunks left empty are returned to Policy::pages,
+   unless versions of older generations may refer to them.
+  */
+  void trim();
+
+  /**
+   @internal @brief Creates a commit with zero diff
+   that is its own successor and makes it the head_commit.
+  */ 
+  void create_head_commit();
+
+  /**
+   @internal @brief Checks whether an iterator references the head_commit
+   The head_commit can be recognized as being its own succesor.
+  */ 
+  static bool is_head_commit
+  (
+    const iterator_type &
+     iterator_to_commit /**< The iterator to the commit that is checked */
+  );
+
+  friend value_type
+   diff_to_current<version_type>( const version_type & old );
+     /**< @internal */
+
+
+ public:
+  /**
+   @brief Constructor that initializes the archived<> with initial_value.
+   After construction, the archived<>'s current value is initial_value.
+  */
+  explicit archived
+  (
+    const value_type &
+     initial_value /**< The initial value. */
+  );
+
+  archived( const archived & other ) = delete;
+  archived & operator= ( const archived & other ) = delete;
+
+  /**
+   @brief Move Constructor.
+   Takes over the history of other, whose versions stay valid.
+   other may only be destroyed or assigned to afterwards.
+  */
+  archived
+  (
+    archived &&
+     other /**< The source of the move. */
+  ) noexcept;
+
+  /**
+   @brief Move Assignment operator.
+   Takes over the history of other, whose versions stay valid.
+   The own history is handed to other and released when other
+   is destroyed or assigned to, so the own versions
+   stay valid until then.
+   other may only be destroyed or assigned to afterwards.
+
+   @return A reference to *this
+  */
+  archived & operator=
+  (
+    archived &&
+     other /**< The source of the move. */
+  ) noexcept;
+
+  /**
+   @brief Increments the value by increment. 
+   Uses operator+= on the value.
+   Returns a new version.
+
+   @return A new version.
+  */
+  version_type increment_by
+  (
+    const value_type &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value.
+
+   @return the current value.
+  */
+  value_type value() const;
+
+  /**
+   @brief Clears the stored history data no version can reach.
+   Leaves current value unchanged.
+   If Policy::track_references, every commit held by a version
+   is compressed to a single diff to the current value,
+   all others are released, so the history shrinks to one commit
+   per live version. Associated versions stay valid.
+   Otherwise, the history is reset to the current value,
+   and all associated versions are invalidated.
+   Returns a new (valid) version.
+
+   @return A new version.
+  */
+  version_type clear_history();
+
+  /**
+   @brief Clears the stored history data.
+   Sets current value to initial_value.
+   All associated versions are invalidated.
+   Returns a new (valid) version.
+   Takes O(1), the commits are reused.
+
+   @return A new version.
+  */
+  version_type reset
+  (
+    const value_type &
+     initial_value /**< The new value. */
+  );
+
+  /**
+   @brief Returns a new version.
+
+   @return A new version.
+  */
+  version_type current() const;
+
+  /**
+   @brief Compacts the history by at most about budget commits.
+   A compaction pass visits every commit: it compresses them
+   toward the head, and releases garbage
+   if Policy::track_references. Then the last step of a pass
+   also returns the free end of the storage, see archived<>.
+   Repeated calls continue the pass, and start a new one
+   if there were increments since the last one started.
+   While skip links are maintained, see deamortized_compression,
+   a pass only releases garbage.
+   Versions stay valid.
+
+   @return true, if no compaction work is left.
+  */
+  bool compact
+  (
+    std::size_t
+     budget /**< The number of commits to visit and compress. */
+  );
+
+  /**
+   @brief Returns the number of stored commits.
+   Garbage counts until it is released by compact(),
+   without Policy::track_references until reset().
+
+   @return The number of commits.
+  */
+  std::size_t commits() const;
+};
+
+/**
+ @internal @brief A commit is an atomic diff.
+ It contains an iterator to its successor and the payload of the diff,
+ which is the diff unless Policy::split_payload,
+ and its reference count if Policy::track_references.
+*/
+template< class Value , class Policy >
+class archived< Value , Policy >::commit
+  : public std::pair< typename archived< Value , Policy >::iterator_type ,
+                      typename archived< Value , Policy >::payloads_type::
+                               payload_type > ,
+    public archived< Value , Policy >::references_type
+{
+};
+
+/**
+ @brief A version of an archived<>
+
+ An archived<> provides the concept of a version.
+ A version is associated with the archived<> that created it.
+ A version has a validity, it is either valid or invalid.
+
+ A version is only valid as long as the associated
+ archived<> exists.
+
+ Valid versions can be used to compute the difference between 
+ the value of the associated archived<> at creation time of the version
+ and the current one.
+
+ A version is valid when acquired via an archived<>, but can be invalidated
+ by certain actions on the associated archived<>. 
+*/
+template< class Value , class Policy >
+class archived< Value , Policy >::version
+  : private archived< Value , Policy >::references_type::holder
+{
+ public:
+  typedef Value value_type; /**< @brief The associated archived value's type. */
+  typedef archived< Value , Policy > archive_type; 
+                            /**< @brief The associated archived's type */
+
+ private:
+  typedef typename archive_type::iterator_type iterator_type;
+  typedef typename archive_type::references_type::holder holder_type;
+  
+  friend archived< Value , Policy >; /**< @internal */
+
+  iterator_type archive_iterator_; /**< @internal @brief Points to the
+                                        first commit after the version. */
+  
+  friend value_type
+   diff_to_current<version_type>( const version & old );
+    /**< @internal */
+
+  /**
+   @internal @brief A constructor initializing archive_iterator_
+   with archive_iterator, referring to it.
+  */
+  explicit version
+  (
+    const iterator_type &
+     archive_iterator /**< The initial archive_iterator_ */
+  );
+
+  /**
+   @internal @brief Adds a reference to the commit,
+   if it still belongs to the version's generation.
+   Nothing unless Policy::track_references.
+  */
+  void acquire() const;
+
+  /**
+   @internal @brief Drops the reference to the commit,
+   if it still belongs to the version's generation.
+   Nothing unless Policy::track_references.
+  */
+  void release() const;
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed version is not valid.
+  */
+  version();
+
+  /**
+   @brief Copy Constructor
+   A copy constructed version has the same same
+   properties as the source.
+  */
+  version
+  (
+    const version &
+     other /**< The source of the copy. */
+  );
+
+  /**
+   @brief Move Constructor
+   A move constructed version has the same same
+   properties as the source, which becomes invalid.
+  */
+  version
+  (
+    version &&
+     other /**< The source of the move. */
+  ) noexcept;
+
+  /**
+   @brief Assignment operator
+   Copies from other.
+   An assigned version has the same same
+   properties as the source.
+
+   @return A reference to *this
+  */
+  version & operator=
+  (
+    const version &
+     other /**< The source of the copy. */
+  );
+  
+  /**
+   @brief Move Assignment operator
+   Moves from other.
+   A move assigned version has the same same
+   properties as the source, which becomes invalid.
+
+   @return A reference to *this
+  */
+  version & operator=
+  (
+    version &&
+     other /**< The source of the copy. */
+  ) noexcept;
+
+  /**
+   @brief Destructor, drops the reference to the commit
+   if Policy::track_references.
+  */
+  ~version();
+};
+
+
+
+/*
+  Implementation of archived<> class members
+*/
+
+template< class Value , class Policy >
+template< class Release >
+ std::size_t
+  archived< Value , Policy >::compress
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    Release
+     release
+  )
+{
+  // Walk to the last commit before the head, reversing the links,
+  // so the path can be folded backwards without further memory.
+  iterator_type previous = nullptr;
+  iterator_type current = old;
+  while( ! is_head_commit( current->first ) )
+  {
+    const auto next = current->first;
+    current->first = previous;
+    previous = current;
+    current = next;
+  }
+
+  // Every commit on the way refers to the head instead of current.
+  const auto head = current->first;
+  std::size_t modified = 0;
+  while( previous )
+  {
+    const auto before = previous->first;
+    try
+    {
+      diff( previous ) += diff( current );
+    } catch( ... ) {
+      // Point the reversed commits to their successors again.
+      while( previous )
+      {
+        const auto reversed = previous->first;
+        previous->first = current;
+        current = previous;
+        previous = reversed;
+      }
+      throw;
+    }
+    previous->first = head;
+    head->acquire();
+    if( current->release() )
+    {
+      release( current );
+    }
+    current = previous;
+    previous = before;
+    ++modified;
+  }
+  return modified;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old
+  )
+{
+  return compute_diff_to_current( old , typename Policy::compression() );
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    full_compression
+     strategy
+  )
+{
+  compress( old , []( const iterator_type & ){} );
+  return diff( old );
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    path_halving
+     strategy
+  )
+{
+  value_type result = value_type();
+  for( auto current = old ; ! is_head_commit( current ) ; )
+  {
+    if( ! is_head_commit( current->first ) )
+    {
+      skip_successor( current );
+    }
+    result += diff( current );
+    current = current->first;
+  }
+  return result;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    path_splitting
+     strategy
+  )
+{
+  value_type result = value_type();
+  for( auto current = old ; ! is_head_commit( current ) ; )
+  {
+    const auto next = current->first;
+    result += diff( current );
+    if( ! is_head_commit( next ) )
+    {
+      skip_successor( current );
+    }
+    current = next;
+  }
+  return result;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    no_compression
+     strategy
+  )
+{
+  value_type result = value_type();
+  for( auto current = old ; ! is_head_commit( current ) ;
+       current = current->first )
+  {
+    result += diff( current );
+  }
+  return result;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    adaptive_compression
+     strategy
+  )
+{
+  // A commit referred to by more than its predecessor
+  // lies on the path of another version, too.
+  value_type result = value_type();
+  bool shared = false;
+  auto current = old;
+  for( ; ! is_head_commit( current ) ; current = current->first )
+  {
+    result += diff( current );
+    shared = shared || ( current != old && current->shared() );
+  }
+
+  if( shared )
+  {
+    return compute_diff_to_current( old , full_compression() );
+  }
+  const auto next = old->first;
+  if( next != current && next != old )
+  {
+    diff( old ) = result;
+    old->first = current;
+    current->acquire();
+    next->release();
+  }
+  return result;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::compute_diff_to_current
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old ,
+    deamortized_compression
+     strategy
+  )
+{
+  return compute_diff_to_current( old , no_compression() );
+}
+
+template< class Value , class Policy >
+template< class Compression >
+ void
+  archived< Value , Policy >::link_head
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old_head ,
+    Compression
+     strategy
+  )
+{
+}
+
+template< class Value , class Policy >
+ void
+  archived< Value , Policy >::link_head
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     old_head ,
+    deamortized_compression
+     strategy
+  )
+{
+  // Level j - 1 was extended just before, so the successor of
+  // the commit at level j already links to the head.
+  const auto due = links_.push( old_head );
+  for( std::size_t j = 1 ; j <= due ; ++j )
+  {
+    const auto position = links_.level( j );
+    const auto next = position->first;
+    if( skip_successor( position ) )
+    {
+      release_commit( next );
+    }
+  }
+}
+
+template< class Value , class Policy >
+ bool
+  archived< Value , Policy >::skip_successor
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     position
+  )
+{
+  // A successor losing its last reference is garbage for compact(),
+  // it still refers to its own successor.
+  const auto next = position->first;
+  diff( position ) += diff( next );
+  position->first = next->first;
+  next->first->acquire();
+  return next->release();
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type &
+  archived< Value , Policy >::diff
+  (
+    const typename archived< Value , Policy >::iterator_type &
+     position
+  )
+{
+  return payloads_type::diff( position->second );
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::iterator_type
+  archived< Value , Policy >::create_commit()
+{
+  iterator_type result = free_;
+  if( result )
+  {
+    free_ = result->first;
+  } else {
+    result = storage_.create(); // Value initialization of commit :
+                                // an inline diff is properly initialized.
+    result->second = payloads_.create();
+  }
+  result->first = result;
+  result->renew( generation_ );
+  ++commits_;
+  return result;
+}
+
+template< class Value , class Policy >
+ void
+  archived< Value , Policy >::release_commit
+  (
+    iterator_type
+     garbage
+  )
+{
+  for( ;; )
+  {
+    const auto next = garbage->first;
+    diff( garbage ) = Value(); // Frees what the diff holds.
+    garbage->retire();
+    garbage->first = free_;
+    free_ = garbage;
+    --commits_;
+
+    if( next == garbage || ! next->release() )
+    {
+      return;
+    }
+    garbage = next;
+  }
+}
+
+template< class Value , class Policy >
+ void
+  archived< Value , Policy >::trim()
+{
+  // Walk the storage backwards: released commits at its end
+  // are taken back, the others are linked lowest first.
+  iterator_type free = nullptr;
+  std::size_t tail = 0;
+  bool at_end = true;
+  for( auto chunk = storage_.chunks() ; chunk-- != 0 ; )
   {
-    compute_diff_to_current( next );
-    old->second += next->second;
-    old->first = next->first;
+    const auto first = storage_.begin( chunk );
+    for( auto position = storage_.end( chunk ) ; position-- != first ; )
+    {
+      if( ! position->retired() )
+      {
+        at_end = false;
+      } else if( at_end ) {
+        ++tail;
+      } else {
+        position->first = free;
+        free = position;
+      }
+    }
   }
+  free_ = free;
+  storage_.shrink( tail , pinned_chunks_ );
+  payloads_.shrink( tail );
 }
 
-template< class Value >
+template< class Value , class Policy >
  void
-  archived< Value >::create_head_commit() 
+  archived< Value , Policy >::create_head_commit() 
 {
-  commit_type head; // Value initialization of std::pair :
-                    // head.second is properly initialized.
-  storage_.push_front( head );
-  storage_.front().first = storage_.begin();
+  head_ = create_commit();
+  head_->acquire();
 }
 
-template< class Value >
+template< class Value , class Policy >
  bool
-  archived< Value >::is_head_commit
+  archived< Value , Policy >::is_head_commit
   (
-    const typename archived< Value >::iterator_type &
+    const typename archived< Value , Policy >::iterator_type &
      iterator_to_commit
   )
 {
   return ( iterator_to_commit->first == iterator_to_commit );
 }
 
-template< class Value >
-  archived< Value >::archived
+template< class Value , class Policy >
+  archived< Value , Policy >::archived
   (
     const value_type &
      initial_value
   )
   : storage_() ,
+    payloads_() ,
+    head_() ,
+    free_() ,
+    commits_( 0 ) ,
+    generation_( 0 ) ,
+    changed_( false ) ,
+    sweeping_( false ) ,
+    links_() ,
+    sweep_chunk_( 0 ) ,
+    sweep_offset_( 0 ) ,
+    pinned_chunks_( 0 ) ,
     last_()
 {
   reset( initial_value );
 }
 
-template< class Value>
- typename archived< Value >::version_type
-  archived< Value >::increment_by
+template< class Value , class Policy >
+  archived< Value , Policy >::archived
+  (
+    archived &&
+     other
+  ) noexcept
+  : storage_( std::move( other.storage_ ) ) ,
+    payloads_( std::move( other.payloads_ ) ) ,
+    head_( other.head_ ) ,
+    free_( other.free_ ) ,
+    commits_( other.commits_ ) ,
+    generation_( other.generation_ ) ,
+    changed_( other.changed_ ) ,
+    sweeping_( other.sweeping_ ) ,
+    links_( std::move( other.links_ ) ) ,
+    sweep_chunk_( other.sweep_chunk_ ) ,
+    sweep_offset_( other.sweep_offset_ ) ,
+    pinned_chunks_( other.pinned_chunks_ ) ,
+    last_( std::move( other.last_ ) )
+{
+  other.head_ = nullptr;
+  other.free_ = nullptr;
+  other.commits_ = 0;
+  other.sweeping_ = false;
+}
+
+template< class Value , class Policy >
+ archived< Value , Policy > &
+  archived< Value , Policy >::operator=
+  (
+    archived &&
+     other
+  ) noexcept
+{
+  if( this != &other )
+  {
+    // Outstanding versions of the own history may still drop their
+    // references, so the history is swapped, not released.
+    std::swap( storage_ , other.storage_ );
+    std::swap( payloads_ , other.payloads_ );
+    std::swap( head_ , other.head_ );
+    std::swap( free_ , other.free_ );
+    std::swap( commits_ , other.commits_ );
+    std::swap( generation_ , other.generation_ );
+    std::swap( changed_ , other.changed_ );
+    std::swap( sweeping_ , other.sweeping_ );
+    std::swap( links_ , other.links_ );
+    std::swap( sweep_chunk_ , other.sweep_chunk_ );
+    std::swap( sweep_offset_ , other.sweep_offset_ );
+    std::swap( pinned_chunks_ , other.pinned_chunks_ );
+    std::swap( last_ , other.last_ );
+  }
+  return *this;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version_type
+  archived< Value , Policy >::increment_by
   ( 
-    const typename archived< Value >::value_type &
+    const typename archived< Value , Policy >::value_type &
      increment
   )
 {
-  const auto old_head = storage_.begin();
-  old_head->second = increment;
+  const auto old_head = head_;
+  diff( old_head ) = increment;
   create_head_commit();
 
-  const auto new_head = storage_.begin();
-  old_head->first = new_head;
-  return version_type( new_head );
+  old_head->first = head_;
+  head_->acquire();
+  changed_ = true;
+  if( old_head->release() )
+  {
+    release_commit( old_head );
+  }
+  link_head( old_head , typename Policy::compression() );
+  return version_type( head_ );
 }
 
-template< class Value >
- typename archived< Value >::value_type
-  archived< Value >::value() const
+template< class Value , class Policy >
+ typename archived< Value , Policy >::value_type
+  archived< Value , Policy >::value() const
 {
-  return diff_to_current( last_ );
+  // The initial commit is queried by every value(), so compress fully,
+  // unless that would undo the skip links.
+  if( links_.active() )
+  {
+    return compute_diff_to_current( last_.archive_iterator_ ,
+                                    deamortized_compression() );
+  }
+  return compute_diff_to_current( last_.archive_iterator_ ,
+                                  full_compression() );
 }
 
-template< class Value >
- typename archived< Value >::version_type
-  archived< Value >::clear_history()
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version_type
+  archived< Value , Policy >::clear_history()
 {
-  const auto current_value = value();
-  reset( value() );
+  if( ! Policy::track_references )
+  {
+    // The commits versions hold can not be told apart.
+    return reset( value() );
+  }
+
+  // A complete pass, even without increments since the last one.
+  // It compresses fully, so the skip links start anew.
+  links_.clear();
+  sweeping_ = false;
+  changed_ = true;
+  while( ! compact( std::numeric_limits< std::size_t >::max() ) )
+  {
+  }
+  return current();
 }
 
-template< class Value >
- typename archived< Value >::version_type
-  archived< Value >::reset
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version_type
+  archived< Value , Policy >::reset
   (
-    const typename archived< Value>::value_type &
+    const typename archived< Value , Policy >::value_type &
      initial_value
   )
 {
+ // Commits of older generations are ignored by their versions,
+ // so storage can be reused right away.
+ last_ = version_type();
+ pinned_chunks_ = storage_.allocated();
  storage_.clear();
+ payloads_.clear();
+ free_ = nullptr;
+ commits_ = 0;
+ links_.clear();
+ if( ++generation_ == 0 )
+ {
+   ++generation_;
+ }
+ sweeping_ = false;
+
  create_head_commit();
- last_ = version_type( storage_.begin() );
+ last_ = version_type( head_ );
 
  return increment_by( initial_value );
 }
 
-template< class Value >
- typename archived< Value >::version_type
-  archived< Value >::current() const
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version_type
+  archived< Value , Policy >::current() const
+{
+  return version_type( head_ );
+}
+
+template< class Value , class Policy >
+ bool
+  archived< Value , Policy >::compact
+  (
+    std::size_t
+     budget
+  )
+{
+  if( ! sweeping_ )
+  {
+    if( ! changed_ )
+    {
+      return true;
+    }
+    sweeping_ = true;
+    changed_ = false;
+    sweep_chunk_ = 0;
+    sweep_offset_ = 0;
+  }
+
+  const auto release = [ this ]( const iterator_type & garbage )
+  {
+    release_commit( garbage );
+  };
+
+  std::size_t work = 0;
+  while( work < budget )
+  {
+    if( sweep_chunk_ == storage_.chunks() )
+    {
+      sweeping_ = false;
+      if( Policy::track_references )
+      {
+        trim();
+      }
+      return ! changed_;
+    }
+    const auto position = storage_.begin( sweep_chunk_ ) + sweep_offset_;
+    if( position == storage_.end( sweep_chunk_ ) )
+    {
+      ++sweep_chunk_;
+      sweep_offset_ = 0;
+      continue;
+    }
+    ++sweep_offset_;
+    ++work;
+
+    if( position->retired() || position == head_ )
+    {
+      continue;
+    }
+    if( position->garbage() )
+    {
+      release_commit( position );
+    } else if( ! links_.active() ) {
+      work += compress( position , release );
+    }
+  }
+  return false;
+}
+
+template< class Value , class Policy >
+ std::size_t
+  archived< Value , Policy >::commits() const
 {
-  return version_type( storage_.begin() );
+  return commits_;
 }
 
 /*
   Implementation of archived<>::version class members
 */
 
-template< class Value>
-  archived< Value >::version::version
+template< class Value , class Policy >
+  archived< Value , Policy >::version::version
   ( 
     const iterator_type &
      archive_iterator
   )
-  : archive_iterator_( archive_iterator )
+  : holder_type( *archive_iterator ) ,
+    archive_iterator_( archive_iterator )
+{
+  acquire();
+}
+
+template< class Value , class Policy >
+  archived< Value , Policy >::version::version()
+  : holder_type() ,
+    archive_iterator_()
+{
+}
+
+template< class Value , class Policy >
+  archived< Value , Policy >::version::version
+  (
+    const version &
+     other
+  )
+  : holder_type( other ) ,
+    archive_iterator_( other.archive_iterator_ )
+{
+  acquire();
+}
+
+template< class Value , class Policy >
+  archived< Value , Policy >::version::version
+  (
+    version &&
+     other
+  ) noexcept
+  : holder_type( other ) ,
+    archive_iterator_( other.archive_iterator_ )
+{
+  other.archive_iterator_ = nullptr;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version &
+  archived< Value , Policy >::version::operator=
+  (
+    const version &
+     other
+  )
+{
+  other.acquire();
+  release();
+  holder_type::operator=( other );
+  archive_iterator_ = other.archive_iterator_;
+  return *this;
+}
+
+template< class Value , class Policy >
+ typename archived< Value , Policy >::version &
+  archived< Value , Policy >::version::operator=
+  (
+    version &&
+     other
+  ) noexcept
+{
+  if( this != &other )
+  {
+    release();
+    holder_type::operator=( other );
+    archive_iterator_ = other.archive_iterator_;
+    other.archive_iterator_ = nullptr;
+  }
+  return *this;
+}
+
+template< class Value , class Policy >
+  archived< Value , Policy >::version::~version()
+{
+  release();
+}
+
+template< class Value , class Policy >
+ void
+  archived< Value , Policy >::version::acquire() const
+{
+  holder_type::take( archive_iterator_ );
+}
+
+template< class Value , class Policy >
+ void
+  archived< Value , Policy >::version::release() const
+{
+  holder_type::drop( archive_iterator_ );
+}
+
+/*
+  Implementation of archived_payloads<> class members
+*/
+
+template< class Value , class Pages , bool Split >
+ typename archived_payloads< Value , Pages , Split >::payload_type
+  archived_payloads< Value , Pages , Split >::create()
+{
+  return Value();
+}
+
+template< class Value , class Pages , bool Split >
+ void
+  archived_payloads< Value , Pages , Split >::clear()
+{
+}
+
+template< class Value , class Pages , bool Split >
+ void
+  archived_payloads< Value , Pages , Split >::shrink
+  (
+    std::size_t
+     count
+  )
+{
+}
+
+template< class Value , class Pages , bool Split >
+ Value &
+  archived_payloads< Value , Pages , Split >::diff
+  (
+    payload_type &
+     payload
+  )
+{
+  return payload;
+}
+
+template< class Value , class Pages >
+ typename archived_payloads< Value , Pages , true >::payload_type
+  archived_payloads< Value , Pages , true >::create()
+{
+  return diffs_.create();
+}
+
+template< class Value , class Pages >
+ void
+  archived_payloads< Value , Pages , true >::clear()
+{
+  diffs_.clear();
+}
+
+template< class Value , class Pages >
+ void
+  archived_payloads< Value , Pages , true >::shrink
+  (
+    std::size_t
+     count
+  )
+{
+  diffs_.shrink( count );
+}
+
+template< class Value , class Pages >
+ Value &
+  archived_payloads< Value , Pages , true >::diff
+  (
+    payload_type &
+     payload
+  )
+{
+  return *payload;
+}
+
+/*
+  Implementation of archived_skip_links<> class members
+*/
+
+template< class Iterator , class Compression >
+ bool
+  archived_skip_links< Iterator , Compression >::active() const
+{
+  return false;
+}
+
+template< class Iterator , class Compression >
+ void
+  archived_skip_links< Iterator , Compression >::clear()
+{
+}
+
+template< class Iterator >
+  archived_skip_links< Iterator , deamortized_compression >::
+   archived_skip_links()
+  : head_index_( 0 ) ,
+    levels_()
+{
+}
+
+template< class Iterator >
+ bool
+  archived_skip_links< Iterator , deamortized_compression >::active() const
+{
+  return head_index_ != 0;
+}
+
+template< class Iterator >
+ void
+  archived_skip_links< Iterator , deamortized_compression >::clear()
+{
+  head_index_ = 0;
+}
+
+template< class Iterator >
+ std::size_t
+  archived_skip_links< Iterator , deamortized_compression >::push
+  (
+    const Iterator &
+     old_head
+  )
+{
+  // The first commit is a multiple of every power of two.
+  const auto index = head_index_++;
+  if( index == 0 )
+  {
+    levels_.assign( std::numeric_limits< std::uint64_t >::digits + 1 ,
+                    old_head );
+  } else {
+    levels_[ 0 ] = old_head;
+    for( std::size_t j = 1 ; ( ( index >> ( j - 1 ) ) & 1 ) == 0 ; ++j )
+    {
+      levels_[ j ] = old_head;
+    }
+  }
+
+  // The commits 2^j before the head, j up to its trailing zero bits.
+  std::size_t due = 0;
+  while( ( ( head_index_ >> due ) & 1 ) == 0 )
+  {
+    ++due;
+  }
+  return due;
+}
+
+template< class Iterator >
+ const Iterator &
+  archived_skip_links< Iterator , deamortized_compression >::level
+  (
+    std::size_t
+     j
+  ) const
+{
+  return levels_[ j ];
+}
+
+/*
+  Implementation of archived_references<> class members
+*/
+
+template< bool Track >
+ void
+  archived_references< Track >::renew
+  (
+    std::uint32_t
+     generation
+  )
+{
+}
+
+template< bool Track >
+ void
+  archived_references< Track >::retire()
+{
+}
+
+template< bool Track >
+ bool
+  archived_references< Track >::retired() const
+{
+  return false;
+}
+
+template< bool Track >
+ void
+  archived_references< Track >::acquire()
+{
+}
+
+template< bool Track >
+ bool
+  archived_references< Track >::release()
+{
+  return false;
+}
+
+template< bool Track >
+ bool
+  archived_references< Track >::garbage() const
+{
+  return false;
+}
+
+inline
+ void
+  archived_references< true >::renew
+  (
+    std::uint32_t
+     generation
+  )
+{
+  references_ = 0;
+  generation_ = generation;
+}
+
+inline
+ void
+  archived_references< true >::retire()
+{
+  generation_ = 0;
+}
+
+inline
+ bool
+  archived_references< true >::retired() const
+{
+  return generation_ == 0;
+}
+
+inline
+ void
+  archived_references< true >::acquire()
+{
+  ++references_;
+}
+
+inline
+ bool
+  archived_references< true >::release()
+{
+  return --references_ == 0;
+}
+
+inline
+ bool
+  archived_references< true >::garbage() const
+{
+  return references_ == 0;
+}
+
+inline
+ bool
+  archived_references< true >::shared() const
+{
+  return references_ > 1;
+}
+
+/*
+  Implementation of archived_references<>::holder class members
+*/
+
+template< bool Track >
+  archived_references< Track >::holder::holder()
+{
+}
+
+template< bool Track >
+  archived_references< Track >::holder::holder
+  (
+    const archived_references &
+     commit
+  )
+{
+}
+
+template< bool Track >
+ void
+  archived_references< Track >::holder::take
+  (
+    archived_references *
+     commit
+  ) const
+{
+}
+
+template< bool Track >
+ void
+  archived_references< Track >::holder::drop
+  (
+    archived_references *
+     commit
+  ) const
+{
+}
+
+inline
+  archived_references< true >::holder::holder()
+  : generation_()
+{
+}
+
+inline
+  archived_references< true >::holder::holder
+  (
+    const archived_references &
+     commit
+  )
+  : generation_( commit.generation_ )
+{
+}
+
+inline
+ void
+  archived_references< true >::holder::take
+  (
+    archived_references *
+     commit
+  ) const
 {
+  if( commit && commit->generation_ == generation_ )
+  {
+    ++commit->references_;
+  }
 }
 
-template< class Value>
-  archived< Value>::version::version()
-  : archive_iterator_()
+inline
+ void
+  archived_references< true >::holder::drop
+  (
+    archived_references *
+     commit
+  ) const
 {
+  if( commit && commit->generation_ == generation_ )
+  {
+    --commit->references_;
+  }
 }
 
 /*
@@ -433,9 +2180,7 @@ template< class Version >
      old
   )
 {
-  const auto archive_iterator = old.archive_iterator_;
-
-  Version::archive_type::compute_diff_to_current( old.archive_iterator_ );
-  return archive_iterator->second;
+  return Version::archive_type::compute_diff_to_current( old.archive_iterator_ );
 }
 
+#endif
@@ -0,0 +1,702 @@
+#ifndef ARCHIVED_ARENA_H
+#define ARCHIVED_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined( __linux__ )
+#include <sys/mman.h>
+#endif
+/** @file */
+
+/**
+ @brief Provides the memory of arena chunks from the free store.
+*/
+class heap_pages
+{
+ public:
+  static const std::size_t min_chunk_bytes = 64;
+                            /**< @brief The size of the first chunk,
+                                 small so an idle archive stays small. */
+  static const std::size_t max_chunk_bytes = std::size_t( 1 ) << 20;
+                            /**< @brief The size chunks grow to. */
+
+  /**
+   @brief Allocates bytes of memory, suitably aligned for any object.
+
+   @return The memory.
+  */
+  static void * allocate
+  (
+    std::size_t
+     bytes /**< The size of the chunk. */
+  );
+
+  /**
+   @brief Releases memory returned by allocate().
+  */
+  static void deallocate
+  (
+    void *
+     memory , /**< The memory. */
+    std::size_t
+     bytes /**< The size passed to allocate(). */
+  );
+};
+
+/**
+ @brief Provides the memory of arena chunks in huge pages where possible.
+
+ Chunks are multiples of 2 MiB, mapped with MAP_HUGETLB from the
+ reserved huge pages. If none are reserved, the mapping is aligned to
+ 2 MiB and advised with MADV_HUGEPAGE, so transparent huge pages
+ can back it. If neither is available, chunks are normal pages.
+
+ A walk through a history in huge pages takes one TLB entry
+ per 2 MiB instead of one per 4 KiB.
+ Mind that even the smallest arena takes a whole chunk.
+*/
+class huge_pages
+{
+ public:
+  static const std::size_t huge_page_bytes = std::size_t( 1 ) << 21;
+                            /**< @brief The size of a huge page. */
+  static const std::size_t min_chunk_bytes = huge_page_bytes;
+                            /**< @brief The size of the first chunk. */
+  static const std::size_t max_chunk_bytes = huge_page_bytes << 5;
+                            /**< @brief The size chunks grow to. */
+
+  /**
+   @brief Maps bytes of memory, a multiple of huge_page_bytes.
+   Throws std::bad_alloc if no memory can be mapped.
+
+   @return The memory, aligned to huge_page_bytes.
+  */
+  static void * allocate
+  (
+    std::size_t
+     bytes /**< The size of the chunk. */
+  );
+
+  /**
+   @brief Unmaps memory returned by allocate().
+  */
+  static void deallocate
+  (
+    void *
+     memory , /**< The memory. */
+    std::size_t
+     bytes /**< The size passed to allocate(). */
+  );
+};
+
+/**
+ @brief Constructs objects of type T one after another in large chunks.
+
+ # Overview
+
+ A chunk_arena<T,Pages> hands out objects in allocation order:
+ consecutive calls to create() return adjacent objects,
+ until a chunk is full and a new one is taken from Pages.
+ Chunks grow geometrically, so a small arena stays small
+ and a large one consists of few, large chunks.
+
+ Objects never move, pointers to them stay valid until clear(),
+ even if the arena itself is moved.
+ Objects are not freed individually, clear() rewinds the arena in O(1):
+ the chunks and the objects in them are kept, and create() assigns
+ a new object to a kept one instead of constructing it.
+ So T has to be move assignable. Unless T is trivially destructible,
+ each create() after a clear() also destroys the last kept object
+ beyond the ones in use, so what kept objects own is released
+ once as many objects are created as were kept, at the latest.
+ The others are destroyed when they are overwritten
+ or when the arena is destroyed.
+ The memory of destroyed objects stays accessible until their chunk
+ is returned to Pages.
+
+ Pages provides the chunks' memory with allocate() and deallocate(),
+ and their sizes with min_chunk_bytes and max_chunk_bytes,
+ see heap_pages and huge_pages.
+*/
+template< class T , class Pages = heap_pages >
+class chunk_arena
+{
+ public:
+  typedef T value_type; /**< @brief The type of the objects. */
+  typedef Pages pages_type; /**< @brief The source of the chunks. */
+
+ private:
+  class chunk;
+
+  std::vector< chunk * > chunks_; /**< @internal @brief The chunks,
+                                       oldest first. */
+  std::size_t current_; /**< @internal @brief The chunk objects are
+                             created in. */
+  T * cursor_; /**< @internal @brief The next object of the current chunk. */
+  T * end_; /**< @internal @brief The end of the current chunk. */
+  std::size_t built_chunk_; /**< @internal @brief The last chunk holding
+                                 constructed objects. */
+  T * built_end_; /**< @internal @brief The end of the constructed objects
+                       in built_chunk_, nullptr if there are none. */
+
+  /**
+   @internal @brief Returns the offset of the first object in a chunk.
+  */
+  static std::size_t header_bytes();
+
+  /**
+   @internal @brief Continues in the next kept chunk,
+   or takes a new chunk from Pages.
+  */
+  void grow();
+
+  /**
+   @internal @brief Destroys the last constructed object,
+   if it is beyond the ones in use.
+  */
+  void release_kept();
+
+  /**
+   @internal @brief Destroys all objects and releases all chunks.
+  */
+  void release();
+
+ public:
+  /**
+   @brief Constructs an empty arena.
+  */
+  chunk_arena();
+
+  /**
+   @brief Destroys all objects and releases all chunks.
+  */
+  ~chunk_arena();
+
+  chunk_arena( const chunk_arena & other ) = delete;
+  chunk_arena & operator= ( const chunk_arena & other ) = delete;
+
+  /**
+   @brief Move Constructor. Takes over the chunks of other,
+   objects stay in place. other becomes empty.
+  */
+  chunk_arena
+  (
+    chunk_arena &&
+     other /**< The source of the move. */
+  ) noexcept;
+
+  /**
+   @brief Move Assignment operator. Releases the own chunks
+   and takes over the chunks of other, which becomes empty.
+
+   @return A reference to *this
+  */
+  chunk_arena & operator=
+  (
+    chunk_arena &&
+     other /**< The source of the move. */
+  ) noexcept;
+
+  /**
+   @brief Constructs an object from args behind the last one.
+
+   @return The new object.
+  */
+  template< class... Args >
+  T * create
+  (
+    Args &&...
+     args /**< The constructor arguments. */
+  );
+
+  /**
+   @brief Makes all objects reusable, in O(1).
+   The chunks and objects are kept and overwritten by create(),
+   which destroys the kept objects beyond the ones in use
+   one at a time.
+  */
+  void clear();
+
+  /**
+   @brief Takes back the last count objects created,
+   destroys them and the objects kept beyond them by clear(),
+   and returns the chunks left empty to Pages,
+   except the first keep chunks.
+  */
+  void shrink
+  (
+    std::size_t
+     count , /**< The number of objects, at most those in use. */
+    std::size_t
+     keep = 0 /**< The number of chunks kept allocated. */
+  );
+
+  /**
+   @brief Returns the number of chunks holding objects.
+
+   @return The number of chunks in use.
+  */
+  std::size_t chunks() const;
+
+  /**
+   @brief Returns the number of chunks allocated,
+   in use or kept by clear().
+
+   @return The number of chunks allocated.
+  */
+  std::size_t allocated() const;
+
+  /**
+   @brief Returns the first object of a chunk in use.
+   Objects in the same chunk are adjacent, in allocation order.
+
+   @return The first object of the chunk.
+  */
+  T * begin
+  (
+    std::size_t
+     index /**< The chunk, 0 is the oldest. */
+  ) const;
+
+  /**
+   @brief Returns the end of the objects of a chunk in use.
+
+   @return The end of the chunk's objects.
+  */
+  T * end
+  (
+    std::size_t
+     index /**< The chunk, 0 is the oldest. */
+  ) const;
+};
+
+/**
+ @internal @brief The header of a chunk. The objects follow it.
+*/
+template< class T , class Pages >
+class chunk_arena< T , Pages >::chunk
+{
+ public:
+  std::size_t bytes_; /**< @internal @brief The size of the chunk. */
+
+  /**
+   @internal @brief Returns the first object of the chunk.
+  */
+  T * begin();
+
+  /**
+   @internal @brief Returns the end of the chunk's objects.
+  */
+  T * end();
+};
+
+
+
+/*
+  Implementation of heap_pages class members
+*/
+
+inline
+ void *
+  heap_pages::allocate
+  (
+    std::size_t
+     bytes
+  )
+{
+  return ::operator new( bytes );
+}
+
+inline
+ void
+  heap_pages::deallocate
+  (
+    void *
+     memory ,
+    std::size_t
+     bytes
+  )
+{
+  ::operator delete( memory );
+}
+
+/*
+  Implementation of huge_pages class members
+*/
+
+inline
+ void *
+  huge_pages::allocate
+  (
+    std::size_t
+     bytes
+  )
+{
+#if defined( __linux__ )
+  const int protection = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#if defined( MAP_HUGETLB )
+  void * reserved = mmap( nullptr , bytes , protection ,
+                          flags | MAP_HUGETLB , -1 , 0 );
+  if( reserved != MAP_FAILED )
+  {
+    return reserved;
+  }
+#endif
+
+  // Over-allocate, so a huge page aligned range can be cut out.
+  const std::size_t mapped_bytes = bytes + huge_page_bytes;
+  void * mapped = mmap( nullptr , mapped_bytes , protection , flags , -1 , 0 );
+  if( mapped == MAP_FAILED )
+  {
+    throw std::bad_alloc();
+  }
+
+  const auto begin = reinterpret_cast< std::uintptr_t >( mapped );
+  const auto aligned = ( begin + huge_page_bytes - 1 ) /
+                       huge_page_bytes * huge_page_bytes;
+  if( aligned != begin )
+  {
+    munmap( mapped , aligned - begin );
+  }
+  const auto tail = begin + mapped_bytes - ( aligned + bytes );
+  if( tail != 0 )
+  {
+    munmap( reinterpret_cast< void * >( aligned + bytes ) , tail );
+  }
+
+#if defined( MADV_HUGEPAGE )
+  madvise( reinterpret_cast< void * >( aligned ) , bytes , MADV_HUGEPAGE );
+#endif
+  return reinterpret_cast< void * >( aligned );
+#else
+  return heap_pages::allocate( bytes );
+#endif
+}
+
+inline
+ void
+  huge_pages::deallocate
+  (
+    void *
+     memory ,
+    std::size_t
+     bytes
+  )
+{
+#if defined( __linux__ )
+  munmap( memory , bytes );
+#else
+  heap_pages::deallocate( memory , bytes );
+#endif
+}
+
+/*
+  Implementation of chunk_arena<> class members
+*/
+
+template< class T , class Pages >
+ std::size_t
+  chunk_arena< T , Pages >::header_bytes()
+{
+  return ( sizeof( chunk ) + alignof( T ) - 1 ) / alignof( T ) * alignof( T );
+}
+
+template< class T , class Pages >
+ void
+  chunk_arena< T , Pages >::grow()
+{
+  if( cursor_ && current_ + 1 < chunks_.size() )
+  {
+    ++current_;
+    cursor_ = chunks_[ current_ ]->begin();
+    end_ = chunks_[ current_ ]->end();
+    return;
+  }
+  if( ! cursor_ && ! chunks_.empty() )
+  {
+    current_ = 0;
+    cursor_ = chunks_.front()->begin();
+    end_ = chunks_.front()->end();
+    return;
+  }
+
+  std::size_t bytes = Pages::min_chunk_bytes;
+  if( ! chunks_.empty() )
+  {
+    bytes = chunks_.back()->bytes_ < Pages::max_chunk_bytes
+            ? chunks_.back()->bytes_ * 2
+            : Pages::max_chunk_bytes;
+  }
+  while( bytes < header_bytes() + sizeof( T ) )
+  {
+    bytes *= 2;
+  }
+
+  chunks_.reserve( chunks_.size() + 1 );
+  const auto fresh = static_cast< chunk * >( Pages::allocate( bytes ) );
+  fresh->bytes_ = bytes;
+  chunks_.push_back( fresh );
+  current_ = chunks_.size() - 1;
+  cursor_ = fresh->begin();
+  end_ = fresh->end();
+}
+
+template< class T , class Pages >
+  chunk_arena< T , Pages >::chunk_arena()
+  : chunks_() ,
+    current_( 0 ) ,
+    cursor_() ,
+    end_() ,
+    built_chunk_( 0 ) ,
+    built_end_()
+{
+}
+
+template< class T , class Pages >
+  chunk_arena< T , Pages >::chunk_arena
+  (
+    chunk_arena &&
+     other
+  ) noexcept
+  : chunk_arena()
+{
+  *this = std::move( other );
+}
+
+template< class T , class Pages >
+ chunk_arena< T , Pages > &
+  chunk_arena< T , Pages >::operator=
+  (
+    chunk_arena &&
+     other
+  ) noexcept
+{
+  if( this != &other )
+  {
+    release();
+    chunks_ = std::move( other.chunks_ );
+    current_ = other.current_;
+    cursor_ = other.cursor_;
+    end_ = other.end_;
+    built_chunk_ = other.built_chunk_;
+    built_end_ = other.built_end_;
+
+    other.chunks_.clear();
+    other.current_ = 0;
+    other.cursor_ = nullptr;
+    other.end_ = nullptr;
+    other.built_chunk_ = 0;
+    other.built_end_ = nullptr;
+  }
+  return *this;
+}
+
+template< class T , class Pages >
+  chunk_arena< T , Pages >::~chunk_arena()
+{
+  release();
+}
+
+template< class T , class Pages >
+ void
+  chunk_arena< T , Pages >::release_kept()
+{
+  if( built_chunk_ == current_ ? built_end_ > cursor_
+                               : built_chunk_ > current_ )
+  {
+    --built_end_;
+    built_end_->~T();
+    // Chunks before built_chunk_ are full, so built_end_ stays
+    // in a chunk holding constructed objects.
+    if( built_chunk_ > current_ &&
+        built_end_ == chunks_[ built_chunk_ ]->begin() )
+    {
+      --built_chunk_;
+      built_end_ = chunks_[ built_chunk_ ]->end();
+    }
+  }
+}
+
+template< class T , class Pages >
+ void
+  chunk_arena< T , Pages >::release()
+{
+  if( built_end_ )
+  {
+    for( std::size_t index = 0 ; index <= built_chunk_ ; ++index )
+    {
+      const auto last = index == built_chunk_ ? built_end_
+                                              : chunks_[ index ]->end();
+      for( auto object = chunks_[ index ]->begin() ; object != last ; ++object )
+      {
+        object->~T();
+      }
+    }
+  }
+  for( const auto released : chunks_ )
+  {
+    Pages::deallocate( released , released->bytes_ );
+  }
+  chunks_.clear();
+  current_ = 0;
+  cursor_ = nullptr;
+  end_ = nullptr;
+  built_chunk_ = 0;
+  built_end_ = nullptr;
+}
+
+template< class T , class Pages >
+template< class... Args >
+ T *
+  chunk_arena< T , Pages >::create
+  (
+    Args &&...
+     args
+  )
+{
+  if( cursor_ == end_ )
+  {
+    grow();
+  }
+  const auto result = cursor_;
+  if( built_end_ && ( current_ < built_chunk_ ||
+                      ( current_ == built_chunk_ && result < built_end_ ) ) )
+  {
+    *result = T( std::forward< Args >( args )... );
+  } else {
+    new( result ) T( std::forward< Args >( args )... );
+    built_chunk_ = current_;
+    built_end_ = result + 1;
+  }
+  ++cursor_;
+  if( ! std::is_trivially_destructible< T >::value )
+  {
+    release_kept();
+  }
+  return result;
+}
+
+template< class T , class Pages >
+ void
+  chunk_arena< T , Pages >::clear()
+{
+  current_ = 0;
+  cursor_ = nullptr;
+  end_ = nullptr;
+}
+
+template< class T , class Pages >
+ void
+  chunk_arena< T , Pages >::shrink
+  (
+    std::size_t
+     count ,
+    std::size_t
+     keep
+  )
+{
+  if( ! cursor_ )
+  {
+    return;
+  }
+
+  for( ;; )
+  {
+    const auto in_chunk = std::size_t( cursor_ - chunks_[ current_ ]->begin() );
+    if( count <= in_chunk || current_ == 0 )
+    {
+      cursor_ -= count < in_chunk ? count : in_chunk;
+      break;
+    }
+    count -= in_chunk;
+    --current_;
+    cursor_ = chunks_[ current_ ]->end();
+  }
+  end_ = chunks_[ current_ ]->end();
+
+  if( built_end_ )
+  {
+    for( auto index = current_ ; index <= built_chunk_ ; ++index )
+    {
+      const auto first = index == current_ ? cursor_ : chunks_[ index ]->begin();
+      const auto last = index == built_chunk_ ? built_end_
+                                              : chunks_[ index ]->end();
+      for( auto object = first ; object < last ; ++object )
+      {
+        object->~T();
+      }
+    }
+    built_chunk_ = current_;
+    built_end_ = cursor_;
+  }
+
+  while( chunks_.size() > current_ + 1 && chunks_.size() > keep )
+  {
+    Pages::deallocate( chunks_.back() , chunks_.back()->bytes_ );
+    chunks_.pop_back();
+  }
+}
+
+template< class T , class Pages >
+ std::size_t
+  chunk_arena< T , Pages >::allocated() const
+{
+  return chunks_.size();
+}
+
+template< class T , class Pages >
+ std::size_t
+  chunk_arena< T , Pages >::chunks() const
+{
+  return cursor_ ? current_ + 1 : 0;
+}
+
+template< class T , class Pages >
+ T *
+  chunk_arena< T , Pages >::begin
+  (
+    std::size_t
+     index
+  ) const
+{
+  return chunks_[ index ]->begin();
+}
+
+template< class T , class Pages >
+ T *
+  chunk_arena< T , Pages >::end
+  (
+    std::size_t
+     index
+  ) const
+{
+  return index == current_ ? cursor_ : chunks_[ index ]->end();
+}
+
+/*
+  Implementation of chunk_arena<>::chunk class members
+*/
+
+template< class T , class Pages >
+ T *
+  chunk_arena< T , Pages >::chunk::begin()
+{
+  return reinterpret_cast< T * >(
+    reinterpret_cast< char * >( this ) + header_bytes() );
+}
+
+template< class T , class Pages >
+ T *
+  chunk_arena< T , Pages >::chunk::end()
+{
+  return begin() + ( bytes_ - header_bytes() ) / sizeof( T );
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "archived_arena.h"
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// Counts live instances, so destruction by clear() can be checked.
+class counted
+{
+ public:
+  static std::int64_t live;
+  std::int64_t value;
+
+  explicit counted( std::int64_t v ) : value( v ) { ++live; }
+  counted( const counted & other ) : value( other.value ) { ++live; }
+  counted & operator=( const counted & other ) = default;
+  ~counted() { --live; }
+};
+
+std::int64_t counted::live = 0;
+
+int main ( int argc , const char ** argv )
+{
+  const std::int64_t objects = 100000;
+
+  chunk_arena< counted > tested_object_1;
+  std::vector< counted * > created;
+
+  std::cout << "Create. \n";
+
+  std::int64_t adjacent = 0;
+  for( std::int64_t i = 0 ; i < objects ; ++i )
+  {
+    created.push_back( tested_object_1.create( i ) );
+    if( i > 0 && created[ i ] == created[ i - 1 ] + 1 )
+    {
+      ++adjacent;
+    }
+  }
+
+  if( !check_equal( objects , counted::live , "Live objects." ) )
+  {
+    return 1;
+  }
+
+  // Only the first object of each chunk is not adjacent to its predecessor.
+  if( !check_equal( true , objects - adjacent < 32 ,
+                    "Objects adjacent in allocation order." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Create Check. \n";
+
+  for( std::int64_t i = 0 ; i < objects ; ++i )
+  {
+    if( created[ i ]->value != i )
+    {
+      check_equal( i , created[ i ]->value , "Objects stay in place." );
+      return 1;
+    }
+  }
+
+  std::int64_t visited = 0;
+  for( std::size_t chunk = 0 ; chunk < tested_object_1.chunks() ; ++chunk )
+  {
+    visited += tested_object_1.end( chunk ) - tested_object_1.begin( chunk );
+  }
+  if( !check_equal( objects , visited , "Objects visited by chunk." ) )
+  {
+    return 1;
+  }
+
+  // Objects are kept by clear() and overwritten on reuse.
+  tested_object_1.clear();
+  if( !check_equal( objects , counted::live , "Live objects after clear." ) )
+  {
+    return 1;
+  }
+
+  // The reuse destroys the last kept object.
+  const auto reused = tested_object_1.create( 7 );
+  const std::int64_t kept = counted::live;
+  if( !check_equal( objects - 1 , kept , "Live objects after reuse." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( true , reused == created.front() && reused->value == 7 ,
+                    "Objects reused after clear." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( 1 , tested_object_1.end( 0 ) - tested_object_1.begin( 0 ) ,
+                    "Objects in use after clear." ) )
+  {
+    return 1;
+  }
+
+  //Huge pages, or their fallback
+
+  std::cout << "Create, Huge Pages. \n";
+
+  {
+    chunk_arena< counted , huge_pages > tested_object_2;
+    std::vector< counted * > huge_created;
+    for( std::int64_t i = 0 ; i < objects ; ++i )
+    {
+      huge_created.push_back( tested_object_2.create( i ) );
+    }
+
+    const auto first_chunk = reinterpret_cast< std::uintptr_t >(
+                               huge_created.front() );
+    // The first object follows the chunk header.
+    if( !check_equal( true , first_chunk % huge_pages::huge_page_bytes < 64 ,
+                      "Chunk aligned to a huge page." ) )
+    {
+      return 1;
+    }
+
+    std::int64_t sum = 0;
+    for( const auto object : huge_created )
+    {
+      sum += object->value;
+    }
+    if( !check_equal( objects * ( objects - 1 ) / 2 , sum ,
+                      "Objects in huge pages." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( kept , counted::live , "Live objects after unmapping." ) )
+  {
+    return 1;
+  }
+
+  //Destruction destroys kept objects as well
+
+  {
+    chunk_arena< counted > tested_object_3;
+    for( std::int64_t i = 0 ; i < 1000 ; ++i )
+    {
+      tested_object_3.create( i );
+    }
+    tested_object_3.clear();
+    for( std::int64_t i = 0 ; i < 10 ; ++i )
+    {
+      tested_object_3.create( i );
+    }
+  }
+
+  if( !check_equal( kept , counted::live ,
+                    "Live objects after destruction." ) )
+  {
+    return 1;
+  }
+
+  //Moving keeps objects in place
+
+  {
+    chunk_arena< counted > tested_object_4;
+    const auto first = tested_object_4.create( 7 );
+    for( std::int64_t i = 0 ; i < 1000 ; ++i )
+    {
+      tested_object_4.create( i );
+    }
+
+    chunk_arena< counted > tested_object_5( std::move( tested_object_4 ) );
+    chunk_arena< counted > tested_object_6;
+    tested_object_6.create( 3 );
+    tested_object_6 = std::move( tested_object_5 );
+
+    if( !check_equal( 0 , tested_object_4.chunks() + tested_object_5.chunks() ,
+                      "Chunks of moved from arenas." ) ||
+        !check_equal( true , tested_object_6.begin( 0 ) == first ,
+                      "First object after moves." ) ||
+        !check_equal( 7 , first->value , "Value after moves." ) ||
+        !check_equal( kept + 1001 , counted::live ,
+                      "Live objects after moves." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( kept , counted::live ,
+                    "Live objects after destruction of moved arenas." ) )
+  {
+    return 1;
+  }
+
+  //Objects owning memory release it after clear
+
+  std::cout << "Release After Clear. \n";
+
+  {
+    // The counted objects are owned by the vectors' buffers.
+    chunk_arena< std::vector< counted > > tested_object_7;
+    for( std::int64_t i = 0 ; i < 1000 ; ++i )
+    {
+      tested_object_7.create( 100 , counted( i ) );
+    }
+    if( !check_equal( kept + 100000 , counted::live ,
+                      "Owned objects." ) )
+    {
+      return 1;
+    }
+
+    tested_object_7.clear();
+    if( !check_equal( kept + 100000 , counted::live ,
+                      "Owned objects after clear." ) )
+    {
+      return 1;
+    }
+
+    // Each create() overwrites one kept vector and destroys another.
+    for( std::int64_t i = 0 ; i < 10 ; ++i )
+    {
+      tested_object_7.create();
+    }
+    if( !check_equal( kept + 98000 , counted::live ,
+                      "Owned objects after 10 creates." ) )
+    {
+      return 1;
+    }
+
+    for( std::int64_t i = 10 ; i < 500 ; ++i )
+    {
+      tested_object_7.create();
+    }
+    std::int64_t in_use = 0;
+    for( std::size_t chunk = 0 ; chunk < tested_object_7.chunks() ; ++chunk )
+    {
+      in_use += tested_object_7.end( chunk ) - tested_object_7.begin( chunk );
+    }
+    if( !check_equal( kept , counted::live ,
+                      "Owned objects after 500 creates." ) ||
+        !check_equal( 500 , in_use , "Objects in use." ) )
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
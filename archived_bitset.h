@@ -0,0 +1,487 @@
+#ifndef ARCHIVED_BITSET_H
+#define ARCHIVED_BITSET_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+/** @file */
+
+/**
+ @brief Combines bitmaps by bitwise or.
+ With this operation, the diff of a bitmap_archive<> contains
+ every bit set since a version.
+*/
+class bitwise_or
+{
+ public:
+  /**
+   @brief Combines two words.
+
+   @return a | b
+  */
+  static std::uint64_t apply
+  (
+    std::uint64_t
+     a , /**< The first word. */
+    std::uint64_t
+     b /**< The second word. */
+  )
+  {
+    return a | b;
+  }
+
+#if defined( __AVX2__ )
+  /**
+   @brief Combines four words at once.
+
+   @return a | b
+  */
+  static __m256i apply
+  (
+    __m256i
+     a , /**< The first words. */
+    __m256i
+     b /**< The second words. */
+  )
+  {
+    return _mm256_or_si256( a , b );
+  }
+#endif
+};
+
+/**
+ @brief Combines bitmaps by bitwise exclusive or.
+ With this operation, the diff of a bitmap_archive<> contains
+ every bit that was set an odd number of times since a version.
+*/
+class bitwise_xor
+{
+ public:
+  /**
+   @brief Combines two words.
+
+   @return a ^ b
+  */
+  static std::uint64_t apply
+  (
+    std::uint64_t
+     a , /**< The first word. */
+    std::uint64_t
+     b /**< The second word. */
+  )
+  {
+    return a ^ b;
+  }
+
+#if defined( __AVX2__ )
+  /**
+   @brief Combines four words at once.
+
+   @return a ^ b
+  */
+  static __m256i apply
+  (
+    __m256i
+     a , /**< The first words. */
+    __m256i
+     b /**< The second words. */
+  )
+  {
+    return _mm256_xor_si256( a , b );
+  }
+#endif
+};
+
+/**
+ @brief A bitmap of Bits bits, combined by a bitwise Operation.
+
+ # Overview
+
+ A bitmap<Bits,Operation> is a value type for archived<>.
+ operator+= combines two bitmaps with Operation,
+ which is bitwise_or or bitwise_xor.
+
+ ## Storage:
+
+ A bitmap stores the positions of its set bits sparsely,
+ as a sorted array, as long as that is smaller than a dense
+ array of words. A commit that touched a few bits thus costs
+ a few positions instead of Bits bits.
+ Dense bitmaps are combined word-parallel, with AVX2 if available.
+
+ count() returns the population count of either representation.
+*/
+template< std::size_t Bits , class Operation = bitwise_or >
+class bitmap
+{
+ public:
+  typedef std::size_t size_type; /**< @brief The type of bit positions. */
+  typedef Operation operation_type; /**< @brief The combining operation. */
+
+ private:
+  typedef std::uint32_t position_type;
+                            /**< @internal @brief A sparse bit position. */
+  typedef std::vector< position_type > sparse_type;
+                            /**< @internal @brief Sorted set bits. */
+  typedef std::vector< std::uint64_t > dense_type;
+                            /**< @internal @brief All words. */
+
+  static const size_type words = ( Bits + 63 ) / 64;
+                            /**< @internal @brief Number of dense words. */
+  static const size_type dense_threshold =
+    ( words * sizeof( std::uint64_t ) ) / ( 2 * sizeof( position_type ) ) + 1;
+                            /**< @internal @brief Number of sparse positions
+                                 at which the dense array is used. */
+
+  sparse_type sparse_; /**< @internal @brief The set bits,
+                            if the bitmap is sparse. */
+  dense_type dense_; /**< @internal @brief All words,
+                          if the bitmap is dense, empty otherwise. */
+
+  /**
+   @internal @brief Switches to the dense representation.
+  */
+  void densify();
+
+  /**
+   @internal @brief Combines the sparse positions into the dense words.
+  */
+  void scatter
+  (
+    const sparse_type &
+     positions /**< The set bits to combine. */
+  );
+
+  /**
+   @internal @brief Combines n words of source into destination.
+  */
+  static void combine_dense
+  (
+    std::uint64_t *
+     destination , /**< The words that are updated. */
+    const std::uint64_t *
+     source , /**< The words to combine. */
+    size_type
+     n /**< The number of words. */
+  );
+
+  /**
+   @internal @brief Counts the set bits of a word.
+  */
+  static size_type popcount
+  (
+    std::uint64_t
+     word /**< The word. */
+  );
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed bitmap has no bits set and is sparse.
+  */
+  bitmap();
+
+  /**
+   @brief Sets the bit at position.
+   position has to be less than Bits.
+  */
+  void set
+  (
+    size_type
+     position /**< The bit to set. */
+  );
+
+  /**
+   @brief Checks whether the bit at position is set.
+
+   @return true, if the bit is set.
+  */
+  bool test
+  (
+    size_type
+     position /**< The bit to check. */
+  ) const;
+
+  /**
+   @brief Combines other into *this, using Operation.
+
+   @return A reference to *this
+  */
+  bitmap & operator+=
+  (
+    const bitmap &
+     other /**< The bitmap to combine. */
+  );
+
+  /**
+   @brief Returns the number of set bits.
+
+   @return The population count.
+  */
+  size_type count() const;
+
+  /**
+   @brief Copies the bitmap into a std::bitset<>.
+
+   @return A bitset with the same bits set.
+  */
+  std::bitset< Bits > to_bitset() const;
+
+  /**
+   @brief Checks whether the bitmap uses the dense representation.
+
+   @return true, if the bitmap is dense.
+  */
+  bool is_dense() const;
+};
+
+/**
+ @brief An archived<> of bitmaps.
+ Each commit stores only the bits it set.
+*/
+template< std::size_t Bits , class Operation = bitwise_or >
+using bitmap_archive = archived< bitmap< Bits , Operation > >;
+
+
+
+/*
+  Implementation of bitmap<> class members
+*/
+
+template< std::size_t Bits , class Operation >
+  bitmap< Bits , Operation >::bitmap()
+  : sparse_() ,
+    dense_()
+{
+}
+
+template< std::size_t Bits , class Operation >
+ void
+  bitmap< Bits , Operation >::densify()
+{
+  dense_.assign( words , 0 );
+  scatter( sparse_ );
+  sparse_type().swap( sparse_ );
+}
+
+template< std::size_t Bits , class Operation >
+ void
+  bitmap< Bits , Operation >::scatter
+  (
+    const sparse_type &
+     positions
+  )
+{
+  for( const auto position : positions )
+  {
+    auto & word = dense_[ position / 64 ];
+    word = Operation::apply( word , std::uint64_t( 1 ) << ( position % 64 ) );
+  }
+}
+
+template< std::size_t Bits , class Operation >
+ void
+  bitmap< Bits , Operation >::combine_dense
+  (
+    std::uint64_t *
+     destination ,
+    const std::uint64_t *
+     source ,
+    size_type
+     n
+  )
+{
+  size_type i = 0;
+#if defined( __AVX2__ )
+  for( ; i + 4 <= n ; i += 4 )
+  {
+    const auto d = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( destination + i ) );
+    const auto s = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( source + i ) );
+    _mm256_storeu_si256( reinterpret_cast< __m256i * >( destination + i ) ,
+                         Operation::apply( d , s ) );
+  }
+#endif
+  for( ; i < n ; ++i )
+  {
+    destination[ i ] = Operation::apply( destination[ i ] , source[ i ] );
+  }
+}
+
+template< std::size_t Bits , class Operation >
+ typename bitmap< Bits , Operation >::size_type
+  bitmap< Bits , Operation >::popcount
+  (
+    std::uint64_t
+     word
+  )
+{
+#if defined( __GNUC__ )
+  return __builtin_popcountll( word );
+#else
+  size_type count = 0;
+  for( ; word ; word &= word - 1 )
+  {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+template< std::size_t Bits , class Operation >
+ void
+  bitmap< Bits , Operation >::set
+  (
+    size_type
+     position
+  )
+{
+  if( is_dense() )
+  {
+    dense_[ position / 64 ] |= std::uint64_t( 1 ) << ( position % 64 );
+    return;
+  }
+
+  const auto bit = static_cast< position_type >( position );
+  const auto where = std::lower_bound( sparse_.begin() , sparse_.end() , bit );
+  if( where == sparse_.end() || *where != bit )
+  {
+    sparse_.insert( where , bit );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+}
+
+template< std::size_t Bits , class Operation >
+ bool
+  bitmap< Bits , Operation >::test
+  (
+    size_type
+     position
+  ) const
+{
+  if( is_dense() )
+  {
+    return ( dense_[ position / 64 ] >> ( position % 64 ) ) & 1;
+  }
+  return std::binary_search( sparse_.begin() , sparse_.end() ,
+                             static_cast< position_type >( position ) );
+}
+
+template< std::size_t Bits , class Operation >
+ bitmap< Bits , Operation > &
+  bitmap< Bits , Operation >::operator+=
+  (
+    const bitmap< Bits , Operation > &
+     other
+  )
+{
+  if( other.is_dense() )
+  {
+    if( is_dense() )
+    {
+      combine_dense( dense_.data() , other.dense_.data() , words );
+    } else {
+      sparse_type positions;
+      positions.swap( sparse_ );
+      dense_ = other.dense_;
+      scatter( positions );
+    }
+  } else if( is_dense() ) {
+    scatter( other.sparse_ );
+  } else if( ! other.sparse_.empty() ) {
+    // A bit set in both operands survives, if the operation keeps it.
+    const bool keep_common = Operation::apply( 1 , 1 ) & 1;
+
+    sparse_type merged;
+    merged.reserve( sparse_.size() + other.sparse_.size() );
+
+    auto mine = sparse_.cbegin();
+    auto theirs = other.sparse_.cbegin();
+    const auto mine_end = sparse_.cend();
+    const auto theirs_end = other.sparse_.cend();
+
+    while( mine != mine_end && theirs != theirs_end )
+    {
+      if( *mine < *theirs )
+      {
+        merged.push_back( *mine++ );
+      } else if( *theirs < *mine ) {
+        merged.push_back( *theirs++ );
+      } else {
+        if( keep_common )
+        {
+          merged.push_back( *mine );
+        }
+        ++mine;
+        ++theirs;
+      }
+    }
+    merged.insert( merged.end() , mine , mine_end );
+    merged.insert( merged.end() , theirs , theirs_end );
+
+    sparse_.swap( merged );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+  return *this;
+}
+
+template< std::size_t Bits , class Operation >
+ typename bitmap< Bits , Operation >::size_type
+  bitmap< Bits , Operation >::count() const
+{
+  if( ! is_dense() )
+  {
+    return sparse_.size();
+  }
+
+  size_type result = 0;
+  for( const auto word : dense_ )
+  {
+    result += popcount( word );
+  }
+  return result;
+}
+
+template< std::size_t Bits , class Operation >
+ std::bitset< Bits >
+  bitmap< Bits , Operation >::to_bitset() const
+{
+  std::bitset< Bits > result;
+  if( is_dense() )
+  {
+    for( size_type position = 0 ; position < Bits ; ++position )
+    {
+      result[ position ] = ( dense_[ position / 64 ] >> ( position % 64 ) ) & 1;
+    }
+  } else {
+    for( const auto position : sparse_ )
+    {
+      result.set( position );
+    }
+  }
+  return result;
+}
+
+template< std::size_t Bits , class Operation >
+ bool
+  bitmap< Bits , Operation >::is_dense() const
+{
+  return ! dense_.empty();
+}
+
+#endif
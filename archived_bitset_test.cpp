@@ -0,0 +1,118 @@
+#include "archived_bitset.h"
+
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::size_t a , std::size_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+const std::size_t bits = 300;
+
+template< class Operation , class Control >
+int run_test( const std::string & name , Control combine )
+{
+  typedef bitmap< bits , Operation > tested_bitmap;
+
+  //Test constructor
+  bitmap_archive< bits , Operation > tested_object( ( tested_bitmap() ) );
+
+  std::vector< typename bitmap_archive< bits , Operation >::version >
+    version_vector;
+  std::vector< std::bitset< bits > > control_values;
+
+  version_vector.push_back( tested_object.current() );
+  control_values.push_back( std::bitset< bits >() );
+
+  std::cout << "Increment, " << name << ". \n";
+
+  for( std::size_t step = 0 ; step < 30 ; ++step )
+  {
+    tested_bitmap increment;
+    std::bitset< bits > control_increment;
+    for( std::size_t i = 0 ; i < step ; ++i )
+    {
+      const std::size_t position = ( step * 31 + i * i * 7 ) % bits;
+      increment.set( position );
+      control_increment.set( position );
+    }
+
+    version_vector.push_back( tested_object.increment_by( increment ) );
+
+    for( auto & control : control_values )
+    {
+      control = combine( control , control_increment );
+    }
+    control_values.push_back( std::bitset< bits >() );
+  }
+
+  std::cout << "Increment Check, " << name << ". \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    const auto diff = diff_to_current( version_vector[ i ] );
+
+    if( !check_equal( control_values[ i ].count() , diff.count() ,
+                      "Population count of Diff to Current." ) ||
+        !check_equal( true , control_values[ i ] == diff.to_bitset() ,
+                      "Bits of Diff to Current." ) )
+    {
+      return 1;
+    }
+
+    for( std::size_t position = 0 ; position < bits ; ++position )
+    {
+      if( diff.test( position ) != control_values[ i ][ position ] )
+      {
+        return !check_equal( control_values[ i ][ position ] ,
+                             diff.test( position ) ,
+                             "Single bit of Diff to Current." );
+      }
+    }
+  }
+
+  if( !check_equal( true ,
+                    diff_to_current( version_vector[ 0 ] ).is_dense() ,
+                    "Long diff is dense." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
+
+int main ( int argc , const char ** argv )
+{
+  typedef std::bitset< bits > control_type;
+
+  if( run_test< bitwise_or >( "Or" ,
+        []( const control_type & a , const control_type & b )
+        {
+          return a | b;
+        } ) )
+  {
+    return 1;
+  }
+
+  if( run_test< bitwise_xor >( "Xor" ,
+        []( const control_type & a , const control_type & b )
+        {
+          return a ^ b;
+        } ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,681 @@
+#ifndef ARCHIVED_CHECKPOINT_H
+#define ARCHIVED_CHECKPOINT_H
+
+#include "archived_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+/** @file */
+
+/**
+ @brief Incremental checkpoints of an archive_pool<>.
+
+ # Overview
+
+ A pool_checkpoint<Value,Policy> saves the archives of a pool
+ to a file and restores them from it. Policy::track_changes has
+ to be true, so the pool records the commits and archives it changes,
+ and Value has to be trivially copyable.
+
+ ## Chain:
+
+ The file is a chain of segments. The first is a base,
+ holding every commit and archive. Each write() appends a delta,
+ holding only the commits and archives changed since the previous
+ segment: the commits appended, and the commits compression rewrote
+ or released, each once, in its last state.
+
+ After chain_length deltas, write() consolidates instead:
+ a new base is written to a temporary file, which then replaces
+ the chain. consolidate() does so right away.
+
+ ## Loading:
+
+ load() rebuilds an empty pool from the base and the deltas,
+ reading the file once from front to back. Reference counts and
+ free lists are not saved, they are recomputed from the links.
+ Versions are not saved: commits only versions referred to
+ are released.
+
+ A delta is only applied if it was written completely, so a chain
+ whose last write() was interrupted loads the state of the write()
+ before. Segments are in the byte order of the machine.
+ Flushing them to stable storage is left to the caller.
+*/
+template< class Value , class Policy >
+class pool_checkpoint
+{
+ public:
+  typedef archive_pool< Value , Policy > pool_type;
+                            /**< @brief The type of pools saved. */
+
+ private:
+  class commit_record;
+  class archive_record;
+
+  typedef typename pool_type::index_type index_type;
+                            /**< @internal @brief Index of a commit. */
+
+  static_assert( Policy::track_changes ,
+                 "pool_checkpoint needs Policy::track_changes" );
+  static_assert( std::is_trivially_copyable< Value >::value ,
+                 "pool_checkpoint writes Value as bytes" );
+
+  static const std::uint32_t magic = 0x4b435041; /**< @internal @brief
+                                                      Marks segments. */
+  static const std::uint32_t base_segment = 1; /**< @internal @brief A base. */
+  static const std::uint32_t delta_segment = 2; /**< @internal @brief A delta. */
+
+  pool_type & pool_; /**< @internal @brief The pool saved. */
+  std::string path_; /**< @internal @brief The file of the chain. */
+  std::size_t chain_length_; /**< @internal @brief The deltas after which
+                                  write() consolidates. */
+  std::size_t chain_; /**< @internal @brief The deltas after the base. */
+  bool based_; /**< @internal @brief Whether the file holds a base
+                    of the pool. */
+
+  /**
+   @internal @brief Writes the bytes of value.
+   Throws std::runtime_error if it fails.
+  */
+  template< class T >
+  void put
+  (
+    std::FILE *
+     file , /**< The file written. */
+    const T &
+     value /**< The value. */
+  ) const;
+
+  /**
+   @internal @brief Reads the bytes of value.
+
+   @return false, if the file ended before.
+  */
+  template< class T >
+  static bool get
+  (
+    std::FILE *
+     file , /**< The file read. */
+    T &
+     value /**< The value. */
+  );
+
+  /**
+   @internal @brief Writes a segment: the header of the pool,
+   the commits and archives listed, and the trailing mark.
+   A base lists none and writes all.
+  */
+  void write_segment
+  (
+    std::FILE *
+     file , /**< The file written. */
+    std::uint32_t
+     kind , /**< base_segment or delta_segment. */
+    const std::vector< index_type > &
+     commits , /**< The commits of a delta. */
+    const std::vector< index_type > &
+     archives /**< The archives of a delta. */
+  ) const;
+
+  /**
+   @internal @brief Reads a segment and applies it to the pool.
+   A base is applied while it is read, a delta once it is complete.
+   Throws std::runtime_error if the first segment is not a base.
+
+   @return false, if the chain ended.
+  */
+  bool read_segment
+  (
+    std::FILE *
+     file , /**< The file read. */
+    bool
+     first , /**< Whether the segment has to be a base. */
+    bool &
+     torn /**< Set if the chain ended in an incomplete segment. */
+  );
+
+  /**
+   @internal @brief Sets a commit of the pool as saved.
+  */
+  void apply
+  (
+    const commit_record &
+     record /**< The commit saved. */
+  );
+
+  /**
+   @internal @brief Sets an archive of the pool as saved.
+  */
+  void apply
+  (
+    const archive_record &
+     record /**< The archive saved. */
+  );
+
+  /**
+   @internal @brief Recomputes the reference counts, the free lists
+   and the counters of the pool from the links, and releases
+   commits no archive reaches.
+  */
+  void rebuild();
+
+  /**
+   @internal @brief Closes file, throws std::runtime_error
+   if that or an earlier write failed.
+  */
+  void close
+  (
+    std::FILE *
+     file , /**< The file written. */
+    const std::string &
+     path /**< Its path, for the message. */
+  ) const;
+
+ public:
+  /**
+   @brief Constructor, saving pool to the file at path.
+   Nothing is read or written before load() or write().
+  */
+  pool_checkpoint
+  (
+    pool_type &
+     pool , /**< The pool saved. */
+    const std::string &
+     path , /**< The file of the chain. */
+    std::size_t
+     chain_length = 16 /**< The deltas after which write()
+                            consolidates. */
+  );
+
+  pool_checkpoint( const pool_checkpoint & other ) = delete;
+  pool_checkpoint & operator= ( const pool_checkpoint & other ) = delete;
+
+  /**
+   @brief Rebuilds the pool from the chain in the file.
+   The pool has to be empty, i.e. no archive may have been created.
+   Later write()s continue the chain, the first consolidates
+   if the chain ended in an incomplete delta.
+   Throws std::runtime_error if the file is not a chain.
+
+   @return false, if there is no file.
+  */
+  bool load();
+
+  /**
+   @brief Saves the changes since the last write() or load(),
+   by appending a delta. Writes a base instead if the file
+   holds none yet, or consolidates if the chain is long.
+   Throws std::runtime_error if writing fails, the next write()
+   then consolidates.
+  */
+  void write();
+
+  /**
+   @brief Replaces the chain by a base of the pool.
+   The base is written to path.tmp and renamed to path.
+   Throws std::runtime_error if writing fails.
+  */
+  void consolidate();
+
+  /**
+   @brief Returns the number of deltas after the base.
+
+   @return The number of deltas.
+  */
+  std::size_t chain() const;
+};
+
+/**
+ @internal @brief A commit as saved. next_ is none if it is released.
+*/
+template< class Value , class Policy >
+class pool_checkpoint< Value , Policy >::commit_record
+{
+ public:
+  index_type index_; /**< @internal @brief The commit. */
+  index_type next_; /**< @internal @brief Its successor. */
+  Value diff_; /**< @internal @brief Its diff. */
+};
+
+/**
+ @internal @brief An archive as saved.
+*/
+template< class Value , class Policy >
+class pool_checkpoint< Value , Policy >::archive_record
+{
+ public:
+  index_type handle_; /**< @internal @brief The archive. */
+  index_type head_; /**< @internal @brief Its head, none if destroyed. */
+  index_type first_; /**< @internal @brief Its initial commit. */
+  std::uint32_t epoch_; /**< @internal @brief The epoch of its commits. */
+};
+
+
+
+/*
+  Implementation of pool_checkpoint<> class members
+*/
+
+template< class Value , class Policy >
+ const std::uint32_t pool_checkpoint< Value , Policy >::magic;
+
+template< class Value , class Policy >
+ const std::uint32_t pool_checkpoint< Value , Policy >::base_segment;
+
+template< class Value , class Policy >
+ const std::uint32_t pool_checkpoint< Value , Policy >::delta_segment;
+
+template< class Value , class Policy >
+template< class T >
+ void
+  pool_checkpoint< Value , Policy >::put
+  (
+    std::FILE *
+     file ,
+    const T &
+     value
+  ) const
+{
+  if( std::fwrite( &value , sizeof( T ) , 1 , file ) != 1 )
+  {
+    std::fclose( file );
+    throw std::runtime_error( "pool_checkpoint: can not write " + path_ );
+  }
+}
+
+template< class Value , class Policy >
+template< class T >
+ bool
+  pool_checkpoint< Value , Policy >::get
+  (
+    std::FILE *
+     file ,
+    T &
+     value
+  )
+{
+  return std::fread( &value , sizeof( T ) , 1 , file ) == 1;
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::write_segment
+  (
+    std::FILE *
+     file ,
+    std::uint32_t
+     kind ,
+    const std::vector< index_type > &
+     commits ,
+    const std::vector< index_type > &
+     archives
+  ) const
+{
+  const bool base = kind == base_segment;
+  const auto slots = index_type( pool_.slots_.size() );
+  const auto commit_count = base ? pool_.used_ : index_type( commits.size() );
+  const auto archive_count = base ? slots : index_type( archives.size() );
+
+  put( file , magic );
+  put( file , kind );
+  put( file , std::uint32_t( sizeof( Value ) ) );
+  put( file , pool_.used_ );
+  put( file , slots );
+  put( file , pool_.epoch_ );
+  put( file , commit_count );
+  put( file , archive_count );
+  put( file , pool_.epoch_value_ );
+
+  for( index_type c = 0 ; c < commit_count ; ++c )
+  {
+    const auto index = base ? c : commits[ c ];
+    const bool released = pool_.changes_.released( index );
+    put( file , index );
+    put( file , released ? pool_type::none : pool_.at( index ).next_ );
+    put( file , released ? Value() : pool_.at( index ).diff_ );
+  }
+  for( index_type a = 0 ; a < archive_count ; ++a )
+  {
+    const auto handle = base ? a : archives[ a ];
+    const auto & saved = pool_.slots_[ handle ];
+    put( file , handle );
+    put( file , saved.head_ );
+    put( file , saved.first_ );
+    put( file , saved.epoch_ );
+  }
+
+  put( file , magic );
+}
+
+template< class Value , class Policy >
+ bool
+  pool_checkpoint< Value , Policy >::read_segment
+  (
+    std::FILE *
+     file ,
+    bool
+     first ,
+    bool &
+     torn
+  )
+{
+  std::uint32_t mark = 0 , kind = 0 , value_size = 0 , epoch = 0;
+  index_type used = 0 , slots = 0 , commits = 0 , archives = 0;
+  Value epoch_value = Value();
+  if( ! get( file , mark ) && ! first )
+  {
+    return false;
+  }
+  // Anything but a complete segment ends the chain as torn.
+  torn = true;
+  const bool complete =
+    get( file , kind ) && get( file , value_size ) &&
+    get( file , used ) && get( file , slots ) && get( file , epoch ) &&
+    get( file , commits ) && get( file , archives ) &&
+    get( file , epoch_value );
+  const bool expected = mark == magic && value_size == sizeof( Value ) &&
+                        kind == ( first ? base_segment : delta_segment );
+  if( first && ( ! complete || ! expected ) )
+  {
+    throw std::runtime_error( "pool_checkpoint: no base in " + path_ );
+  }
+  if( ! complete || ! expected )
+  {
+    return false;
+  }
+
+  // A base is complete, as consolidate() renames it only when it is.
+  std::vector< commit_record > staged_commits;
+  std::vector< archive_record > staged_archives;
+  commit_record commit = {};
+  archive_record archive = {};
+  for( index_type c = 0 ; c < commits ; ++c )
+  {
+    if( ! get( file , commit.index_ ) || ! get( file , commit.next_ ) ||
+        ! get( file , commit.diff_ ) )
+    {
+      return false;
+    }
+    if( first )
+    {
+      apply( commit );
+    } else {
+      staged_commits.push_back( commit );
+    }
+  }
+  for( index_type a = 0 ; a < archives ; ++a )
+  {
+    if( ! get( file , archive.handle_ ) || ! get( file , archive.head_ ) ||
+        ! get( file , archive.first_ ) || ! get( file , archive.epoch_ ) )
+    {
+      return false;
+    }
+    staged_archives.push_back( archive );
+  }
+  if( ! get( file , mark ) || mark != magic )
+  {
+    return false;
+  }
+
+  for( const auto & record : staged_commits )
+  {
+    apply( record );
+  }
+  pool_.grow( used );
+  pool_.used_ = used;
+  pool_.epoch_ = epoch;
+  pool_.epoch_value_ = epoch_value;
+  pool_.slots_.resize( slots ,
+    typename pool_type::slot{ pool_type::none , pool_type::none , 0 } );
+  for( const auto & record : staged_archives )
+  {
+    apply( record );
+  }
+  torn = false;
+  return true;
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::apply
+  (
+    const commit_record &
+     record
+  )
+{
+  pool_.grow( record.index_ + 1 );
+  auto & target = pool_.at( record.index_ );
+  target.next_ = record.next_;
+  target.diff_ = record.diff_;
+  pool_.changes_.commit( record.index_ , record.next_ == pool_type::none );
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::apply
+  (
+    const archive_record &
+     record
+  )
+{
+  auto & target = pool_.slots_[ record.handle_ ];
+  target.head_ = record.head_;
+  target.first_ = record.first_;
+  target.epoch_ = record.epoch_;
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::rebuild()
+{
+  const auto & changes = pool_.changes_;
+  const auto used = pool_.used_;
+
+  pool_.commits_ = 0;
+  for( index_type index = 0 ; index < used ; ++index )
+  {
+    pool_.at( index ).references_ = 0;
+  }
+  for( index_type index = 0 ; index < used ; ++index )
+  {
+    if( ! changes.released( index ) )
+    {
+      ++pool_.commits_;
+      const auto next = pool_.at( index ).next_;
+      if( next != index )
+      {
+        ++pool_.at( next ).references_;
+      }
+    }
+  }
+
+  // Archives of older epochs are reinitialized when used,
+  // their commits were taken back.
+  pool_.archives_ = 0;
+  pool_.free_slots_ = pool_type::none;
+  for( auto handle = index_type( pool_.slots_.size() ) ; handle-- != 0 ; )
+  {
+    auto & saved = pool_.slots_[ handle ];
+    if( saved.head_ == pool_type::none )
+    {
+      saved.first_ = pool_.free_slots_;
+      pool_.free_slots_ = handle;
+    } else {
+      ++pool_.archives_;
+      if( saved.epoch_ == pool_.epoch_ )
+      {
+        ++pool_.at( saved.first_ ).references_;
+        ++pool_.at( saved.head_ ).references_;
+      }
+    }
+  }
+
+  pool_.free_ = pool_type::none;
+  for( auto index = used ; index-- != 0 ; )
+  {
+    if( changes.released( index ) )
+    {
+      pool_.at( index ).next_ = pool_.free_;
+      pool_.free_ = index;
+    }
+  }
+
+  // Commits only versions referred to.
+  for( index_type index = 0 ; index < used ; ++index )
+  {
+    if( ! changes.released( index ) &&
+        pool_.at( index ).references_ == 0 )
+    {
+      pool_.at( index ).references_ = 1;
+      pool_.release_commit( index );
+    }
+  }
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::close
+  (
+    std::FILE *
+     file ,
+    const std::string &
+     path
+  ) const
+{
+  const bool failed = std::ferror( file ) != 0;
+  if( std::fclose( file ) != 0 || failed )
+  {
+    throw std::runtime_error( "pool_checkpoint: can not write " + path );
+  }
+}
+
+template< class Value , class Policy >
+  pool_checkpoint< Value , Policy >::pool_checkpoint
+  (
+    pool_type &
+     pool ,
+    const std::string &
+     path ,
+    std::size_t
+     chain_length
+  )
+  : pool_( pool ) ,
+    path_( path ) ,
+    chain_length_( chain_length ) ,
+    chain_( 0 ) ,
+    based_( false )
+{
+}
+
+template< class Value , class Policy >
+ bool
+  pool_checkpoint< Value , Policy >::load()
+{
+  std::FILE * const file = std::fopen( path_.c_str() , "rb" );
+  if( ! file )
+  {
+    return false;
+  }
+
+  bool torn = false;
+  try
+  {
+    read_segment( file , true , torn );
+    chain_ = 0;
+    while( read_segment( file , false , torn ) )
+    {
+      ++chain_;
+    }
+  } catch( ... ) {
+    std::fclose( file );
+    throw;
+  }
+  std::fclose( file );
+
+  rebuild();
+  pool_.changes_.clear();
+  // Deltas appended after a torn one would not be read,
+  // so the next write() consolidates.
+  based_ = ! torn;
+  return true;
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::write()
+{
+  if( ! based_ || chain_ >= chain_length_ )
+  {
+    consolidate();
+    return;
+  }
+
+  std::vector< index_type > commits;
+  for( const auto index : pool_.changes_.commits() )
+  {
+    // Commits above used_ were taken back by reset_all().
+    if( index < pool_.used_ )
+    {
+      commits.push_back( index );
+    }
+  }
+
+  std::FILE * const file = std::fopen( path_.c_str() , "ab" );
+  if( ! file )
+  {
+    throw std::runtime_error( "pool_checkpoint: can not open " + path_ );
+  }
+  try
+  {
+    write_segment( file , delta_segment , commits ,
+                   pool_.changes_.archives() );
+    close( file , path_ );
+  } catch( ... ) {
+    // Deltas appended after torn bytes would not be read,
+    // so the next write() consolidates. The changes are kept.
+    based_ = false;
+    throw;
+  }
+
+  pool_.changes_.clear();
+  ++chain_;
+}
+
+template< class Value , class Policy >
+ void
+  pool_checkpoint< Value , Policy >::consolidate()
+{
+  const std::string temporary = path_ + ".tmp";
+  std::FILE * const file = std::fopen( temporary.c_str() , "wb" );
+  if( ! file )
+  {
+    throw std::runtime_error( "pool_checkpoint: can not open " + temporary );
+  }
+  write_segment( file , base_segment , std::vector< index_type >() ,
+                 std::vector< index_type >() );
+  close( file , temporary );
+  if( std::rename( temporary.c_str() , path_.c_str() ) != 0 )
+  {
+    throw std::runtime_error( "pool_checkpoint: can not rename " +
+                              temporary );
+  }
+
+  pool_.changes_.clear();
+  chain_ = 0;
+  based_ = true;
+}
+
+template< class Value , class Policy >
+ std::size_t
+  pool_checkpoint< Value , Policy >::chain() const
+{
+  return chain_;
+}
+
+#endif
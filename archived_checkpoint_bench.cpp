@@ -0,0 +1,98 @@
+#include "archived_checkpoint.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+class tracking : public archived_defaults
+{
+ public:
+  static const bool track_changes = true;
+};
+
+typedef archive_pool< std::int64_t , tracking > pool_type;
+
+const std::string path = "archived_checkpoint_bench.chain";
+const std::size_t archives = 1000000;
+const std::size_t increments = 10000;
+const std::size_t intervals = 8;
+
+long file_size()
+{
+  std::FILE * const file = std::fopen( path.c_str() , "rb" );
+  std::fseek( file , 0 , SEEK_END );
+  const long size = std::ftell( file );
+  std::fclose( file );
+  return size;
+}
+
+// Many idle archives, a few of which are incremented between
+// checkpoints. A delta costs the changed commits and archives only,
+// a base the whole pool.
+int main ( int argc , const char ** argv )
+{
+  std::remove( path.c_str() );
+
+  pool_type pool;
+  std::vector< pool_type::handle_type > handles;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    handles.push_back( pool.create( std::int64_t( a ) ) );
+  }
+  pool_checkpoint< std::int64_t , tracking > checkpoint( pool , path ,
+                                                         intervals );
+
+  auto start = bench_clock::now();
+  checkpoint.consolidate();
+  const double base_seconds = seconds_since( start );
+  const long base_bytes = file_size();
+
+  std::mt19937_64 random( 1 );
+  double delta_seconds = 0;
+  for( std::size_t interval = 0 ; interval < intervals ; ++interval )
+  {
+    for( std::size_t k = 0 ; k < increments ; ++k )
+    {
+      pool.increment_by( handles[ random() % archives ] , 1 );
+    }
+    start = bench_clock::now();
+    checkpoint.write();
+    delta_seconds += seconds_since( start );
+  }
+  const long delta_bytes = ( file_size() - base_bytes ) / long( intervals );
+
+  std::cout << archives << " archives, " << increments
+            << " increments per checkpoint.\n"
+            << "base: " << base_bytes << " bytes in " << base_seconds * 1e3
+            << " ms\n"
+            << "delta: " << delta_bytes << " bytes in "
+            << delta_seconds / intervals * 1e3 << " ms\n";
+
+  pool_type loaded;
+  pool_checkpoint< std::int64_t , tracking > reader( loaded , path );
+  start = bench_clock::now();
+  reader.load();
+  const double load_seconds = seconds_since( start );
+
+  std::int64_t mismatches = 0;
+  for( std::size_t a = 0 ; a < archives ; a += 101 )
+  {
+    mismatches += loaded.value( handles[ a ] ) != pool.value( handles[ a ] );
+  }
+  std::cout << "load of base and " << checkpoint.chain() << " deltas: "
+            << load_seconds * 1e3 << " ms (" << mismatches
+            << " mismatches)\n";
+
+  std::remove( path.c_str() );
+  return 0;
+}
@@ -0,0 +1,295 @@
+#include "archived_checkpoint.h"
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <sys/resource.h>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// Records changes, as pool_checkpoint needs.
+class tracking : public archived_defaults
+{
+ public:
+  static const bool track_changes = true;
+};
+
+typedef archive_pool< std::int64_t , tracking > pool_type;
+
+const std::string path = "archived_checkpoint_test.chain";
+const std::size_t archives = 1000;
+
+// The values of the archives, destroyed ones as -1.
+std::vector< std::int64_t > values_of
+(
+  pool_type & pool ,
+  const std::vector< pool_type::handle_type > & handles ,
+  const std::vector< bool > & alive
+)
+{
+  std::vector< std::int64_t > result;
+  for( std::size_t a = 0 ; a < handles.size() ; ++a )
+  {
+    result.push_back( alive[ a ] ? pool.value( handles[ a ] ) : -1 );
+  }
+  return result;
+}
+
+// Loads the chain into a new pool and compares it to expected.
+bool check_load
+(
+  const std::vector< pool_type::handle_type > & handles ,
+  const std::vector< bool > & alive ,
+  const std::vector< std::int64_t > & expected ,
+  const std::string & msg
+)
+{
+  pool_type loaded;
+  pool_checkpoint< std::int64_t , tracking > checkpoint( loaded , path );
+  if( !check_equal( true , checkpoint.load() , "Load, " + msg + "." ) )
+  {
+    return false;
+  }
+
+  const auto values = values_of( loaded , handles , alive );
+  for( std::size_t a = 0 ; a < handles.size() ; ++a )
+  {
+    if( values[ a ] != expected[ a ] )
+    {
+      return check_equal( expected[ a ] , values[ a ] ,
+                          "Value after Load, " + msg + "." );
+    }
+  }
+  std::size_t alive_count = 0;
+  for( const bool a : alive ) alive_count += a;
+  return check_equal( alive_count , loaded.archives() ,
+                      "Archives after Load, " + msg + "." );
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::remove( path.c_str() );
+
+  pool_type tested_object_1;
+  pool_checkpoint< std::int64_t , tracking > checkpoint( tested_object_1 ,
+                                                         path , 6 );
+  std::vector< pool_type::handle_type > handles;
+  std::vector< bool > alive( archives , true );
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    handles.push_back( tested_object_1.create( std::int64_t( a ) ) );
+  }
+
+  // Versions keep commits alive in memory, but not in a checkpoint.
+  std::vector< pool_type::version > versions;
+  for( std::size_t a = 0 ; a < archives ; a += 7 )
+  {
+    versions.push_back( tested_object_1.current( handles[ a ] ) );
+  }
+
+  std::cout << "Base. \n";
+
+  checkpoint.write();
+  if( !check_equal( 0 , checkpoint.chain() , "Chain after Base." ) ||
+      !check_load( handles , alive ,
+                   values_of( tested_object_1 , handles , alive ) ,
+                   "Base" ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Deltas. \n";
+
+  for( int round = 1 ; round <= 5 ; ++round )
+  {
+    for( std::size_t a = round ; a < archives ; a += 3 )
+    {
+      if( alive[ a ] )
+      {
+        tested_object_1.increment_by( handles[ a ] , round );
+        tested_object_1.increment_by( handles[ a ] , 2 * round );
+      }
+    }
+    // Compression rewrites and releases commits.
+    for( std::size_t a = 0 ; a < archives ; a += 5 )
+    {
+      if( alive[ a ] )
+      {
+        tested_object_1.value( handles[ a ] );
+      }
+    }
+    for( std::size_t v = 0 ; v < versions.size() ; v += 2 )
+    {
+      diff_to_current( versions[ v ] );
+    }
+    const std::size_t destroyed = ( 97 * round ) % archives;
+    if( alive[ destroyed ] )
+    {
+      tested_object_1.destroy( handles[ destroyed ] );
+      alive[ destroyed ] = false;
+    }
+    const std::size_t reset = ( 31 * round ) % archives;
+    if( alive[ reset ] )
+    {
+      tested_object_1.reset( handles[ reset ] , -round );
+    }
+    handles.push_back( tested_object_1.create( 1000 + round ) );
+    alive.push_back( true );
+
+    checkpoint.write();
+    if( !check_equal( round , checkpoint.chain() , "Chain after Delta." ) ||
+        !check_load( handles , alive ,
+                     values_of( tested_object_1 , handles , alive ) ,
+                     "Delta" ) )
+    {
+      return 1;
+    }
+  }
+
+  std::cout << "Reset All. \n";
+
+  tested_object_1.reset_all( 9 );
+  for( std::size_t a = 0 ; a < handles.size() ; a += 4 )
+  {
+    if( alive[ a ] )
+    {
+      tested_object_1.increment_by( handles[ a ] , std::int64_t( a ) );
+    }
+  }
+  checkpoint.write();
+  if( !check_load( handles , alive ,
+                   values_of( tested_object_1 , handles , alive ) ,
+                   "Reset All" ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Consolidation. \n";
+
+  tested_object_1.increment_by( handles[ 1 ] , 1 );
+  checkpoint.write();
+  if( !check_equal( 0 , checkpoint.chain() , "Chain after Consolidation." ) ||
+      !check_load( handles , alive ,
+                   values_of( tested_object_1 , handles , alive ) ,
+                   "Consolidation" ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Interrupted Delta. \n";
+
+  tested_object_1.increment_by( handles[ 2 ] , 5 );
+  checkpoint.write();
+  const auto before = values_of( tested_object_1 , handles , alive );
+  tested_object_1.increment_by( handles[ 2 ] , 7 );
+  checkpoint.write();
+
+  // Cut the last delta short.
+  std::vector< char > bytes;
+  std::FILE * file = std::fopen( path.c_str() , "rb" );
+  for( int c ; ( c = std::fgetc( file ) ) != EOF ; ) bytes.push_back( char( c ) );
+  std::fclose( file );
+  file = std::fopen( path.c_str() , "wb" );
+  std::fwrite( bytes.data() , 1 , bytes.size() - 5 , file );
+  std::fclose( file );
+
+  if( !check_load( handles , alive , before , "Interrupted Delta" ) )
+  {
+    return 1;
+  }
+  {
+    pool_type loaded;
+    pool_checkpoint< std::int64_t , tracking > resumed( loaded , path );
+    resumed.load();
+    loaded.increment_by( handles[ 2 ] , 3 );
+    resumed.write();
+    if( !check_equal( 0 , resumed.chain() ,
+                      "Chain after Interrupted Delta." ) ||
+        !check_equal( before[ 2 ] + 3 , loaded.value( handles[ 2 ] ) ,
+                      "Value after Interrupted Delta." ) )
+    {
+      return 1;
+    }
+  }
+
+  std::cout << "Failed Delta. \n";
+
+  checkpoint.consolidate();
+  for( std::size_t a = 0 ; a < 100 ; ++a )
+  {
+    if( alive[ a ] ) tested_object_1.increment_by( handles[ a ] , 1 );
+  }
+  // Let the file grow by a few bytes only, so the delta is torn.
+  file = std::fopen( path.c_str() , "rb" );
+  std::fseek( file , 0 , SEEK_END );
+  const long size = std::ftell( file );
+  std::fclose( file );
+  std::signal( SIGXFSZ , SIG_IGN );
+  rlimit limit;
+  getrlimit( RLIMIT_FSIZE , &limit );
+  const rlimit unlimited = limit;
+  limit.rlim_cur = rlim_t( size + 64 );
+  setrlimit( RLIMIT_FSIZE , &limit );
+  bool failed = false;
+  try
+  {
+    checkpoint.write();
+  } catch( const std::runtime_error & ) {
+    failed = true;
+  }
+  setrlimit( RLIMIT_FSIZE , &unlimited );
+  if( !check_equal( true , failed , "Write beyond the File Size Limit." ) )
+  {
+    return 1;
+  }
+
+  tested_object_1.increment_by( handles[ 2 ] , 2 );
+  checkpoint.write();
+  if( !check_equal( 0 , checkpoint.chain() , "Chain after Failed Delta." ) ||
+      !check_load( handles , alive ,
+                   values_of( tested_object_1 , handles , alive ) ,
+                   "Failed Delta" ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Not a Chain. \n";
+
+  file = std::fopen( path.c_str() , "wb" );
+  std::fputs( "not a chain" , file );
+  std::fclose( file );
+  bool thrown = false;
+  try
+  {
+    pool_type loaded;
+    pool_checkpoint< std::int64_t , tracking > broken( loaded , path );
+    broken.load();
+  } catch( const std::runtime_error & ) {
+    thrown = true;
+  }
+  std::remove( path.c_str() );
+  if( !check_equal( true , thrown , "Load of a File that is no Chain." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,309 @@
+#ifndef ARCHIVED_COMPACTOR_H
+#define ARCHIVED_COMPACTOR_H
+
+#include "archived.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+/** @file */
+
+/**
+ @brief Compacts archived<>s in the background, while they are idle.
+
+ # Overview
+
+ Path compression usually happens in diff_to_current(),
+ so the first query after a burst of increments pays for compressing
+ the whole chain. A compactor does that work ahead of time,
+ with archived<>::compact(): it compresses the commits toward the head
+ and, if the archive's Policy::track_references,
+ releases the commits no version can reach.
+
+ Archives are attached together with the mutex that guards them.
+ All use of an attached archive and of its versions has to happen
+ while holding that mutex.
+
+ ## Idle detection:
+
+ Each step() visits one attached archive, round robin.
+ It only compacts an archive that is idle: its mutex is free,
+ and its number of commits did not change since the step before
+ left it, i.e. it was neither incremented nor compressed by a query
+ in between. A busy archive is only looked at, so a foreground thread
+ never waits longer than one step, and under continuous load
+ no compaction work competes with it.
+
+ ## Budget:
+
+ A step compacts an idle archive by at most budget commits.
+ The step that completes a pass also returns the free end of
+ the archive's storage to its pages, see archived<>::compact().
+
+ After start(), a background thread runs steps, pausing between them.
+ After a step that found its archive busy, or once all archives
+ are compacted, it sleeps until the next idle check.
+*/
+class compactor
+{
+ public:
+  typedef std::chrono::steady_clock::duration duration;
+                            /**< @brief Pauses between steps. */
+
+ private:
+  class attachment;
+
+  std::size_t budget_; /**< @internal @brief Commits per step. */
+  duration pause_; /**< @internal @brief Pause between steps. */
+  duration idle_pause_; /**< @internal @brief Pause once all archives
+                             are compacted. */
+  std::mutex attachments_mutex_; /**< @internal @brief Guards attachments_
+                                      and next_. */
+  std::vector< attachment > attachments_; /**< @internal @brief The
+                                               attached archives. */
+  std::size_t next_; /**< @internal @brief The archive of the next step. */
+  bool busy_; /**< @internal @brief Whether the last step found
+                   its archive busy. */
+  std::atomic< bool > stopping_; /**< @internal @brief Tells the
+                                      background thread to finish. */
+  std::thread worker_; /**< @internal @brief The background thread. */
+
+  /**
+   @internal @brief Runs steps until stop() is called.
+  */
+  void run();
+
+ public:
+  /**
+   @brief Constructor. The compactor does not run until start().
+  */
+  explicit compactor
+  (
+    std::size_t
+     budget = 4096 , /**< The commits compacted per step. */
+    duration
+     pause = std::chrono::microseconds( 100 ) , /**< The pause
+                                                      between steps. */
+    duration
+     idle_pause = std::chrono::milliseconds( 10 ) /**< The pause after
+                                                        a busy archive,
+                                                        or once all
+                                                        archives are
+                                                        compacted. */
+  );
+
+  /**
+   @brief Stops the background thread.
+  */
+  ~compactor();
+
+  compactor( const compactor & other ) = delete;
+  compactor & operator= ( const compactor & other ) = delete;
+
+  /**
+   @brief Attaches archive, guarded by mutex.
+   An attached archive must not be moved.
+  */
+  template< class Value , class Policy >
+  void attach
+  (
+    archived< Value , Policy > &
+     archive , /**< The archive to compact. */
+    std::mutex &
+     mutex /**< The mutex guarding archive and its versions. */
+  );
+
+  /**
+   @brief Detaches archive. After detach() returns,
+   the compactor does not touch archive anymore.
+  */
+  template< class Value , class Policy >
+  void detach
+  (
+    archived< Value , Policy > &
+     archive /**< An attached archive. */
+  );
+
+  /**
+   @brief Compacts the next attached archive by at most budget commits,
+   if it is idle.
+
+   @return true, if all attached archives are compacted.
+  */
+  bool step();
+
+  /**
+   @brief Starts running steps in a background thread.
+  */
+  void start();
+
+  /**
+   @brief Stops the background thread.
+  */
+  void stop();
+};
+
+/**
+ @internal @brief An attached archive.
+*/
+class compactor::attachment
+{
+ public:
+  const void * archive_; /**< @internal @brief Identifies the archive. */
+  std::mutex * mutex_; /**< @internal @brief Guards the archive. */
+  std::function< bool( std::size_t ) > compact_; /**< @internal @brief
+                                                      Compacts the archive. */
+  std::function< std::size_t() > commits_; /**< @internal @brief Counts
+                                                the commits of the archive. */
+  std::size_t seen_; /**< @internal @brief The commits when the last
+                          step left the archive. */
+  bool compacted_; /**< @internal @brief Whether the last step
+                        finished the archive. */
+};
+
+
+
+/*
+  Implementation of compactor class members
+*/
+
+inline
+  compactor::compactor
+  (
+    std::size_t
+     budget ,
+    duration
+     pause ,
+    duration
+     idle_pause
+  )
+  : budget_( budget ) ,
+    pause_( pause ) ,
+    idle_pause_( idle_pause ) ,
+    attachments_mutex_() ,
+    attachments_() ,
+    next_( 0 ) ,
+    busy_( false ) ,
+    stopping_( false ) ,
+    worker_()
+{
+}
+
+inline
+  compactor::~compactor()
+{
+  stop();
+}
+
+template< class Value , class Policy >
+ void
+  compactor::attach
+  (
+    archived< Value , Policy > &
+     archive ,
+    std::mutex &
+     mutex
+  )
+{
+  std::lock_guard< std::mutex > lock( attachments_mutex_ );
+  attachments_.push_back( attachment{
+    &archive , &mutex ,
+    [ &archive ]( std::size_t budget ){ return archive.compact( budget ); } ,
+    [ &archive ](){ return archive.commits(); } ,
+    std::numeric_limits< std::size_t >::max() , false } );
+}
+
+template< class Value , class Policy >
+ void
+  compactor::detach
+  (
+    archived< Value , Policy > &
+     archive
+  )
+{
+  std::lock_guard< std::mutex > lock( attachments_mutex_ );
+  for( auto position = attachments_.begin() ;
+       position != attachments_.end() ; ++position )
+  {
+    if( position->archive_ == &archive )
+    {
+      attachments_.erase( position );
+      return;
+    }
+  }
+}
+
+inline
+ bool
+  compactor::step()
+{
+  std::lock_guard< std::mutex > lock( attachments_mutex_ );
+  if( attachments_.empty() )
+  {
+    return true;
+  }
+
+  auto & target = attachments_[ next_++ % attachments_.size() ];
+  std::unique_lock< std::mutex > archive_lock( *target.mutex_ ,
+                                               std::try_to_lock );
+  busy_ = ! archive_lock.owns_lock() || target.commits_() != target.seen_;
+  if( busy_ )
+  {
+    target.compacted_ = false;
+  } else {
+    target.compacted_ = target.compact_( budget_ );
+  }
+  if( archive_lock.owns_lock() )
+  {
+    target.seen_ = target.commits_();
+  }
+
+  for( const auto & current : attachments_ )
+  {
+    if( ! current.compacted_ )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline
+ void
+  compactor::run()
+{
+  while( ! stopping_.load( std::memory_order_relaxed ) )
+  {
+    const bool compacted = step();
+    std::this_thread::sleep_for( compacted || busy_ ? idle_pause_ : pause_ );
+  }
+}
+
+inline
+ void
+  compactor::start()
+{
+  if( ! worker_.joinable() )
+  {
+    stopping_ = false;
+    worker_ = std::thread( [ this ](){ run(); } );
+  }
+}
+
+inline
+ void
+  compactor::stop()
+{
+  if( worker_.joinable() )
+  {
+    stopping_ = true;
+    worker_.join();
+  }
+}
+
+#endif
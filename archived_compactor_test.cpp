@@ -0,0 +1,271 @@
+#include "archived_compactor.h"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// Counts references, so compaction releases garbage.
+class tracking : public archived_defaults
+{
+ public:
+  static const bool track_references = true;
+};
+
+// Counts the bytes of the chunks held.
+class counting_pages : public heap_pages
+{
+ public:
+  static std::size_t held;
+
+  static void * allocate( std::size_t bytes )
+  {
+    held += bytes;
+    return heap_pages::allocate( bytes );
+  }
+
+  static void deallocate( void * memory , std::size_t bytes )
+  {
+    held -= bytes;
+    heap_pages::deallocate( memory , bytes );
+  }
+};
+
+std::size_t counting_pages::held = 0;
+
+class counted : public tracking
+{
+ public:
+  typedef counting_pages pages;
+};
+
+int main ( int argc , const char ** argv )
+{
+  const std::int64_t initial_value = 13 , increments = 1000;
+
+  archived< std::int64_t , tracking > tested_object_1( initial_value );
+  std::mutex mutex_1;
+
+  // Keep every 100th version, drop the others right away.
+  std::vector< archived< std::int64_t , tracking >::version > version_vector;
+  std::vector< std::int64_t > control_values;
+  std::int64_t total = initial_value;
+
+  std::cout << "Increment, Steps. \n";
+
+  for( std::int64_t i = 0 ; i < increments ; ++i )
+  {
+    total += i % 5;
+    const auto new_version = tested_object_1.increment_by( i % 5 );
+    if( i % 100 == 0 )
+    {
+      version_vector.push_back( new_version );
+      control_values.push_back( total );
+    }
+  }
+
+  if( !check_equal( increments + 2 , tested_object_1.commits() ,
+                    "Commits before compaction." ) )
+  {
+    return 1;
+  }
+
+  compactor tested_object_2( 64 );
+  tested_object_2.attach( tested_object_1 , mutex_1 );
+
+  std::int64_t steps = 1;
+  while( ! tested_object_2.step() )
+  {
+    ++steps;
+  }
+
+  // The kept versions, the initial commit and the head.
+  if( !check_equal( std::int64_t( version_vector.size() ) + 2 ,
+                    tested_object_1.commits() ,
+                    "Commits after compaction." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( true , steps > 1 , "Compaction took several steps." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Increment Check, Steps. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    if( !check_equal( total - control_values[ i ] ,
+                      diff_to_current( version_vector[ i ] ) ,
+                      "Diffs to Current, Steps." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( total , tested_object_1.value() , "Value, Steps." ) )
+  {
+    return 1;
+  }
+
+  //Dropped versions are released by the next pass after an increment
+
+  version_vector.resize( 1 );
+  control_values.resize( 1 );
+
+  for( std::int64_t i = 0 ; i < increments ; ++i )
+  {
+    total += 1;
+    tested_object_1.increment_by( 1 );
+  }
+  while( ! tested_object_1.compact( 64 ) )
+  {
+  }
+  if( !check_equal( 3 , tested_object_1.commits() ,
+                    "Commits after dropping versions." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( total - control_values[ 0 ] ,
+                    diff_to_current( version_vector[ 0 ] ) ,
+                    "Diff to Current, Dropped Versions." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Busy Archive. \n";
+
+  {
+    archived< std::int64_t , tracking > busy( 0 );
+    std::mutex busy_mutex;
+    compactor busy_compactor( 64 );
+    busy_compactor.attach( busy , busy_mutex );
+
+    // A step between every two increments finds the archive busy.
+    bool compacted = false;
+    for( std::int64_t i = 0 ; i < increments ; ++i )
+    {
+      busy.increment_by( 1 );
+      compacted = busy_compactor.step() || compacted;
+    }
+    if( !check_equal( false , compacted , "Compacted while busy." ) ||
+        !check_equal( increments + 2 , busy.commits() ,
+                      "Commits while busy." ) )
+    {
+      return 1;
+    }
+    while( ! busy_compactor.step() )
+    {
+    }
+    if( !check_equal( 2 , busy.commits() , "Commits once idle." ) )
+    {
+      return 1;
+    }
+  }
+
+  std::cout << "Trimmed Storage. \n";
+
+  {
+    archived< std::int64_t , counted > trimmed( 0 );
+    for( std::int64_t i = 0 ; i < 100 * increments ; ++i )
+    {
+      trimmed.increment_by( 1 );
+    }
+    const auto grown = counting_pages::held;
+    // The first pass frees the history behind the head,
+    // the next one the old head at the end of the storage.
+    while( ! trimmed.compact( 4096 ) )
+    {
+    }
+    trimmed.increment_by( 1 );
+    while( ! trimmed.compact( 4096 ) )
+    {
+    }
+    std::cout << "Chunks held: " << grown << " bytes before, "
+              << counting_pages::held << " bytes after compaction. \n";
+    if( !check_equal( true , counting_pages::held * 100 < grown ,
+                      "Storage returned by compaction." ) ||
+        !check_equal( 100 * increments + 1 , trimmed.value() ,
+                      "Value after trimming." ) )
+    {
+      return 1;
+    }
+    for( std::int64_t i = 0 ; i < increments ; ++i )
+    {
+      trimmed.increment_by( 1 );
+    }
+    if( !check_equal( 101 * increments + 1 , trimmed.value() ,
+                      "Value after growing again." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Background thread
+
+  std::cout << "Increment, Background. \n";
+
+  tested_object_2.start();
+
+  for( std::int64_t i = 0 ; i < increments ; ++i )
+  {
+    std::lock_guard< std::mutex > lock( mutex_1 );
+    total += 2;
+    tested_object_1.increment_by( 2 );
+  }
+
+  std::size_t commits = 0;
+  for( int wait = 0 ; wait < 2000 ; ++wait )
+  {
+    {
+      std::lock_guard< std::mutex > lock( mutex_1 );
+      commits = tested_object_1.commits();
+    }
+    if( commits == 3 )
+    {
+      break;
+    }
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+
+  tested_object_2.detach( tested_object_1 );
+  tested_object_2.stop();
+
+  if( !check_equal( 3 , commits , "Commits after background compaction." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( total - control_values[ 0 ] ,
+                    diff_to_current( version_vector[ 0 ] ) ,
+                    "Diff to Current, Background." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( total , tested_object_1.value() , "Value, Background." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include "archived.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// Counts references, as adaptive_compression needs.
+template< class Compression >
+class compression_policy : public archived_defaults
+{
+ public:
+  typedef Compression compression;
+  static const bool track_references = true;
+};
+
+const std::size_t rounds = 20000;
+
+// A version is taken, a burst of increments follows,
+// and the version is queried once and dropped.
+template< class Archive >
+double one_shot( std::int64_t & check )
+{
+  Archive archive( 0 );
+  double elapsed = 0;
+  for( std::size_t round = 0 ; round < rounds ; ++round )
+  {
+    const auto version = archive.current();
+    for( int i = 0 ; i < 64 ; ++i )
+    {
+      archive.increment_by( i );
+    }
+    const auto start = bench_clock::now();
+    check += diff_to_current( version );
+    elapsed += seconds_since( start );
+  }
+  return elapsed;
+}
+
+// One version is queried after every increment.
+template< class Archive >
+double repeated( std::int64_t & check )
+{
+  Archive archive( 0 );
+  const auto version = archive.current();
+  double elapsed = 0;
+  for( std::size_t round = 0 ; round < rounds ; ++round )
+  {
+    archive.increment_by( 1 );
+    const auto start = bench_clock::now();
+    check += diff_to_current( version );
+    elapsed += seconds_since( start );
+  }
+  return elapsed;
+}
+
+// 64 consumers take turns: each queries the increments
+// since its last turn and takes a new version.
+template< class Archive >
+double many_consumers( std::int64_t & check )
+{
+  Archive archive( 0 );
+  std::vector< typename Archive::version_type > consumers;
+  for( int c = 0 ; c < 64 ; ++c )
+  {
+    consumers.push_back( archive.current() );
+    archive.increment_by( 1 );
+  }
+  double elapsed = 0;
+  for( std::size_t round = 0 ; round < rounds ; ++round )
+  {
+    for( int i = 0 ; i < 4 ; ++i )
+    {
+      archive.increment_by( i );
+    }
+    auto & consumer = consumers[ round % consumers.size() ];
+    const auto start = bench_clock::now();
+    check += diff_to_current( consumer );
+    elapsed += seconds_since( start );
+    consumer = archive.current();
+  }
+  return elapsed;
+}
+
+const std::size_t cold_increments = 100000;
+const std::size_t cold_rounds = 20;
+
+// A version is queried for the first time after a long history,
+// which a compressing walk pays for at once.
+// Returns the slowest query, increment_seconds the increments.
+template< class Archive >
+double cold( std::int64_t & check , double & increment_seconds )
+{
+  Archive archive( 0 );
+  double worst = 0;
+  for( std::size_t round = 0 ; round < cold_rounds ; ++round )
+  {
+    const auto version = archive.current();
+    auto start = bench_clock::now();
+    for( std::size_t i = 0 ; i < cold_increments ; ++i )
+    {
+      archive.increment_by( 1 );
+    }
+    increment_seconds += seconds_since( start );
+    start = bench_clock::now();
+    check += diff_to_current( version );
+    worst = std::max( worst , seconds_since( start ) );
+  }
+  return worst;
+}
+
+template< class Compression >
+void run( const std::string & name )
+{
+  typedef archived< std::int64_t , compression_policy< Compression > >
+    archive_type;
+
+  std::int64_t check = 0;
+  const double once = one_shot< archive_type >( check );
+  const double again = repeated< archive_type >( check );
+  const double many = many_consumers< archive_type >( check );
+  double increments = 0;
+  const double worst = cold< archive_type >( check , increments );
+  std::cout << name << ": one-shot " << once * 1e9 / rounds
+            << " ns/query, repeated " << again * 1e9 / rounds
+            << " ns/query, many consumers " << many * 1e9 / rounds
+            << " ns/query, cold query at worst " << worst * 1e6
+            << " us after increments of "
+            << increments * 1e9 / ( cold_rounds * cold_increments )
+            << " ns (check " << check << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << rounds << " queries per workload.\n";
+
+  for( int repetition = 0 ; repetition < 2 ; ++repetition )
+  {
+    run< full_compression >( "full compression" );
+    run< path_halving >( "path halving" );
+    run< path_splitting >( "path splitting" );
+    run< no_compression >( "no compression" );
+    run< adaptive_compression >( "adaptive compression" );
+    run< deamortized_compression >( "deamortized compression" );
+  }
+
+  return 0;
+}
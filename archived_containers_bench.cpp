@@ -0,0 +1,90 @@
+#include "archived.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+typedef archived< std::int64_t > counter;
+
+const std::size_t counters = 1000000;
+const std::size_t increments = 10000000;
+
+counter & at( std::vector< counter > & all , std::size_t index )
+{
+  return all[ index ];
+}
+
+counter & at( std::vector< std::unique_ptr< counter > > & all ,
+              std::size_t index )
+{
+  return *all[ index ];
+}
+
+// Counters are incremented in random order, then all are read in order.
+template< class Container , class Make >
+void run( const char * name , Make make )
+{
+  auto start = bench_clock::now();
+  Container all;
+  all.reserve( counters );
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    all.push_back( make() );
+  }
+  const double built = seconds_since( start );
+
+  std::mt19937_64 random( 1 );
+  std::vector< std::uint32_t > order( increments );
+  for( auto & index : order )
+  {
+    index = static_cast< std::uint32_t >( random() % counters );
+  }
+
+  start = bench_clock::now();
+  for( const auto index : order )
+  {
+    at( all , index ).increment_by( 1 );
+  }
+  const double incremented = seconds_since( start );
+
+  start = bench_clock::now();
+  std::int64_t total = 0;
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    total += at( all , c ).value();
+  }
+  const double read = seconds_since( start );
+
+  std::cout << name << ": built in " << built * 1e3 << " ms, "
+            << incremented * 1e9 / increments << " ns/random increment, "
+            << read * 1e9 / counters << " ns/value in order"
+            << " (total " << total << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << counters << " counters, " << increments
+            << " increments.\n";
+
+  for( int repetition = 0 ; repetition < 2 ; ++repetition )
+  {
+    run< std::vector< std::unique_ptr< counter > > >(
+      "std::vector of std::unique_ptr" ,
+      [](){ return std::unique_ptr< counter >( new counter( 0 ) ); } );
+    run< std::vector< counter > >(
+      "std::vector of archived<>" ,
+      [](){ return counter( 0 ); } );
+  }
+
+  return 0;
+}
@@ -0,0 +1,256 @@
+#ifndef ARCHIVED_EWMA_H
+#define ARCHIVED_EWMA_H
+
+#include "archived.h"
+#include "archived_seqlock.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+/** @file */
+
+/**
+ @brief Exponentially decaying aggregates of the increments of an archived<>.
+
+ # Overview
+
+ An ewma_view<Value,Averages,Clock> increments an archived<Value>
+ and keeps, for Averages half-lives at once, the exponentially decayed
+ sum of all increments:
+ every increment contributes its value, halved per elapsed half-life.
+
+ The decayed sums are updated on each increment_by() in O(Averages),
+ so every increment is seen, however short the burst.
+ Dividing a decayed sum by its mean lifetime yields the exponentially
+ weighted moving average of the increment rate, see rates().
+
+ ## Readers:
+
+ The sums are published through a seqlock<>.
+ decayed_sums() and rates() may be called from any thread
+ concurrently with increment_by(), without locking and without
+ touching the archived<>.
+
+ increment_by() itself must not be called concurrently.
+ Value has to be convertible to double.
+*/
+template< class Value , std::size_t Averages ,
+          class Clock = std::chrono::steady_clock >
+class ewma_view
+{
+ public:
+  typedef archived< Value > archive_type; /**< @brief The archive's type. */
+  typedef typename archive_type::version_type version_type;
+                                    /**< @brief The type of versions. */
+  typedef typename Clock::time_point time_point; /**< @brief Timestamps. */
+  typedef typename Clock::duration duration; /**< @brief Half-lives. */
+  typedef std::array< double , Averages > averages_type;
+                                    /**< @brief One result per half-life. */
+
+ private:
+  class snapshot;
+
+  archive_type & archive_; /**< @internal @brief The incremented archive. */
+  averages_type decay_; /**< @internal @brief Decay constants,
+                             ln(2) per half-life, in 1 / tick. */
+  seqlock< snapshot > published_; /**< @internal @brief The sums,
+                                       for readers. */
+
+  /**
+   @internal @brief Returns the sums of snapshot decayed to time now.
+   Times before the snapshot count as the snapshot time.
+  */
+  averages_type decayed
+  (
+    const snapshot &
+     state , /**< The sums and their time. */
+    time_point
+     now /**< The time to decay to. */
+  ) const;
+
+ public:
+  /**
+   @brief Constructor that attaches to archive.
+   The decayed sums start at zero at time start.
+  */
+  ewma_view
+  (
+    archive_type &
+     archive , /**< The archive to increment. */
+    const std::array< duration , Averages > &
+     half_lives , /**< The half-lives of the averages. */
+    time_point
+     start = Clock::now() /**< The time the sums start. */
+  );
+
+  ewma_view( const ewma_view & other ) = delete;
+  ewma_view & operator= ( const ewma_view & other ) = delete;
+
+  /**
+   @brief Increments the archive by increment at time now
+   and adds increment to every decayed sum.
+
+   @return The version returned by the archive.
+  */
+  version_type increment_by
+  (
+    const Value &
+     increment , /**< The value to increment by. */
+    time_point
+     now = Clock::now() /**< The time of the increment. */
+  );
+
+  /**
+   @brief Returns the decayed sums of all increments at time now.
+   Lock-free, may be called from any thread.
+
+   @return The decayed sum per half-life.
+  */
+  averages_type decayed_sums
+  (
+    time_point
+     now = Clock::now() /**< The time to evaluate at. */
+  ) const;
+
+  /**
+   @brief Returns the moving averages of the increment rate
+   at time now, in increments per second.
+   Lock-free, may be called from any thread.
+
+   @return The average rate per half-life.
+  */
+  averages_type rates
+  (
+    time_point
+     now = Clock::now() /**< The time to evaluate at. */
+  ) const;
+};
+
+/**
+ @internal @brief The decayed sums at a point in time.
+*/
+template< class Value , std::size_t Averages , class Clock >
+class ewma_view< Value , Averages , Clock >::snapshot
+{
+ public:
+  double sums_[ Averages ]; /**< @internal @brief The decayed sums. */
+  typename duration::rep time_; /**< @internal @brief Time of the sums. */
+};
+
+
+
+/*
+  Implementation of ewma_view<> class members
+*/
+
+template< class Value , std::size_t Averages , class Clock >
+  ewma_view< Value , Averages , Clock >::ewma_view
+  (
+    archive_type &
+     archive ,
+    const std::array< duration , Averages > &
+     half_lives ,
+    time_point
+     start
+  )
+  : archive_( archive ) ,
+    decay_() ,
+    published_()
+{
+  for( std::size_t i = 0 ; i < Averages ; ++i )
+  {
+    decay_[ i ] = std::log( 2.0 ) /
+                  static_cast< double >( half_lives[ i ].count() );
+  }
+
+  snapshot initial = {};
+  initial.time_ = start.time_since_epoch().count();
+  published_.store( initial );
+}
+
+template< class Value , std::size_t Averages , class Clock >
+ typename ewma_view< Value , Averages , Clock >::averages_type
+  ewma_view< Value , Averages , Clock >::decayed
+  (
+    const snapshot &
+     state ,
+    time_point
+     now
+  ) const
+{
+  auto elapsed = now.time_since_epoch().count() - state.time_;
+  if( elapsed < 0 )
+  {
+    elapsed = 0;
+  }
+
+  averages_type result;
+  for( std::size_t i = 0 ; i < Averages ; ++i )
+  {
+    result[ i ] = state.sums_[ i ] *
+                  std::exp( -decay_[ i ] * static_cast< double >( elapsed ) );
+  }
+  return result;
+}
+
+template< class Value , std::size_t Averages , class Clock >
+ typename ewma_view< Value , Averages , Clock >::version_type
+  ewma_view< Value , Averages , Clock >::increment_by
+  (
+    const Value &
+     increment ,
+    time_point
+     now
+  )
+{
+  // Only this thread stores, so the published sums are current.
+  auto state = published_.load();
+  const auto sums = decayed( state , now );
+
+  for( std::size_t i = 0 ; i < Averages ; ++i )
+  {
+    state.sums_[ i ] = sums[ i ] + static_cast< double >( increment );
+  }
+  const auto time = now.time_since_epoch().count();
+  if( time > state.time_ )
+  {
+    state.time_ = time;
+  }
+  published_.store( state );
+
+  return archive_.increment_by( increment );
+}
+
+template< class Value , std::size_t Averages , class Clock >
+ typename ewma_view< Value , Averages , Clock >::averages_type
+  ewma_view< Value , Averages , Clock >::decayed_sums
+  (
+    time_point
+     now
+  ) const
+{
+  return decayed( published_.load() , now );
+}
+
+template< class Value , std::size_t Averages , class Clock >
+ typename ewma_view< Value , Averages , Clock >::averages_type
+  ewma_view< Value , Averages , Clock >::rates
+  (
+    time_point
+     now
+  ) const
+{
+  const double ticks_per_second =
+    static_cast< double >( duration::period::den ) / duration::period::num;
+
+  auto result = decayed_sums( now );
+  for( std::size_t i = 0 ; i < Averages ; ++i )
+  {
+    // A decayed sum over a constant rate r converges to r / decay.
+    result[ i ] *= decay_[ i ] * ticks_per_second;
+  }
+  return result;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "archived_ewma.h"
+
+#include <cmath>
+#include <vector>
+#include <iostream>
+
+bool check_close( double a , double b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( std::fabs( a - b ) <= 1e-9 * ( 1.0 + std::fabs( a ) ) )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+typedef std::chrono::steady_clock test_clock;
+
+test_clock::time_point at_second( double s )
+{
+  return test_clock::time_point(
+    std::chrono::duration_cast< test_clock::duration >(
+      std::chrono::duration< double >( s ) ) );
+}
+
+int main ( int argc , const char ** argv )
+{
+  // provide the test data: increments and their times in seconds
+  std::vector<int> test_data = { 3 , 4 , 7 , 9 , 4 , 5 , 7 , 94 };
+  std::vector<double> test_times = { 0.5 , 0.5 , 1 , 2 , 4 , 4.25 , 8 , 9 };
+  const std::array< double , 2 > half_lives = { { 1.0 , 10.0 } };
+
+  archived<int> tested_archive( 13 );
+  ewma_view< int , 2 > tested_object_1(
+    tested_archive ,
+    { { std::chrono::seconds( 1 ) , std::chrono::seconds( 10 ) } } ,
+    at_second( 0 ) );
+
+  //Check if the sums start at zero
+  if( !check_close( 0.0 , tested_object_1.decayed_sums( at_second( 1 ) )[ 0 ] ,
+                    "Sum after construction." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Increment. \n";
+
+  const auto start = tested_archive.current();
+  for( std::size_t i = 0 ; i < test_data.size() ; ++i )
+  {
+    tested_object_1.increment_by( test_data[ i ] , at_second( test_times[ i ] ) );
+  }
+
+  std::cout << "Increment Check. \n";
+
+  //The archive sees every increment
+  if( !check_close( 133 , diff_to_current( start ) ,
+                    "Diff to Current of the archive." ) )
+  {
+    return 1;
+  }
+
+  //Compare with the sums computed from scratch
+  for( double now : { 9.0 , 10.0 , 30.0 } )
+  {
+    const auto sums = tested_object_1.decayed_sums( at_second( now ) );
+    const auto rates = tested_object_1.rates( at_second( now ) );
+
+    for( std::size_t k = 0 ; k < half_lives.size() ; ++k )
+    {
+      double control = 0.0;
+      for( std::size_t i = 0 ; i < test_data.size() ; ++i )
+      {
+        control += test_data[ i ] *
+                   std::pow( 0.5 , ( now - test_times[ i ] ) / half_lives[ k ] );
+      }
+
+      if( !check_close( control , sums[ k ] , "Decayed sum." ) ||
+          !check_close( control * std::log( 2.0 ) / half_lives[ k ] ,
+                        rates[ k ] , "Rate." ) )
+      {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,502 @@
+#ifndef ARCHIVED_HISTOGRAM_H
+#define ARCHIVED_HISTOGRAM_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+/** @file */
+
+/**
+ @brief A histogram with a fixed number of buckets.
+
+ # Overview
+
+ A histogram<Buckets,Count> is a value type for archived<> that counts
+ samples in Buckets buckets.
+ operator+= adds the bucket counts of two histograms.
+
+ ## Storage:
+
+ A histogram stores its non-zero buckets sparsely, as sorted
+ bucket/count pairs, as long as these take less than half the bytes
+ of a dense array, which leaves room for the vector's growth.
+ Otherwise it switches to a dense array of Buckets counts.
+
+ A commit that records a few samples thus costs a few pairs
+ instead of Buckets counts.
+ Dense histograms are added with AVX2, if compiled for it,
+ e.g. with -mavx2. archived_histogram_bench compares that
+ with the generic version.
+
+ ## Queries:
+
+ Percentiles are computed directly on either representation,
+ so the result of diff_to_current() is never densified for a query.
+*/
+template< std::size_t Buckets , class Count = std::uint64_t >
+class histogram
+{
+ public:
+  typedef std::size_t size_type; /**< @brief The type of bucket indices. */
+  typedef Count count_type; /**< @brief The type of bucket counts. */
+
+ private:
+  typedef std::pair< size_type , Count > entry_type;
+                            /**< @internal @brief A non-zero bucket. */
+  typedef std::vector< entry_type > sparse_type;
+                            /**< @internal @brief Sorted non-zero buckets. */
+  typedef std::vector< Count > dense_type;
+                            /**< @internal @brief Counts of all buckets. */
+
+  static const size_type dense_threshold =
+    ( Buckets * sizeof( Count ) ) / ( 2 * sizeof( entry_type ) ) + 1;
+                            /**< @internal @brief Number of sparse entries
+                                 at which the dense array is used. */
+
+  sparse_type sparse_; /**< @internal @brief The non-zero buckets,
+                            if the histogram is sparse. */
+  dense_type dense_; /**< @internal @brief All buckets,
+                          if the histogram is dense, empty otherwise. */
+  Count total_; /**< @internal @brief The sum of all buckets. */
+
+  /**
+   @internal @brief Switches to the dense representation.
+  */
+  void densify();
+
+  /**
+   @internal @brief Adds the sparse entries to the dense array.
+  */
+  void scatter
+  (
+    const sparse_type &
+     entries /**< The entries to add. */
+  );
+
+  /**
+   @internal @brief Adds count n from source to destination.
+   Generic version, left to the compiler's vectorizer.
+  */
+  template< class Element >
+  static void add_dense
+  (
+    Element *
+     destination , /**< The counts that are incremented. */
+    const Element *
+     source , /**< The increments. */
+    size_type
+     n /**< The number of counts. */
+  );
+
+#if defined( __AVX2__ )
+  /**
+   @internal @brief Adds count n from source to destination.
+   AVX2 version for 64 bit counts.
+  */
+  static void add_dense
+  (
+    std::uint64_t *
+     destination , /**< The counts that are incremented. */
+    const std::uint64_t *
+     source , /**< The increments. */
+    size_type
+     n /**< The number of counts. */
+  );
+
+  /**
+   @internal @brief Adds count n from source to destination.
+   AVX2 version for 32 bit counts.
+  */
+  static void add_dense
+  (
+    std::uint32_t *
+     destination , /**< The counts that are incremented. */
+    const std::uint32_t *
+     source , /**< The increments. */
+    size_type
+     n /**< The number of counts. */
+  );
+#endif
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed histogram is empty and sparse.
+  */
+  histogram();
+
+  /**
+   @brief Adds n samples to bucket.
+   bucket has to be less than Buckets.
+  */
+  void record
+  (
+    size_type
+     bucket , /**< The bucket. */
+    Count
+     n = 1 /**< The number of samples. */
+  );
+
+  /**
+   @brief Adds the buckets of other to the buckets of *this.
+
+   @return A reference to *this
+  */
+  histogram & operator+=
+  (
+    const histogram &
+     other /**< The histogram to add. */
+  );
+
+  /**
+   @brief Returns the count of a bucket.
+
+   @return The count of bucket.
+  */
+  Count count
+  (
+    size_type
+     bucket /**< The bucket. */
+  ) const;
+
+  /**
+   @brief Returns the number of samples in all buckets.
+
+   @return The sum of all buckets.
+  */
+  Count total() const;
+
+  /**
+   @brief Returns the bucket containing the given percentile.
+   This is the smallest bucket such that at least
+   the fraction q of all samples lies in it or below.
+   An empty histogram returns bucket 0.
+
+   @return The bucket of the q-th percentile.
+  */
+  size_type percentile
+  (
+    double
+     q /**< The fraction of samples, in [0,1]. */
+  ) const;
+
+  /**
+   @brief Checks whether the histogram uses the dense representation.
+
+   @return true, if the histogram is dense.
+  */
+  bool is_dense() const;
+};
+
+/**
+ @brief An archived<> of histograms.
+ Each commit stores only the buckets it changed.
+*/
+template< std::size_t Buckets , class Count = std::uint64_t >
+using histogram_archive = archived< histogram< Buckets , Count > >;
+
+
+
+/*
+  Implementation of histogram<> class members
+*/
+
+template< std::size_t Buckets , class Count >
+  histogram< Buckets , Count >::histogram()
+  : sparse_() ,
+    dense_() ,
+    total_()
+{
+}
+
+template< std::size_t Buckets , class Count >
+ void
+  histogram< Buckets , Count >::densify()
+{
+  dense_.assign( Buckets , Count() );
+  scatter( sparse_ );
+  sparse_type().swap( sparse_ );
+}
+
+template< std::size_t Buckets , class Count >
+ void
+  histogram< Buckets , Count >::scatter
+  (
+    const sparse_type &
+     entries
+  )
+{
+  for( const auto & entry : entries )
+  {
+    dense_[ entry.first ] += entry.second;
+  }
+}
+
+template< std::size_t Buckets , class Count >
+template< class Element >
+ void
+  histogram< Buckets , Count >::add_dense
+  (
+    Element *
+     destination ,
+    const Element *
+     source ,
+    size_type
+     n
+  )
+{
+  for( size_type i = 0 ; i < n ; ++i )
+  {
+    destination[ i ] += source[ i ];
+  }
+}
+
+#if defined( __AVX2__ )
+template< std::size_t Buckets , class Count >
+ void
+  histogram< Buckets , Count >::add_dense
+  (
+    std::uint64_t *
+     destination ,
+    const std::uint64_t *
+     source ,
+    size_type
+     n
+  )
+{
+  size_type i = 0;
+  for( ; i + 4 <= n ; i += 4 )
+  {
+    const auto d = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( destination + i ) );
+    const auto s = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( source + i ) );
+    _mm256_storeu_si256( reinterpret_cast< __m256i * >( destination + i ) ,
+                         _mm256_add_epi64( d , s ) );
+  }
+  for( ; i < n ; ++i )
+  {
+    destination[ i ] += source[ i ];
+  }
+}
+
+template< std::size_t Buckets , class Count >
+ void
+  histogram< Buckets , Count >::add_dense
+  (
+    std::uint32_t *
+     destination ,
+    const std::uint32_t *
+     source ,
+    size_type
+     n
+  )
+{
+  size_type i = 0;
+  for( ; i + 8 <= n ; i += 8 )
+  {
+    const auto d = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( destination + i ) );
+    const auto s = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( source + i ) );
+    _mm256_storeu_si256( reinterpret_cast< __m256i * >( destination + i ) ,
+                         _mm256_add_epi32( d , s ) );
+  }
+  for( ; i < n ; ++i )
+  {
+    destination[ i ] += source[ i ];
+  }
+}
+#endif
+
+template< std::size_t Buckets , class Count >
+ void
+  histogram< Buckets , Count >::record
+  (
+    size_type
+     bucket ,
+    Count
+     n
+  )
+{
+  total_ += n;
+
+  if( is_dense() )
+  {
+    dense_[ bucket ] += n;
+    return;
+  }
+
+  const auto position =
+    std::lower_bound( sparse_.begin() , sparse_.end() , bucket ,
+                      []( const entry_type & entry , size_type b )
+                      {
+                        return entry.first < b;
+                      } );
+
+  if( position != sparse_.end() && position->first == bucket )
+  {
+    position->second += n;
+  } else {
+    sparse_.insert( position , entry_type( bucket , n ) );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+}
+
+template< std::size_t Buckets , class Count >
+ histogram< Buckets , Count > &
+  histogram< Buckets , Count >::operator+=
+  (
+    const histogram< Buckets , Count > &
+     other
+  )
+{
+  if( other.is_dense() )
+  {
+    if( is_dense() )
+    {
+      add_dense( dense_.data() , other.dense_.data() , Buckets );
+    } else {
+      // The sum is dense anyway: start from the dense operand.
+      sparse_type entries;
+      entries.swap( sparse_ );
+      dense_ = other.dense_;
+      scatter( entries );
+    }
+  } else if( is_dense() ) {
+    scatter( other.sparse_ );
+  } else if( ! other.sparse_.empty() ) {
+    sparse_type merged;
+    merged.reserve( sparse_.size() + other.sparse_.size() );
+
+    auto mine = sparse_.cbegin();
+    auto theirs = other.sparse_.cbegin();
+    const auto mine_end = sparse_.cend();
+    const auto theirs_end = other.sparse_.cend();
+
+    while( mine != mine_end && theirs != theirs_end )
+    {
+      if( mine->first < theirs->first )
+      {
+        merged.push_back( *mine++ );
+      } else if( theirs->first < mine->first ) {
+        merged.push_back( *theirs++ );
+      } else {
+        merged.push_back( entry_type( mine->first ,
+                                      mine->second + theirs->second ) );
+        ++mine;
+        ++theirs;
+      }
+    }
+    merged.insert( merged.end() , mine , mine_end );
+    merged.insert( merged.end() , theirs , theirs_end );
+
+    sparse_.swap( merged );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+
+  total_ += other.total_;
+  return *this;
+}
+
+template< std::size_t Buckets , class Count >
+ Count
+  histogram< Buckets , Count >::count
+  (
+    size_type
+     bucket
+  ) const
+{
+  if( is_dense() )
+  {
+    return dense_[ bucket ];
+  }
+
+  const auto position =
+    std::lower_bound( sparse_.begin() , sparse_.end() , bucket ,
+                      []( const entry_type & entry , size_type b )
+                      {
+                        return entry.first < b;
+                      } );
+
+  if( position != sparse_.end() && position->first == bucket )
+  {
+    return position->second;
+  }
+  return Count();
+}
+
+template< std::size_t Buckets , class Count >
+ Count
+  histogram< Buckets , Count >::total() const
+{
+  return total_;
+}
+
+template< std::size_t Buckets , class Count >
+ typename histogram< Buckets , Count >::size_type
+  histogram< Buckets , Count >::percentile
+  (
+    double
+     q
+  ) const
+{
+  if( total_ == Count() )
+  {
+    return 0;
+  }
+
+  // Rank of the sample that has to be covered, in [1,total_].
+  double rank = std::ceil( q * static_cast< double >( total_ ) );
+  if( rank < 1.0 )
+  {
+    rank = 1.0;
+  }
+
+  double seen = 0.0;
+  if( is_dense() )
+  {
+    for( size_type bucket = 0 ; bucket < Buckets ; ++bucket )
+    {
+      seen += static_cast< double >( dense_[ bucket ] );
+      if( seen >= rank )
+      {
+        return bucket;
+      }
+    }
+  } else {
+    for( const auto & entry : sparse_ )
+    {
+      seen += static_cast< double >( entry.second );
+      if( seen >= rank )
+      {
+        return entry.first;
+      }
+    }
+  }
+  return Buckets - 1;
+}
+
+template< std::size_t Buckets , class Count >
+ bool
+  histogram< Buckets , Count >::is_dense() const
+{
+  return ! dense_.empty();
+}
+
+#endif
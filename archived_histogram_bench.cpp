@@ -0,0 +1,101 @@
+#include "archived_histogram.h"
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// Not a multiple of the lanes, so the scalar tails are added too.
+const std::size_t buckets = 1003;
+const std::size_t histograms = 1000;
+const std::size_t samples = 2000;
+const std::size_t rounds = 50;
+
+// Signed counts take the generic add_dense(), unsigned ones
+// the AVX2 versions if compiled with AVX2, so both sum the same samples.
+template< class Count >
+std::vector< histogram< buckets , Count > > filled()
+{
+  std::mt19937_64 random( 1 );
+  std::vector< histogram< buckets , Count > > result( histograms );
+  for( auto & current : result )
+  {
+    for( std::size_t s = 0 ; s < samples ; ++s )
+    {
+      current.record( random() % buckets , Count( 1 + random() % 3 ) );
+    }
+  }
+  return result;
+}
+
+template< class Count >
+histogram< buckets , Count > summed
+(
+  const std::vector< histogram< buckets , Count > > & parts ,
+  double & seconds
+)
+{
+  histogram< buckets , Count > sum = parts.front();
+  const auto start = bench_clock::now();
+  for( std::size_t round = 0 ; round < rounds ; ++round )
+  {
+    for( const auto & part : parts )
+    {
+      sum += part;
+    }
+  }
+  seconds = seconds_since( start );
+  return sum;
+}
+
+template< class Simd , class Scalar >
+bool compare( const char * name )
+{
+  const auto simd_parts = filled< Simd >();
+  const auto scalar_parts = filled< Scalar >();
+  double simd_seconds = 0 , scalar_seconds = 0;
+  const auto simd = summed( simd_parts , simd_seconds );
+  const auto scalar = summed( scalar_parts , scalar_seconds );
+
+  std::size_t mismatches = 0;
+  for( std::size_t b = 0 ; b < buckets ; ++b )
+  {
+    mismatches += simd.count( b ) != Simd( scalar.count( b ) );
+  }
+  mismatches += simd.total() != Simd( scalar.total() );
+
+  const double adds = double( rounds * histograms );
+  std::cout << name << ", dense: " << simd_parts.front().is_dense()
+            << ", unsigned: " << simd_seconds / adds * 1e9
+            << " ns per add, signed: " << scalar_seconds / adds * 1e9
+            << " ns per add (" << mismatches << " mismatches)\n";
+  return mismatches == 0;
+}
+
+// Adds dense histograms with both versions of add_dense()
+// and checks that they agree.
+int main ( int argc , const char ** argv )
+{
+#if defined( __AVX2__ )
+  std::cout << "AVX2 add_dense().\n";
+#else
+  std::cout << "No AVX2, generic add_dense() only.\n";
+#endif
+  std::cout << histograms << " histograms of " << buckets
+            << " buckets, added " << rounds << " times.\n";
+
+  if( ! compare< std::uint64_t , std::int64_t >( "64 bit counts" ) ||
+      ! compare< std::uint32_t , std::int32_t >( "32 bit counts" ) )
+  {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "archived_histogram.h"
+
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::uint64_t a , std::uint64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+const std::size_t buckets = 64;
+typedef histogram< buckets > tested_histogram;
+
+// Reference percentile on plain bucket counts.
+std::size_t control_percentile( const std::vector<std::uint64_t> & counts ,
+                                double q )
+{
+  std::uint64_t total = 0;
+  for( auto c : counts ) total += c;
+  if( total == 0 ) return 0;
+
+  double rank = std::ceil( q * total );
+  if( rank < 1.0 ) rank = 1.0;
+
+  double seen = 0.0;
+  for( std::size_t b = 0 ; b < counts.size() ; ++b )
+  {
+    seen += counts[ b ];
+    if( seen >= rank ) return b;
+  }
+  return counts.size() - 1;
+}
+
+int main ( int argc , const char ** argv )
+{
+  //Test constructor
+  histogram_archive< buckets > tested_object_1( ( tested_histogram() ) );
+
+  if( !check_equal( 0 , tested_object_1.value().total() ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Test the increment and calculation of diff;
+  std::vector< histogram_archive< buckets >::version > version_vector;
+  std::vector< std::vector<std::uint64_t> > control_values;
+
+  version_vector.push_back( tested_object_1.current() );
+  control_values.push_back( std::vector<std::uint64_t>( buckets ) );
+
+  std::cout << "Increment, First Run. \n";
+
+  for( std::size_t step = 0 ; step < 40 ; ++step )
+  {
+    tested_histogram increment;
+    increment.record( ( step * 7 ) % buckets , step + 1 );
+    increment.record( ( step * 13 + 5 ) % buckets );
+
+    version_vector.push_back( tested_object_1.increment_by( increment ) );
+
+    for( auto & control : control_values )
+    {
+      control[ ( step * 7 ) % buckets ] += step + 1;
+      control[ ( step * 13 + 5 ) % buckets ] += 1;
+    }
+    control_values.push_back( std::vector<std::uint64_t>( buckets ) );
+  }
+
+  std::cout << "Increment Check, First Run. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    const auto diff = diff_to_current( version_vector[ i ] );
+
+    for( std::size_t b = 0 ; b < buckets ; ++b )
+    {
+      if( diff.count( b ) != control_values[ i ][ b ] )
+      {
+        return !check_equal( control_values[ i ][ b ] , diff.count( b ) ,
+                             "Bucket of Diff to Current, First Run." );
+      }
+    }
+
+    for( double q : { 0.0 , 0.25 , 0.5 , 0.9 , 0.99 , 1.0 } )
+    {
+      if( !check_equal( control_percentile( control_values[ i ] , q ) ,
+                        diff.percentile( q ) ,
+                        "Percentile of Diff to Current, First Run." ) )
+      {
+        return 1;
+      }
+    }
+  }
+
+  //Increments stay sparse, long diffs become dense
+  if( !check_equal( false ,
+                    diff_to_current( version_vector[ 39 ] ).is_dense() ,
+                    "Short diff is sparse." ) ||
+      !check_equal( true ,
+                    diff_to_current( version_vector[ 0 ] ).is_dense() ,
+                    "Long diff is dense." ) )
+  {
+    return 1;
+  }
+
+  //Dense plus dense
+  auto doubled = diff_to_current( version_vector[ 0 ] );
+  doubled += doubled;
+  for( std::size_t b = 0 ; b < buckets ; ++b )
+  {
+    if( !check_equal( 2 * control_values[ 0 ][ b ] , doubled.count( b ) ,
+                      "Dense sum." ) )
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
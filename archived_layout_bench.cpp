@@ -0,0 +1,121 @@
+#include "archived.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// A diff of 256 bytes, e.g. a small histogram.
+class wide
+{
+ public:
+  std::int64_t lanes[ 32 ];
+
+  wide() : lanes() {}
+
+  explicit wide( std::int64_t value ) : lanes()
+  {
+    lanes[ value & 31 ] = 1;
+  }
+
+  wide & operator+= ( const wide & other )
+  {
+    for( int i = 0 ; i < 32 ; ++i ) lanes[ i ] += other.lanes[ i ];
+    return *this;
+  }
+};
+
+// Counts references, so clear_history() keeps the versions.
+class counted_policy : public archived_defaults
+{
+ public:
+  static const bool track_references = true;
+};
+
+class split_policy : public counted_policy
+{
+ public:
+  static const bool split_payload = true;
+};
+
+const std::size_t history = std::size_t( 1 ) << 18;
+
+std::vector< char > eviction( std::size_t( 128 ) << 20 );
+
+void evict_caches()
+{
+  for( std::size_t i = 0 ; i < eviction.size() ; i += 64 )
+  {
+    eviction[ i ] += 1;
+  }
+}
+
+// The first value() walks the whole uncompressed history.
+// Then versions taken every 16 commits are queried in random order,
+// and a compaction pass visits the compressed history.
+template< class Policy >
+void run( const std::string & name )
+{
+  typedef archived< wide , Policy > archive_type;
+
+  archive_type archive( ( wide() ) );
+  std::vector< typename archive_type::version_type > versions;
+  for( std::size_t i = 0 ; i < history ; ++i )
+  {
+    if( i % 16 == 0 )
+    {
+      versions.push_back( archive.current() );
+    }
+    archive.increment_by( wide( static_cast< std::int64_t >( i ) ) );
+  }
+  std::shuffle( versions.begin() , versions.end() , std::mt19937_64( 1 ) );
+  evict_caches();
+
+  auto start = bench_clock::now();
+  std::int64_t check = archive.value().lanes[ 0 ];
+  double elapsed = seconds_since( start );
+  std::cout << name << ", walk: "
+            << elapsed * 1e9 / history << " ns/commit\n";
+
+  evict_caches();
+  start = bench_clock::now();
+  for( const auto & version : versions )
+  {
+    check += diff_to_current( version ).lanes[ 1 ];
+  }
+  elapsed = seconds_since( start );
+  std::cout << name << ", random queries: "
+            << elapsed * 1e9 / versions.size() << " ns/query\n";
+
+  archive.clear_history();
+  evict_caches();
+  start = bench_clock::now();
+  archive.clear_history();
+  elapsed = seconds_since( start );
+  std::cout << name << ", compaction pass: "
+            << elapsed * 1e9 / versions.size() << " ns/live commit"
+            << " (check " << check << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << history << " commits of " << sizeof( wide ) << " byte diffs.\n";
+
+  for( int repetition = 0 ; repetition < 2 ; ++repetition )
+  {
+    run< counted_policy >( "diffs in commits" );
+    run< split_policy >( "diffs apart" );
+  }
+
+  return 0;
+}
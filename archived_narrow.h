@@ -0,0 +1,483 @@
+#ifndef ARCHIVED_NARROW_H
+#define ARCHIVED_NARROW_H
+
+#include "archived.h"
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+/** @file */
+
+/**
+ @brief An archived<> of a signed integral Total, whose commits store
+ a narrower signed integral Delta.
+
+ # Overview
+
+ A narrow_archived<Total,Delta> behaves like archived<Total>,
+ but every commit holds its diff as a Delta and its successor as
+ a 32 bit index into one contiguous array.
+ A commit of narrow_archived<std::int64_t,std::int16_t> takes 8 bytes,
+ where a commit of archived<std::int64_t> takes 16,
+ so the walk in diff_to_current() touches half the cache lines.
+
+ ## Promotion:
+
+ Diffs are accumulated in Total.
+ A diff that does not fit into Delta, be it an increment or a
+ partial sum written by path compression, is promoted:
+ the commit stores the minimum of Delta as a marker, and the diff
+ is kept as a Total in a side array indexed by commit, so reading it
+ costs one more load. Commits whose diffs fit again are demoted.
+
+ Path compression stores the sum of the path behind a commit in it,
+ so compressed commits whose sum outgrew Delta are promoted.
+ The side array grows on demand up to the newest promoted commit.
+
+ Commit indices are 32 bit, so an archive holds less than 2^32 commits
+ between resets.
+*/
+template< class Total , class Delta >
+class narrow_archived
+{
+  static_assert( std::is_integral< Total >::value &&
+                 std::is_integral< Delta >::value &&
+                 std::is_signed< Total >::value &&
+                 std::is_signed< Delta >::value ,
+                 "narrow_archived<> requires signed integral types" );
+
+ public:
+  class version;
+
+  typedef Total value_type; /**< @brief The archived value's type. */
+  typedef Delta delta_type; /**< @brief The type stored per commit. */
+  typedef version version_type; /**< @brief The type of versions provided. */
+
+ private:
+  class commit;
+
+  typedef std::uint32_t index_type; /**< @internal @brief Index of a commit. */
+
+  friend version_type; /**< @internal */
+
+  static const Delta promoted = std::numeric_limits< Delta >::min();
+                            /**< @internal @brief Marks a promoted diff. */
+
+  mutable std::vector< commit > storage_; /**< @internal @brief All commits.
+                                               The last one is the
+                                               head commit. */
+  mutable std::vector< Total > wide_; /**< @internal @brief Promoted diffs,
+                                           by commit index. */
+  mutable std::size_t promoted_commits_; /**< @internal @brief The number
+                                              of promoted commits. */
+  mutable std::vector< index_type > path_; /**< @internal @brief Scratch
+                                                space for path compression. */
+  index_type first_; /**< @internal @brief The initial commit. */
+
+  /**
+   @internal @brief Returns the diff stored in commit index.
+  */
+  Total load
+  (
+    index_type
+     index /**< The commit. */
+  ) const;
+
+  /**
+   @internal @brief Stores diff in commit index,
+   promoting or demoting it as needed.
+  */
+  void store
+  (
+    index_type
+     index , /**< The commit. */
+    Total
+     diff /**< The diff. */
+  ) const;
+
+  /**
+   @internal @brief Modifies the commit old to contain
+   the diff to the current value, and the commits on the path
+   to the head as well. All of them get the head as successor.
+
+   @return The diff of old to the current value.
+  */
+  Total compute_diff_to_current
+  (
+    index_type
+     old /**< The old commit to be updated */
+  ) const;
+
+  /**
+   @internal @brief Appends a commit with zero diff that is
+   its own successor.
+  */
+  void create_head_commit();
+
+  /**
+   @internal @brief Returns the index of the head commit.
+  */
+  index_type head() const;
+
+ public:
+  /**
+   @brief Constructor that initializes the archive with initial_value.
+   After construction, the archive's current value is initial_value.
+  */
+  explicit narrow_archived
+  (
+    const Total &
+     initial_value /**< The initial value. */
+  );
+
+  narrow_archived( const narrow_archived & other ) = delete;
+  narrow_archived( narrow_archived && other ) = delete;
+  narrow_archived & operator= ( const narrow_archived & other ) = delete;
+  narrow_archived & operator= ( narrow_archived && other ) = delete;
+
+  /**
+   @brief Increments the value by increment.
+   Returns a new version.
+
+   @return A new version.
+  */
+  version_type increment_by
+  (
+    const Total &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value.
+
+   @return the current value.
+  */
+  Total value() const;
+
+  /**
+   @brief Clears the stored history data.
+   Leaves current value unchanged.
+   All associated versions are invalidated.
+   Returns a new (valid) version.
+
+   @return A new version.
+  */
+  version_type clear_history();
+
+  /**
+   @brief Clears the stored history data.
+   Sets current value to initial_value.
+   All associated versions are invalidated.
+   Returns a new (valid) version.
+
+   @return A new version.
+  */
+  version_type reset
+  (
+    const Total &
+     initial_value /**< The new value. */
+  );
+
+  /**
+   @brief Returns a new version.
+
+   @return A new version.
+  */
+  version_type current() const;
+
+  /**
+   @brief Returns the number of commits whose diff is promoted to Total.
+
+   @return The number of promoted commits.
+  */
+  std::size_t promoted_commits() const;
+};
+
+/**
+ @internal @brief A commit: the index of its successor and a narrow diff.
+*/
+template< class Total , class Delta >
+class narrow_archived< Total , Delta >::commit
+{
+ public:
+  index_type next_; /**< @internal @brief The successor. */
+  Delta diff_; /**< @internal @brief The diff, or promoted. */
+};
+
+/**
+ @brief A version of a narrow_archived<>.
+ Versions behave like the versions of archived<>.
+*/
+template< class Total , class Delta >
+class narrow_archived< Total , Delta >::version
+{
+ public:
+  typedef Total value_type; /**< @brief The associated archive's value type. */
+  typedef narrow_archived< Total , Delta > archive_type;
+                            /**< @brief The associated archive's type. */
+
+ private:
+  friend narrow_archived< Total , Delta >; /**< @internal */
+
+  const archive_type * archive_; /**< @internal @brief The archive. */
+  index_type index_; /**< @internal @brief The first commit after
+                          the version. */
+
+  /**
+   @internal @brief Computes the diff of old to the current value.
+  */
+  static Total compute_diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  );
+
+  /**
+   @internal @brief A constructor initializing archive_ and index_.
+  */
+  version
+  (
+    const archive_type *
+     archive , /**< The archive. */
+    index_type
+     index /**< The first commit after the version. */
+  );
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed version is not valid.
+  */
+  version();
+
+  /**
+   @brief Computes the difference of old and current value.
+
+   @return The value difference between old and current version.
+  */
+  friend Total diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  )
+  {
+    return compute_diff_to_current( old );
+  }
+};
+
+
+
+/*
+  Implementation of narrow_archived<> class members
+*/
+
+template< class Total , class Delta >
+ const Delta narrow_archived< Total , Delta >::promoted;
+
+template< class Total , class Delta >
+ Total
+  narrow_archived< Total , Delta >::load
+  (
+    index_type
+     index
+  ) const
+{
+  const auto diff = storage_[ index ].diff_;
+  if( diff == promoted )
+  {
+    return wide_[ index ];
+  }
+  return diff;
+}
+
+template< class Total , class Delta >
+ void
+  narrow_archived< Total , Delta >::store
+  (
+    index_type
+     index ,
+    Total
+     diff
+  ) const
+{
+  auto & target = storage_[ index ].diff_;
+  const bool fits = diff > Total( promoted ) &&
+                    diff <= Total( std::numeric_limits< Delta >::max() );
+
+  if( fits )
+  {
+    if( target == promoted )
+    {
+      --promoted_commits_;
+    }
+    target = static_cast< Delta >( diff );
+  } else {
+    if( target != promoted )
+    {
+      ++promoted_commits_;
+    }
+    if( wide_.size() <= index )
+    {
+      wide_.resize( std::size_t( index ) + 1 );
+    }
+    target = promoted;
+    wide_[ index ] = diff;
+  }
+}
+
+template< class Total , class Delta >
+ Total
+  narrow_archived< Total , Delta >::compute_diff_to_current
+  (
+    index_type
+     old
+  ) const
+{
+  path_.clear();
+  for( auto current = old ; storage_[ current ].next_ != current ;
+       current = storage_[ current ].next_ )
+  {
+    path_.push_back( current );
+  }
+
+  // Fold the path from the head backwards, widening only in Total.
+  const auto head_index = head();
+  Total suffix = Total();
+  for( auto position = path_.rbegin() ; position != path_.rend() ; ++position )
+  {
+    suffix += load( *position );
+    store( *position , suffix );
+    storage_[ *position ].next_ = head_index;
+  }
+  return suffix;
+}
+
+template< class Total , class Delta >
+ void
+  narrow_archived< Total , Delta >::create_head_commit()
+{
+  const auto index = static_cast< index_type >( storage_.size() );
+  storage_.push_back( commit{ index , Delta() } );
+}
+
+template< class Total , class Delta >
+ typename narrow_archived< Total , Delta >::index_type
+  narrow_archived< Total , Delta >::head() const
+{
+  return static_cast< index_type >( storage_.size() - 1 );
+}
+
+template< class Total , class Delta >
+  narrow_archived< Total , Delta >::narrow_archived
+  (
+    const Total &
+     initial_value
+  )
+  : storage_() ,
+    wide_() ,
+    promoted_commits_( 0 ) ,
+    path_() ,
+    first_( 0 )
+{
+  reset( initial_value );
+}
+
+template< class Total , class Delta >
+ typename narrow_archived< Total , Delta >::version_type
+  narrow_archived< Total , Delta >::increment_by
+  (
+    const Total &
+     increment
+  )
+{
+  const auto old_head = head();
+  store( old_head , increment );
+  create_head_commit();
+
+  const auto new_head = head();
+  storage_[ old_head ].next_ = new_head;
+  return version_type( this , new_head );
+}
+
+template< class Total , class Delta >
+ Total
+  narrow_archived< Total , Delta >::value() const
+{
+  return compute_diff_to_current( first_ );
+}
+
+template< class Total , class Delta >
+ typename narrow_archived< Total , Delta >::version_type
+  narrow_archived< Total , Delta >::clear_history()
+{
+  return reset( value() );
+}
+
+template< class Total , class Delta >
+ typename narrow_archived< Total , Delta >::version_type
+  narrow_archived< Total , Delta >::reset
+  (
+    const Total &
+     initial_value
+  )
+{
+  storage_.clear();
+  wide_.clear();
+  promoted_commits_ = 0;
+  create_head_commit();
+  first_ = head();
+
+  return increment_by( initial_value );
+}
+
+template< class Total , class Delta >
+ typename narrow_archived< Total , Delta >::version_type
+  narrow_archived< Total , Delta >::current() const
+{
+  return version_type( this , head() );
+}
+
+template< class Total , class Delta >
+ std::size_t
+  narrow_archived< Total , Delta >::promoted_commits() const
+{
+  return promoted_commits_;
+}
+
+/*
+  Implementation of narrow_archived<>::version class members
+*/
+
+template< class Total , class Delta >
+ Total
+  narrow_archived< Total , Delta >::version::compute_diff_to_current
+  (
+    const version &
+     old
+  )
+{
+  return old.archive_->compute_diff_to_current( old.index_ );
+}
+
+template< class Total , class Delta >
+  narrow_archived< Total , Delta >::version::version
+  (
+    const archive_type *
+     archive ,
+    index_type
+     index
+  )
+  : archive_( archive ) ,
+    index_( index )
+{
+}
+
+template< class Total , class Delta >
+  narrow_archived< Total , Delta >::version::version()
+  : archive_() ,
+    index_()
+{
+}
+
+#endif
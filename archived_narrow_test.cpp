@@ -0,0 +1,135 @@
+#include "archived_narrow.h"
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+int main ( int argc , const char ** argv )
+{
+  typedef narrow_archived< std::int64_t , std::int16_t > tested_type;
+
+  // provide the test data: mostly narrow, some increments need promotion
+  std::vector<std::int64_t> test_data = { 3 , 4 , 30000 , 9 , -32768 ,
+                                          5 , 7000000000LL , 94 , -30000 ,
+                                          20000 , 20000 , -7000000000LL };
+  std::int64_t initial_value = 13;
+
+  //Test constructor
+  tested_type tested_object_1( initial_value );
+
+  if( !check_equal( initial_value , tested_object_1.value() ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Test the increment and calculation of diff;
+  std::vector< tested_type::version > version_vector;
+  std::vector< std::int64_t > control_values;
+
+  version_vector.push_back( tested_object_1.current() );
+  control_values.push_back( initial_value );
+
+  std::cout << "Increment, First Run. \n";
+
+  for( const auto increment : test_data )
+  {
+    version_vector.push_back( tested_object_1.increment_by( increment ) );
+    control_values.push_back( control_values.back() + increment );
+  }
+
+  if( !check_equal( 3 , tested_object_1.promoted_commits() ,
+                    "Promoted increments." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Increment Check, First Run. \n";
+
+  const auto final_value = control_values.back();
+
+  // Query from the newest version backwards, so partial sums
+  // are promoted and demoted again during compression.
+  for( std::size_t i = version_vector.size() ; i-- > 0 ; )
+  {
+    if( !check_equal( final_value - control_values[ i ] ,
+                      diff_to_current( version_vector[ i ] ) ,
+                      "Diffs to Current, First Run." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( final_value , tested_object_1.value() ,
+                    "Value after compression." ) )
+  {
+    return 1;
+  }
+
+  //Reset and clear_history
+  tested_object_1.reset( 5 );
+  tested_object_1.increment_by( 100000 );
+  const auto cleared = tested_object_1.clear_history();
+  tested_object_1.increment_by( 1 );
+
+  if( !check_equal( 100006 , tested_object_1.value() ,
+                    "Value after clear_history." ) ||
+      !check_equal( 1 , diff_to_current( cleared ) ,
+                    "Diff after clear_history." ) ||
+      !check_equal( 1 , tested_object_1.promoted_commits() ,
+                    "Promoted after clear_history." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Long Chain. \n";
+
+  //Compression stores suffix sums, which outgrow Delta far from the head
+  const std::int64_t chain = 100000;
+  tested_object_1.reset( 0 );
+  tested_type::version middle;
+  for( std::int64_t i = 0 ; i < chain ; ++i )
+  {
+    if( i == chain / 2 )
+    {
+      middle = tested_object_1.current();
+    }
+    tested_object_1.increment_by( 1 );
+  }
+  if( !check_equal( 0 , tested_object_1.promoted_commits() ,
+                    "Promoted before compression." ) ||
+      !check_equal( chain , tested_object_1.value() ,
+                    "Value of the long chain." ) )
+  {
+    return 1;
+  }
+  std::cout << "Promoted after compression: "
+            << tested_object_1.promoted_commits() << " of "
+            << chain + 1 << " commits. \n";
+  if( !check_equal( chain + 1 - 32767 , tested_object_1.promoted_commits() ,
+                    "Promoted after compression." ) ||
+      !check_equal( chain / 2 , diff_to_current( middle ) ,
+                    "Diff of a promoted commit." ) ||
+      !check_equal( chain , tested_object_1.value() ,
+                    "Value after compression of the long chain." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,749 @@
+#ifndef ARCHIVED_NUMA_H
+#define ARCHIVED_NUMA_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined( __linux__ )
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+/** @file */
+
+/**
+ @brief The NUMA nodes of the machine and the placement of memory on them.
+
+ Memory is placed with the mbind system call, without a libnuma
+ dependency. Where it is unavailable, placement is left to the
+ kernel's first-touch policy: memory goes to the node of the thread
+ that writes it first.
+*/
+class numa_topology
+{
+ public:
+  /**
+   @brief Returns the number of NUMA nodes, 1 if unknown.
+
+   @return The number of nodes.
+  */
+  static std::size_t nodes();
+
+  /**
+   @brief Returns the node of every CPU, by CPU number.
+   All CPUs are on node 0 if unknown.
+
+   @return The node per CPU.
+  */
+  static std::vector< std::size_t > cpu_nodes();
+
+  /**
+   @brief Returns the CPU the calling thread runs on, 0 if unknown.
+
+   @return The CPU number.
+  */
+  static std::size_t current_cpu();
+
+  /**
+   @brief Maps bytes of memory, preferably placed on node.
+   Throws std::bad_alloc if no memory can be mapped.
+
+   @return The memory, aligned to a page.
+  */
+  static void * allocate_on_node
+  (
+    std::size_t
+     bytes , /**< The size of the memory. */
+    std::size_t
+     node /**< The preferred node. */
+  );
+
+  /**
+   @brief Maps bytes of memory, placed on the node of the thread
+   that touches each page first.
+   Throws std::bad_alloc if no memory can be mapped.
+
+   @return The memory, aligned to a page.
+  */
+  static void * allocate_local
+  (
+    std::size_t
+     bytes /**< The size of the memory. */
+  );
+
+  /**
+   @brief Unmaps memory returned by allocate_on_node() or allocate_local().
+  */
+  static void deallocate
+  (
+    void *
+     memory , /**< The memory. */
+    std::size_t
+     bytes /**< The size passed when allocating. */
+  );
+};
+
+/**
+ @brief Provides the memory of arena chunks on the node of the thread
+ that fills them, or on the node set by an on_node for the calling thread.
+*/
+class numa_local_pages
+{
+ public:
+  class on_node;
+
+  static const std::size_t min_chunk_bytes = std::size_t( 1 ) << 16;
+                            /**< @brief The size of the first chunk. */
+  static const std::size_t max_chunk_bytes = std::size_t( 1 ) << 22;
+                            /**< @brief The size chunks grow to. */
+
+ private:
+  static const std::size_t any_node = std::size_t( -1 );
+                            /**< @internal @brief No node set. */
+
+  /**
+   @internal @brief Returns the node set for the calling thread,
+   any_node if none.
+  */
+  static std::size_t & preferred_node();
+
+ public:
+
+  /**
+   @brief Maps bytes of memory local to the thread that touches it,
+   or preferably on the node set for the calling thread.
+
+   @return The memory.
+  */
+  static void * allocate
+  (
+    std::size_t
+     bytes /**< The size of the chunk. */
+  );
+
+  /**
+   @brief Unmaps memory returned by allocate().
+  */
+  static void deallocate
+  (
+    void *
+     memory , /**< The memory. */
+    std::size_t
+     bytes /**< The size passed to allocate(). */
+  );
+};
+
+/**
+ @brief Places the chunks the calling thread allocates with
+ numa_local_pages on a node, for its lifetime.
+ Lets a thread construct an archive whose first chunk belongs
+ to another node.
+*/
+class numa_local_pages::on_node
+{
+ private:
+  std::size_t previous_; /**< @internal @brief The node set before. */
+
+ public:
+  /**
+   @brief Sets node for the calling thread.
+  */
+  explicit on_node
+  (
+    std::size_t
+     node /**< The node. */
+  );
+
+  /**
+   @brief Restores the node set before.
+  */
+  ~on_node();
+
+  on_node( const on_node & other ) = delete;
+  on_node & operator= ( const on_node & other ) = delete;
+};
+
+/**
+ @brief The policy of the per node archives of a numa_archived<>.
+*/
+class numa_local_policy : public archived_defaults
+{
+ public:
+  typedef numa_local_pages pages; /**< @brief Node local chunks. */
+
+  static const bool track_references = false;
+    /**< @brief Shard versions do not write to their commits,
+         so they are copied and destroyed without the shard's lock. */
+};
+
+/**
+ @brief An archived<> that is incremented from several NUMA nodes
+ without moving its head between them.
+
+ # Overview
+
+ A numa_archived<Value> holds one archived<Value> per node,
+ its shard. increment_by() commits to the shard of the calling
+ thread's node, so the head commit, the lock and the commit arena
+ a thread writes to stay in its node's memory.
+
+ Readers fold the shards only when they take a version or a value:
+ a version holds one version per shard, and diff_to_current()
+ sums the diffs of all shards. Value has to be commutative.
+
+ ## Placement:
+
+ Each shard is mapped on its node with mbind, and so is the first
+ chunk of its commit arena, which is allocated while the shard is
+ constructed, see numa_local_pages::on_node.
+ Later chunks are taken with numa_local_pages by the writing thread,
+ so they land on its node.
+
+ On a machine with a single node, all memory is local anyway.
+ If more shards than nodes are requested there, threads are assigned
+ to shards by their CPU, so pinning threads to CPUs simulates a
+ topology of that many nodes.
+
+ ## Threads:
+
+ All members may be called concurrently. Each shard is guarded by
+ its own lock, so writers on different nodes never contend.
+ Versions may be copied, assigned and destroyed concurrently, too:
+ the shard archives do not count references,
+ so that touches no shard.
+*/
+template< class Value >
+class numa_archived
+{
+ public:
+  class version;
+
+  typedef Value value_type; /**< @brief The archived value's type. */
+  typedef version version_type; /**< @brief The type of versions provided. */
+  typedef archived< Value , numa_local_policy > shard_archive_type;
+                            /**< @brief The archive of a shard. */
+
+ private:
+  class shard;
+
+  friend version_type; /**< @internal */
+
+  std::vector< shard * > shards_; /**< @internal @brief One shard per node,
+                                       each mapped on its node. */
+  std::vector< std::size_t > cpu_nodes_; /**< @internal @brief The node
+                                              of every CPU. */
+  bool by_cpu_; /**< @internal @brief Whether threads are assigned
+                     to shards by CPU instead of node. */
+
+  /**
+   @internal @brief Returns the shard of the calling thread.
+  */
+  shard & local_shard();
+
+  /**
+   @internal @brief Destroys and unmaps all shards.
+  */
+  void release();
+
+ public:
+  /**
+   @brief Constructor that initializes the archive with initial_value.
+  */
+  explicit numa_archived
+  (
+    const Value &
+     initial_value , /**< The initial value. */
+    std::size_t
+     shards = numa_topology::nodes() /**< The number of shards,
+                                          by default one per node. */
+  );
+
+  /**
+   @brief Destroys all shards.
+   All associated versions are invalidated.
+  */
+  ~numa_archived();
+
+  numa_archived( const numa_archived & other ) = delete;
+  numa_archived & operator= ( const numa_archived & other ) = delete;
+
+  /**
+   @brief Increments the value by increment,
+   in the shard of the calling thread's node.
+   Unlike archived<>, no version is returned: taking one
+   means folding all shards, see current().
+  */
+  void increment_by
+  (
+    const Value &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value, the sum of all shards.
+
+   @return the current value.
+  */
+  Value value() const;
+
+  /**
+   @brief Returns a new version, one version per shard.
+
+   @return A new version.
+  */
+  version_type current() const;
+
+  /**
+   @brief Returns the number of shards.
+
+   @return The number of shards.
+  */
+  std::size_t shards() const;
+};
+
+/**
+ @internal @brief The archive of one node, with its lock.
+*/
+template< class Value >
+class alignas( 64 ) numa_archived< Value >::shard
+{
+ public:
+  std::mutex mutex_; /**< @internal @brief Guards archive_. */
+  shard_archive_type archive_; /**< @internal @brief The node's commits. */
+
+  /**
+   @internal @brief Constructs a shard with initial_value.
+  */
+  explicit shard
+  (
+    const Value &
+     initial_value /**< The initial value. */
+  );
+};
+
+/**
+ @brief A version of a numa_archived<>.
+ Versions behave like the versions of archived<>.
+*/
+template< class Value >
+class numa_archived< Value >::version
+{
+ public:
+  typedef Value value_type; /**< @brief The associated archive's value type. */
+  typedef numa_archived< Value > archive_type;
+                            /**< @brief The associated archive's type. */
+
+ private:
+  friend numa_archived< Value >; /**< @internal */
+
+  const archive_type * archive_; /**< @internal @brief The archive. */
+  std::vector< typename shard_archive_type::version_type > shard_versions_;
+                            /**< @internal @brief One version per shard. */
+
+  /**
+   @internal @brief Computes the diff of old to the current value.
+  */
+  static Value compute_diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  );
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed version is not valid.
+  */
+  version();
+
+  /**
+   @brief Computes the difference of old and current value.
+
+   @return The value difference between old and current version.
+  */
+  friend Value diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  )
+  {
+    return compute_diff_to_current( old );
+  }
+};
+
+
+
+/*
+  Implementation of numa_topology class members
+*/
+
+inline
+ std::size_t
+  numa_topology::nodes()
+{
+  // The online nodes are listed like "0-1".
+  std::ifstream online( "/sys/devices/system/node/online" );
+  std::string line;
+  if( ! std::getline( online , line ) || line.empty() )
+  {
+    return 1;
+  }
+  const auto last = line.find_last_of( "-," );
+  return static_cast< std::size_t >(
+    std::stoul( last == std::string::npos ? line : line.substr( last + 1 ) ) ) + 1;
+}
+
+inline
+ std::vector< std::size_t >
+  numa_topology::cpu_nodes()
+{
+  std::vector< std::size_t > result(
+    std::max( 1u , std::thread::hardware_concurrency() ) , 0 );
+
+  const auto node_count = nodes();
+  for( std::size_t node = 0 ; node < node_count ; ++node )
+  {
+    // The CPUs of a node are listed like "0-3,8-11".
+    std::ifstream list( "/sys/devices/system/node/node" +
+                        std::to_string( node ) + "/cpulist" );
+    std::string range;
+    while( std::getline( list , range , ',' ) )
+    {
+      std::istringstream bounds( range );
+      std::size_t first = 0 , last = 0;
+      char dash = 0;
+      if( ! ( bounds >> first ) )
+      {
+        continue;
+      }
+      last = ( bounds >> dash >> last ) ? last : first;
+      for( auto cpu = first ; cpu <= last ; ++cpu )
+      {
+        if( cpu >= result.size() )
+        {
+          result.resize( cpu + 1 , 0 );
+        }
+        result[ cpu ] = node;
+      }
+    }
+  }
+  return result;
+}
+
+inline
+ std::size_t
+  numa_topology::current_cpu()
+{
+#if defined( __linux__ )
+  const int cpu = sched_getcpu();
+  if( cpu >= 0 )
+  {
+    return static_cast< std::size_t >( cpu );
+  }
+#endif
+  return 0;
+}
+
+inline
+ void *
+  numa_topology::allocate_on_node
+  (
+    std::size_t
+     bytes ,
+    std::size_t
+     node
+  )
+{
+  void * memory = allocate_local( bytes );
+#if defined( __linux__ ) && defined( SYS_mbind )
+  const int preferred = 1; // MPOL_PREFERRED
+  unsigned long mask[ 16 ] = {};
+  const auto bits = 8 * sizeof( unsigned long );
+  if( node < 16 * bits )
+  {
+    mask[ node / bits ] = 1UL << ( node % bits );
+    // Fails harmlessly where NUMA is not supported.
+    syscall( SYS_mbind , memory , bytes , preferred , mask ,
+             16 * bits + 1 , 0 );
+  }
+#endif
+  return memory;
+}
+
+inline
+ void *
+  numa_topology::allocate_local
+  (
+    std::size_t
+     bytes
+  )
+{
+#if defined( __linux__ )
+  void * memory = mmap( nullptr , bytes , PROT_READ | PROT_WRITE ,
+                        MAP_PRIVATE | MAP_ANONYMOUS , -1 , 0 );
+  if( memory == MAP_FAILED )
+  {
+    throw std::bad_alloc();
+  }
+#if defined( SYS_mbind )
+  const int local = 4; // MPOL_LOCAL
+  syscall( SYS_mbind , memory , bytes , local , nullptr , 0 , 0 );
+#endif
+  return memory;
+#else
+  return ::operator new( bytes );
+#endif
+}
+
+inline
+ void
+  numa_topology::deallocate
+  (
+    void *
+     memory ,
+    std::size_t
+     bytes
+  )
+{
+#if defined( __linux__ )
+  munmap( memory , bytes );
+#else
+  ::operator delete( memory );
+#endif
+}
+
+/*
+  Implementation of numa_local_pages class members
+*/
+
+inline
+ std::size_t &
+  numa_local_pages::preferred_node()
+{
+  static thread_local std::size_t node = any_node;
+  return node;
+}
+
+inline
+ void *
+  numa_local_pages::allocate
+  (
+    std::size_t
+     bytes
+  )
+{
+  const auto node = preferred_node();
+  return node == any_node ? numa_topology::allocate_local( bytes )
+                          : numa_topology::allocate_on_node( bytes , node );
+}
+
+inline
+ void
+  numa_local_pages::deallocate
+  (
+    void *
+     memory ,
+    std::size_t
+     bytes
+  )
+{
+  numa_topology::deallocate( memory , bytes );
+}
+
+/*
+  Implementation of numa_local_pages::on_node class members
+*/
+
+inline
+  numa_local_pages::on_node::on_node
+  (
+    std::size_t
+     node
+  )
+  : previous_( preferred_node() )
+{
+  preferred_node() = node;
+}
+
+inline
+  numa_local_pages::on_node::~on_node()
+{
+  preferred_node() = previous_;
+}
+
+/*
+  Implementation of numa_archived<> class members
+*/
+
+template< class Value >
+  numa_archived< Value >::numa_archived
+  (
+    const Value &
+     initial_value ,
+    std::size_t
+     shards
+  )
+  : shards_() ,
+    cpu_nodes_( numa_topology::cpu_nodes() ) ,
+    by_cpu_( numa_topology::nodes() == 1 )
+{
+  if( shards == 0 )
+  {
+    shards = 1;
+  }
+  shards_.reserve( shards );
+  void * memory = nullptr;
+  try
+  {
+    for( std::size_t node = 0 ; node < shards ; ++node )
+    {
+      memory = numa_topology::allocate_on_node( sizeof( shard ) , node );
+      // The shard's first chunk is allocated by this thread,
+      // which may run on another node.
+      const numa_local_pages::on_node placement( node );
+      shards_.push_back( new( memory ) shard( node == 0 ? initial_value
+                                                        : Value() ) );
+      memory = nullptr;
+    }
+  } catch( ... ) {
+    if( memory )
+    {
+      numa_topology::deallocate( memory , sizeof( shard ) );
+    }
+    release();
+    throw;
+  }
+}
+
+template< class Value >
+  numa_archived< Value >::~numa_archived()
+{
+  release();
+}
+
+template< class Value >
+ void
+  numa_archived< Value >::release()
+{
+  for( const auto current : shards_ )
+  {
+    current->~shard();
+    numa_topology::deallocate( current , sizeof( shard ) );
+  }
+  shards_.clear();
+}
+
+template< class Value >
+ typename numa_archived< Value >::shard &
+  numa_archived< Value >::local_shard()
+{
+  const auto cpu = numa_topology::current_cpu();
+  const auto node = by_cpu_ || cpu >= cpu_nodes_.size()
+                    ? cpu
+                    : cpu_nodes_[ cpu ];
+  return *shards_[ node % shards_.size() ];
+}
+
+template< class Value >
+ void
+  numa_archived< Value >::increment_by
+  (
+    const Value &
+     increment
+  )
+{
+  auto & target = local_shard();
+  std::lock_guard< std::mutex > lock( target.mutex_ );
+  target.archive_.increment_by( increment );
+}
+
+template< class Value >
+ Value
+  numa_archived< Value >::value() const
+{
+  Value result = Value();
+  for( const auto current : shards_ )
+  {
+    std::lock_guard< std::mutex > lock( current->mutex_ );
+    result += current->archive_.value();
+  }
+  return result;
+}
+
+template< class Value >
+ typename numa_archived< Value >::version_type
+  numa_archived< Value >::current() const
+{
+  version_type result;
+  result.archive_ = this;
+  for( const auto current : shards_ )
+  {
+    std::lock_guard< std::mutex > lock( current->mutex_ );
+    result.shard_versions_.push_back( current->archive_.current() );
+  }
+  return result;
+}
+
+template< class Value >
+ std::size_t
+  numa_archived< Value >::shards() const
+{
+  return shards_.size();
+}
+
+/*
+  Implementation of numa_archived<>::shard class members
+*/
+
+template< class Value >
+  numa_archived< Value >::shard::shard
+  (
+    const Value &
+     initial_value
+  )
+  : mutex_() ,
+    archive_( initial_value )
+{
+}
+
+/*
+  Implementation of numa_archived<>::version class members
+*/
+
+template< class Value >
+ Value
+  numa_archived< Value >::version::compute_diff_to_current
+  (
+    const version &
+     old
+  )
+{
+  Value result = Value();
+  for( std::size_t i = 0 ; i < old.shard_versions_.size() ; ++i )
+  {
+    const auto current = old.archive_->shards_[ i ];
+    std::lock_guard< std::mutex > lock( current->mutex_ );
+    result += diff_to_current( old.shard_versions_[ i ] );
+  }
+  return result;
+}
+
+template< class Value >
+  numa_archived< Value >::version::version()
+  : archive_() ,
+    shard_versions_()
+{
+}
+
+#endif
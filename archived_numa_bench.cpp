@@ -0,0 +1,137 @@
+#include "archived_numa.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+#if defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+const std::uint64_t increments_per_thread = 2000000;
+
+// Pins the calling thread to cpu.
+void pin_to( unsigned cpu )
+{
+#if defined( __linux__ )
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu , &set );
+  pthread_setaffinity_np( pthread_self() , sizeof( set ) , &set );
+#endif
+}
+
+// Runs writer threads pinned round robin over the CPUs, while
+// the main thread takes a version and its diff every millisecond.
+template< class Increment , class Fold >
+double run( unsigned threads , Increment increment , Fold fold )
+{
+  const unsigned cpus = std::max( 1u , std::thread::hardware_concurrency() );
+  std::vector< std::thread > writers;
+  bool done = false;
+  std::mutex done_mutex;
+
+  const auto start = bench_clock::now();
+  for( unsigned t = 0 ; t < threads ; ++t )
+  {
+    writers.emplace_back( [ & , t ]()
+    {
+      pin_to( t % cpus );
+      for( std::uint64_t i = 0 ; i < increments_per_thread ; ++i )
+      {
+        increment();
+      }
+    } );
+  }
+
+  std::thread reader( [ & ]()
+  {
+    for( ;; )
+    {
+      {
+        std::lock_guard< std::mutex > lock( done_mutex );
+        if( done ) break;
+      }
+      fold();
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+  } );
+
+  for( auto & writer : writers )
+  {
+    writer.join();
+  }
+  const double elapsed = seconds_since( start );
+  {
+    std::lock_guard< std::mutex > lock( done_mutex );
+    done = true;
+  }
+  reader.join();
+
+  return threads * increments_per_thread / elapsed / 1e6;
+}
+
+int main ( int argc , const char ** argv )
+{
+  const unsigned cpus = std::max( 1u , std::thread::hardware_concurrency() );
+  const unsigned threads = std::max( 2u , cpus );
+
+  std::cout << numa_topology::nodes() << " node(s), " << cpus << " cpu(s), "
+            << threads << " writer threads.\n";
+
+  {
+    archived< std::int64_t > shared( 0 );
+    std::mutex mutex;
+    auto version = shared.current();
+
+    const double rate = run( threads ,
+      [ & ]()
+      {
+        std::lock_guard< std::mutex > lock( mutex );
+        shared.increment_by( 1 );
+      } ,
+      [ & ]()
+      {
+        std::lock_guard< std::mutex > lock( mutex );
+        diff_to_current( version );
+        version = shared.current();
+      } );
+    std::cout << "one archived<> behind a mutex: "
+              << rate << " M increments/s\n";
+  }
+
+  // Simulated topologies: threads on a CPU share the CPU's shard.
+  for( const std::size_t nodes : { std::size_t( 1 ) , std::size_t( 2 ) ,
+                                   std::size_t( 4 ) } )
+  {
+    numa_archived< std::int64_t > sharded( 0 , nodes );
+    auto version = sharded.current();
+
+    const double rate = run( threads ,
+      [ & ]()
+      {
+        sharded.increment_by( 1 );
+      } ,
+      [ & ]()
+      {
+        diff_to_current( version );
+        version = sharded.current();
+      } );
+    std::cout << "numa_archived<>, " << nodes << " shard(s): "
+              << rate << " M increments/s\n";
+  }
+
+  return 0;
+}
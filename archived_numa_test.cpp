@@ -0,0 +1,218 @@
+#include "archived_numa.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// Counts live instances and throws on a chosen construction,
+// so the cleanup of a failed numa_archived<> construction can be checked.
+class fragile
+{
+ public:
+  static std::int64_t live;
+  static std::int64_t constructions_left;
+  std::int64_t value;
+
+  fragile( std::int64_t v = 0 ) : value( v ) { construct(); }
+  fragile( const fragile & other ) : value( other.value ) { construct(); }
+  fragile & operator=( const fragile & other ) = default;
+  ~fragile() { --live; }
+
+  void construct()
+  {
+    if( constructions_left-- == 0 )
+    {
+      throw std::runtime_error( "construction" );
+    }
+    ++live;
+  }
+
+  fragile & operator+=( const fragile & other )
+  {
+    value += other.value;
+    return *this;
+  }
+};
+
+std::int64_t fragile::live = 0;
+std::int64_t fragile::constructions_left = -1;
+
+int main ( int argc , const char ** argv )
+{
+  // provide the test data
+  std::vector<std::int64_t> test_data = { 3 , 4 , 7 , 9 , 4 , 5 , 7 , 94 };
+  std::int64_t initial_value = 13;
+
+  //Test constructor, with more shards than the machine has nodes
+  numa_archived< std::int64_t > tested_object_1( initial_value , 4 );
+
+  if( !check_equal( initial_value , tested_object_1.value() ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( 4 , tested_object_1.shards() , "Shards." ) )
+  {
+    return 1;
+  }
+
+  //Test the increment and calculation of diff;
+  std::vector< numa_archived< std::int64_t >::version > version_vector;
+  std::vector< std::int64_t > control_values;
+
+  version_vector.push_back( tested_object_1.current() );
+  control_values.push_back( initial_value );
+
+  std::cout << "Increment, First Run. \n";
+
+  for( const auto increment : test_data )
+  {
+    tested_object_1.increment_by( increment );
+    version_vector.push_back( tested_object_1.current() );
+    control_values.push_back( control_values.back() + increment );
+  }
+
+  std::cout << "Increment Check, First Run. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    if( !check_equal( control_values.back() - control_values[ i ] ,
+                      diff_to_current( version_vector[ i ] ) ,
+                      "Diffs to Current, First Run." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Concurrent writers, wherever they are scheduled
+
+  std::cout << "Increment, Threads. \n";
+
+  const auto before = tested_object_1.current();
+  const std::int64_t threads = 4 , increments = 10000;
+  std::vector< std::thread > writers;
+  for( std::int64_t t = 0 ; t < threads ; ++t )
+  {
+    writers.emplace_back( [ & ]()
+    {
+      for( std::int64_t i = 0 ; i < increments ; ++i )
+      {
+        tested_object_1.increment_by( 2 );
+      }
+    } );
+  }
+  for( auto & writer : writers )
+  {
+    writer.join();
+  }
+
+  if( !check_equal( 2 * threads * increments , diff_to_current( before ) ,
+                    "Diff to Current, Threads." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( control_values.back() + 2 * threads * increments ,
+                    tested_object_1.value() ,
+                    "Value, Threads." ) )
+  {
+    return 1;
+  }
+
+  //Readers copying and dropping versions while writers increment
+
+  std::cout << "Versions, Threads. \n";
+
+  const auto start = tested_object_1.current();
+  std::vector< std::thread > workers;
+  std::vector< std::int64_t > failures( threads , 0 );
+  for( std::int64_t t = 0 ; t < threads ; ++t )
+  {
+    workers.emplace_back( [ & ]()
+    {
+      for( std::int64_t i = 0 ; i < increments ; ++i )
+      {
+        tested_object_1.increment_by( 1 );
+      }
+    } );
+    workers.emplace_back( [ & , t ]()
+    {
+      std::vector< numa_archived< std::int64_t >::version > kept;
+      for( std::int64_t i = 0 ; i < increments / 10 ; ++i )
+      {
+        kept.push_back( tested_object_1.current() );
+        auto copy = kept.back();
+        kept.front() = copy;
+        failures[ t ] += diff_to_current( copy ) < 0;
+        if( kept.size() > 16 )
+        {
+          kept.erase( kept.begin() );
+        }
+      }
+    } );
+  }
+  for( auto & worker : workers )
+  {
+    worker.join();
+  }
+
+  std::int64_t failed = 0;
+  for( const auto f : failures ) failed += f;
+  if( !check_equal( 0 , failed , "Diffs to Current, Versions, Threads." ) ||
+      !check_equal( threads * increments , diff_to_current( start ) ,
+                    "Diff to Current, Versions, Threads." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Failed Construction. \n";
+
+  // Count the values constructed, then fail on each of them.
+  fragile::constructions_left = 1000000;
+  {
+    numa_archived< fragile > counting( fragile( 13 ) , 4 );
+  }
+  const std::int64_t constructions = 1000000 - fragile::constructions_left;
+
+  std::int64_t thrown = 0;
+  for( std::int64_t failed = 0 ; failed < constructions ; ++failed )
+  {
+    fragile::constructions_left = failed;
+    try
+    {
+      numa_archived< fragile > failing( fragile( 13 ) , 4 );
+    } catch( const std::runtime_error & ) {
+      ++thrown;
+    }
+    if( !check_equal( 0 , fragile::live , "Live values after failure." ) )
+    {
+      return 1;
+    }
+  }
+  fragile::constructions_left = -1;
+
+  if( !check_equal( constructions , thrown , "Failed constructions." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,1219 @@
+#ifndef ARCHIVED_POOL_H
+#define ARCHIVED_POOL_H
+
+#include "archived.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <vector>
+/** @file */
+
+template< class Value , class Policy >
+class pool_checkpoint;
+
+/**
+ @internal @brief The commits and archives an archive_pool<>
+ changed since they were last taken, nothing unless Track.
+*/
+template< class Index , bool Track >
+class pool_changes
+{
+ public:
+  /**
+   @internal @brief Records that a commit changed.
+  */
+  void commit
+  (
+    Index
+     index , /**< The commit. */
+    bool
+     released /**< Whether it is on the free list now. */
+  );
+
+  /**
+   @internal @brief Records that an archive changed.
+  */
+  void archive
+  (
+    Index
+     handle /**< The archive. */
+  );
+};
+
+/**
+ @internal @brief Changes recorded as a list of indices,
+ and bitmaps keeping the lists free of duplicates.
+ Also knows which commits are released, as a released commit
+ links into the free list and can not tell by itself.
+*/
+template< class Index >
+class pool_changes< Index , true >
+{
+  std::vector< Index > commits_; /**< @internal @brief Changed commits. */
+  std::vector< Index > archives_; /**< @internal @brief Changed archives. */
+  std::vector< std::uint64_t > marked_commits_; /**< @internal @brief Bit
+                                                     per commit in commits_. */
+  std::vector< std::uint64_t > marked_archives_; /**< @internal @brief Bit
+                                                      per archive
+                                                      in archives_. */
+  std::vector< std::uint64_t > released_; /**< @internal @brief Bit per
+                                               released commit. */
+
+  /**
+   @internal @brief Sets or clears the bit of index.
+
+   @return Whether the bit was set before.
+  */
+  static bool assign
+  (
+    std::vector< std::uint64_t > &
+     bits , /**< The bitmap. */
+    Index
+     index , /**< The bit. */
+    bool
+     value /**< The new value of the bit. */
+  );
+
+ public:
+  /**
+   @internal @brief Records that a commit changed.
+  */
+  void commit
+  (
+    Index
+     index , /**< The commit. */
+    bool
+     released /**< Whether it is on the free list now. */
+  );
+
+  /**
+   @internal @brief Records that an archive changed.
+  */
+  void archive
+  (
+    Index
+     handle /**< The archive. */
+  );
+
+  /**
+   @internal @brief Checks whether a commit is on the free list.
+  */
+  bool released
+  (
+    Index
+     index /**< The commit. */
+  ) const;
+
+  /**
+   @internal @brief Returns the commits changed since clear().
+  */
+  const std::vector< Index > & commits() const;
+
+  /**
+   @internal @brief Returns the archives changed since clear().
+  */
+  const std::vector< Index > & archives() const;
+
+  /**
+   @internal @brief Forgets the changes, keeping what is released.
+  */
+  void clear();
+};
+
+/**
+ @brief Many small archives of Value, sharing one commit storage.
+
+ # Overview
+
+ An archive_pool<Value,Policy> hosts independent archives,
+ each of which behaves like an archived<Value>.
+ An archive is identified by a 32 bit handle, and costs a slot
+ of two 32 bit commit indices and an epoch, plus its commits.
+
+ ## Storage:
+
+ The commits of all archives are kept in chunks of a fixed number
+ of commits, taken from Policy::pages, and addressed by 32 bit
+ indices. A commit holds the index of its successor,
+ a reference count and the diff: an idle archive of int,
+ compressed to its initial commit and its head, takes 36 bytes.
+
+ The commits of an archive are scattered between those of the others,
+ so compression records the path it walks in a scratch vector,
+ and folds it backwards instead of reversing the links like archived<>.
+ Paths too long to stay cached are folded prefetching
+ Policy::prefetch_distance commits ahead.
+
+ Commits are reference counted like those of archived<>.
+ Garbage is returned to one free list shared by all archives,
+ right when diff_to_current() or value() compresses it away,
+ and reused by every archive of the pool.
+
+ Destroying the pool releases its chunks, in O(chunks)
+ if Value is trivially destructible.
+
+ ## Group reset:
+
+ reset_all() resets all archives in O(1): it starts a new epoch
+ and takes back all commits at once, by rewinding the storage.
+ An archive of an older epoch is reinitialized to the value
+ given to reset_all() when it is used next.
+ Diffs of the commits taken back are destroyed when their commits
+ are reused, or with the pool.
+
+ ## Checkpoints:
+
+ If Policy::track_changes is true, the pool records the commits
+ and archives it changes, so pool_checkpoint can save them
+ incrementally, see archived_checkpoint.h.
+
+ ## Versions:
+
+ A version refers to its pool and a commit.
+ Versions have to be destroyed before their pool.
+ Resetting or destroying an archive invalidates its versions:
+ their diff_to_current() is unspecified, but safe.
+ reset_all() invalidates all versions, which valid() detects:
+ the diff_to_current() of a version of an older epoch is zero.
+
+ A pool holds less than 2^32 commits and 2^32 archives,
+ and valid() only tells epochs apart modulo 2^32.
+*/
+template< class Value , class Policy = archived_defaults >
+class archive_pool
+{
+ public:
+  class version;
+
+  typedef Value value_type; /**< @brief The archived values' type. */
+  typedef version version_type; /**< @brief The type of versions provided. */
+  typedef std::uint32_t handle_type; /**< @brief Identifies an archive. */
+
+ private:
+  class commit;
+  class slot;
+
+  typedef std::uint32_t index_type; /**< @internal @brief Index of a commit. */
+
+  friend version_type; /**< @internal */
+  friend pool_checkpoint< Value , Policy >; /**< @internal */
+
+  static const index_type none = std::numeric_limits< index_type >::max();
+                            /**< @internal @brief Marks the end of
+                                 a free list. */
+  static const unsigned chunk_shift = 12; /**< @internal @brief Log2 of
+                                               the commits per chunk. */
+  static const std::size_t prefetch_threshold = 16384;
+                            /**< @internal @brief The path length
+                                 above which folds prefetch. */
+
+  std::vector< commit * > chunks_; /**< @internal @brief The chunks of
+                                        commits, each of 2^chunk_shift. */
+  index_type built_; /**< @internal @brief The number of constructed
+                          commits. */
+  index_type used_; /**< @internal @brief The number of commits
+                         taken in this epoch. */
+  index_type free_; /**< @internal @brief Released commits,
+                         linked through their successors. */
+  std::size_t commits_; /**< @internal @brief Commits not released. */
+  std::vector< slot > slots_; /**< @internal @brief The archives,
+                                   indexed by handle. */
+  handle_type free_slots_; /**< @internal @brief Destroyed archives,
+                                linked through their initial commits. */
+  std::size_t archives_; /**< @internal @brief Archives not destroyed. */
+  std::uint32_t epoch_; /**< @internal @brief Counts reset_all(). */
+  Value epoch_value_; /**< @internal @brief The value archives of
+                           an older epoch are reinitialized to. */
+  pool_changes< index_type , Policy::track_changes > changes_;
+                            /**< @internal @brief Changes since
+                                 the last checkpoint. */
+  std::vector< index_type > path_; /**< @internal @brief Scratch space
+                                        for path compression. */
+
+  /**
+   @internal @brief Returns the commit at index.
+  */
+  commit & at
+  (
+    index_type
+     index /**< The commit. */
+  ) const;
+
+  /**
+   @internal @brief Constructs commits up to index built,
+   taking chunks as needed.
+  */
+  void grow
+  (
+    index_type
+     built /**< The number of commits to construct. */
+  );
+
+  /**
+   @internal @brief Takes a commit from the free list or a chunk.
+   It has zero diff, no references and is its own successor.
+
+   @return The index of the commit.
+  */
+  index_type create_commit();
+
+  /**
+   @internal @brief Drops a reference to a commit.
+   Returns it to the free list if it was the last one,
+   and every successor that only it referred to.
+  */
+  void release_commit
+  (
+    index_type
+     index /**< The commit. */
+  );
+
+  /**
+   @internal @brief Modifies the commit old to contain the diff
+   to the current value, and all commits on the path to the head.
+   All of them get the head as successor, garbage is released.
+   If Value::operator+= throws, the commits not folded yet
+   keep their successors.
+
+   @return The diff of old to the current value.
+  */
+  const Value & compute_diff_to_current
+  (
+    index_type
+     old /**< The old commit to be updated. */
+  );
+
+  /**
+   @internal @brief Sets the archive handle to a fresh history
+   with value initial_value.
+  */
+  void initialize
+  (
+    handle_type
+     handle , /**< The archive. */
+    const Value &
+     initial_value /**< The initial value. */
+  );
+
+  /**
+   @internal @brief Returns the slot of the archive handle,
+   reinitialized if it belongs to an older epoch.
+  */
+  slot & touch
+  (
+    handle_type
+     handle /**< The archive. */
+  );
+
+  /**
+   @internal @brief Drops the references of the archive handle.
+  */
+  void release_archive
+  (
+    handle_type
+     handle /**< The archive. */
+  );
+
+ public:
+  /**
+   @brief Constructs an empty pool.
+  */
+  archive_pool();
+
+  /**
+   @brief Destroys all archives and releases all chunks.
+   All associated versions have to be destroyed before.
+  */
+  ~archive_pool();
+
+  archive_pool( const archive_pool & other ) = delete;
+  archive_pool & operator= ( const archive_pool & other ) = delete;
+
+  /**
+   @brief Creates an archive with value initial_value.
+
+   @return The handle of the archive.
+  */
+  handle_type create
+  (
+    const Value &
+     initial_value /**< The initial value. */
+  );
+
+  /**
+   @brief Destroys an archive, its handle may be reused.
+   All its versions are invalidated.
+  */
+  void destroy
+  (
+    handle_type
+     handle /**< The archive. */
+  );
+
+  /**
+   @brief Increments an archive by increment.
+   Returns a new version.
+
+   @return A new version.
+  */
+  version_type increment_by
+  (
+    handle_type
+     handle , /**< The archive. */
+    const Value &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value of an archive.
+
+   @return The current value.
+  */
+  Value value
+  (
+    handle_type
+     handle /**< The archive. */
+  );
+
+  /**
+   @brief Returns a new version of an archive.
+
+   @return A new version.
+  */
+  version_type current
+  (
+    handle_type
+     handle /**< The archive. */
+  );
+
+  /**
+   @brief Clears the stored history data of an archive.
+   Sets its value to initial_value.
+   All its versions are invalidated.
+   Returns a new (valid) version.
+
+   @return A new version.
+  */
+  version_type reset
+  (
+    handle_type
+     handle , /**< The archive. */
+    const Value &
+     initial_value /**< The new value. */
+  );
+
+  /**
+   @brief Resets all archives to initial_value in O(1).
+   Every archive is reinitialized when it is used next.
+   All versions are invalidated.
+  */
+  void reset_all
+  (
+    const Value &
+     initial_value /**< The new value of all archives. */
+  );
+
+  /**
+   @brief Returns the number of archives.
+
+   @return The number of archives not destroyed.
+  */
+  std::size_t archives() const;
+
+  /**
+   @brief Returns the number of stored commits of all archives.
+
+   @return The number of commits.
+  */
+  std::size_t commits() const;
+
+  /**
+   @brief Returns the memory taken by chunks and slots.
+
+   @return The memory in bytes.
+  */
+  std::size_t bytes() const;
+};
+
+/**
+ @internal @brief A commit: the index of its successor,
+ its reference count and the diff.
+*/
+template< class Value , class Policy >
+class archive_pool< Value , Policy >::commit
+{
+ public:
+  index_type next_; /**< @internal @brief The successor. */
+  index_type references_; /**< @internal @brief Versions and commits
+                               referring to the commit, and the archive
+                               while it is the head or initial commit. */
+  Value diff_; /**< @internal @brief The diff. */
+};
+
+/**
+ @internal @brief An archive: its head, its initial commit
+ and the epoch they belong to.
+*/
+template< class Value , class Policy >
+class archive_pool< Value , Policy >::slot
+{
+ public:
+  index_type head_; /**< @internal @brief The head commit,
+                         none if the archive is destroyed. */
+  index_type first_; /**< @internal @brief The initial commit, or the next
+                          destroyed archive. */
+  std::uint32_t epoch_; /**< @internal @brief The epoch of the commits. */
+};
+
+/**
+ @brief A version of an archive of an archive_pool<>.
+ Versions behave like the versions of archived<>.
+*/
+template< class Value , class Policy >
+class archive_pool< Value , Policy >::version
+{
+ public:
+  typedef Value value_type; /**< @brief The archived value's type. */
+  typedef archive_pool< Value , Policy > archive_type;
+                            /**< @brief The associated pool's type. */
+
+ private:
+  friend archive_pool< Value , Policy >; /**< @internal */
+
+  archive_type * pool_; /**< @internal @brief The pool. */
+  index_type commit_; /**< @internal @brief The first commit after
+                           the version. */
+  std::uint32_t epoch_; /**< @internal @brief The epoch of the commit. */
+
+  /**
+   @internal @brief Computes the diff of old to the current value.
+  */
+  static Value compute_diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  );
+
+  /**
+   @internal @brief A constructor initializing pool_ and commit_,
+   referring to the commit.
+  */
+  version
+  (
+    archive_type *
+     pool , /**< The pool. */
+    index_type
+     position /**< The first commit after the version. */
+  );
+
+  /**
+   @internal @brief Adds a reference to the commit.
+  */
+  void acquire() const;
+
+  /**
+   @internal @brief Drops the reference to the commit.
+  */
+  void release() const;
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed version is not valid.
+  */
+  version();
+
+  /**
+   @brief Copy Constructor
+  */
+  version
+  (
+    const version &
+     other /**< The source of the copy. */
+  );
+
+  /**
+   @brief Move Constructor, other becomes invalid.
+  */
+  version
+  (
+    version &&
+     other /**< The source of the move. */
+  );
+
+  /**
+   @brief Assignment operator
+
+   @return A reference to *this
+  */
+  version & operator=
+  (
+    const version &
+     other /**< The source of the copy. */
+  );
+
+  /**
+   @brief Move Assignment operator, other becomes invalid.
+
+   @return A reference to *this
+  */
+  version & operator=
+  (
+    version &&
+     other /**< The source of the move. */
+  );
+
+  /**
+   @brief Destructor, drops the reference to the commit.
+  */
+  ~version();
+
+  /**
+   @brief Checks whether the version belongs to the current epoch
+   of its pool, i.e. was taken after the last reset_all().
+
+   @return false if the version is default constructed
+   or of an older epoch.
+  */
+  bool valid() const;
+
+  /**
+   @brief Computes the difference of old and current value.
+
+   @return The value difference between old and current version.
+  */
+  friend Value diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  )
+  {
+    return compute_diff_to_current( old );
+  }
+};
+
+
+
+/*
+  Implementation of archive_pool<> class members
+*/
+
+template< class Value , class Policy >
+ const typename archive_pool< Value , Policy >::index_type
+  archive_pool< Value , Policy >::none;
+
+template< class Value , class Policy >
+ const unsigned archive_pool< Value , Policy >::chunk_shift;
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::commit &
+  archive_pool< Value , Policy >::at
+  (
+    index_type
+     index
+  ) const
+{
+  return chunks_[ index >> chunk_shift ]
+                [ index & ( ( index_type( 1 ) << chunk_shift ) - 1 ) ];
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::grow
+  (
+    index_type
+     built
+  )
+{
+  for( ; built_ < built ; ++built_ )
+  {
+    if( ( built_ >> chunk_shift ) == chunks_.size() )
+    {
+      chunks_.reserve( chunks_.size() + 1 );
+      chunks_.push_back( static_cast< commit * >(
+        Policy::pages::allocate( sizeof( commit ) << chunk_shift ) ) );
+    }
+    new( &at( built_ ) ) commit{ built_ , 0 , Value() };
+  }
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::index_type
+  archive_pool< Value , Policy >::create_commit()
+{
+  index_type result = free_;
+  if( result != none )
+  {
+    free_ = at( result ).next_;
+  } else if( used_ < built_ ) {
+    result = used_++; // Taken back by reset_all().
+    at( result ).diff_ = Value();
+  } else {
+    result = built_;
+    grow( built_ + 1 );
+    used_ = built_;
+  }
+
+  auto & fresh = at( result );
+  fresh.next_ = result;
+  fresh.references_ = 0;
+  ++commits_;
+  changes_.commit( result , false );
+  return result;
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::release_commit
+  (
+    index_type
+     index
+  )
+{
+  while( --at( index ).references_ == 0 )
+  {
+    auto & garbage = at( index );
+    const auto next = garbage.next_;
+    garbage.diff_ = Value(); // Frees what the diff holds.
+    garbage.next_ = free_;
+    free_ = index;
+    --commits_;
+    changes_.commit( index , true );
+
+    if( next == index )
+    {
+      return;
+    }
+    index = next;
+  }
+}
+
+template< class Value , class Policy >
+ const Value &
+  archive_pool< Value , Policy >::compute_diff_to_current
+  (
+    index_type
+     old
+  )
+{
+  // Walk to the last commit before the head, recording the path,
+  // then fold it backwards. The commits of interleaved archives
+  // are scattered, but the path tells where the fold goes next,
+  // so it prefetches them instead of chasing reversed links.
+  path_.clear();
+  index_type current = old;
+  while( at( at( current ).next_ ).next_ != at( current ).next_ )
+  {
+    path_.push_back( current );
+    current = at( current ).next_;
+  }
+
+  const auto head = at( current ).next_;
+  // The commits of shorter paths are still cached from the walk.
+  const std::size_t distance =
+    path_.size() > prefetch_threshold ? Policy::prefetch_distance : 0;
+  for( auto k = path_.size() ; k-- != 0 ; )
+  {
+#if defined( __GNUC__ )
+    if( distance != 0 && k >= distance )
+    {
+      __builtin_prefetch( &at( path_[ k - distance ] ) , 1 );
+    }
+#endif
+    const auto previous = path_[ k ];
+    auto & folded = at( previous );
+    folded.diff_ += at( current ).diff_;
+    folded.next_ = head;
+    ++at( head ).references_;
+    changes_.commit( previous , false );
+    release_commit( current );
+    current = previous;
+  }
+  return at( old ).diff_;
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::initialize
+  (
+    handle_type
+     handle ,
+    const Value &
+     initial_value
+  )
+{
+  const auto first = create_commit();
+  at( first ).references_ = 2; // Initial commit and head.
+  slots_[ handle ].head_ = first;
+  slots_[ handle ].first_ = first;
+  slots_[ handle ].epoch_ = epoch_;
+  changes_.archive( handle );
+  increment_by( handle , initial_value );
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::slot &
+  archive_pool< Value , Policy >::touch
+  (
+    handle_type
+     handle
+  )
+{
+  if( slots_[ handle ].epoch_ != epoch_ )
+  {
+    // The old commits were taken back as a whole.
+    initialize( handle , epoch_value_ );
+  }
+  return slots_[ handle ];
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::release_archive
+  (
+    handle_type
+     handle
+  )
+{
+  release_commit( slots_[ handle ].first_ );
+  release_commit( slots_[ handle ].head_ );
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::archive_pool()
+  : chunks_() ,
+    built_( 0 ) ,
+    used_( 0 ) ,
+    free_( none ) ,
+    commits_( 0 ) ,
+    slots_() ,
+    free_slots_( none ) ,
+    archives_( 0 ) ,
+    epoch_( 0 ) ,
+    epoch_value_() ,
+    changes_() ,
+    path_()
+{
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::~archive_pool()
+{
+  if( ! std::is_trivially_destructible< Value >::value )
+  {
+    for( index_type index = 0 ; index < built_ ; ++index )
+    {
+      at( index ).~commit();
+    }
+  }
+  for( const auto released : chunks_ )
+  {
+    Policy::pages::deallocate( released , sizeof( commit ) << chunk_shift );
+  }
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::handle_type
+  archive_pool< Value , Policy >::create
+  (
+    const Value &
+     initial_value
+  )
+{
+  handle_type handle = free_slots_;
+  if( handle != none )
+  {
+    free_slots_ = slots_[ handle ].first_;
+  } else {
+    handle = static_cast< handle_type >( slots_.size() );
+    slots_.push_back( slot{ none , none , epoch_ } );
+  }
+  ++archives_;
+  initialize( handle , initial_value );
+  return handle;
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::destroy
+  (
+    handle_type
+     handle
+  )
+{
+  if( slots_[ handle ].epoch_ == epoch_ )
+  {
+    release_archive( handle );
+  }
+  slots_[ handle ].head_ = none;
+  slots_[ handle ].first_ = free_slots_;
+  free_slots_ = handle;
+  --archives_;
+  changes_.archive( handle );
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::version_type
+  archive_pool< Value , Policy >::increment_by
+  (
+    handle_type
+     handle ,
+    const Value &
+     increment
+  )
+{
+  auto & target = touch( handle );
+  const auto old_head = target.head_;
+  const auto new_head = create_commit();
+  at( new_head ).references_ = 2; // Head and successor of old_head.
+
+  at( old_head ).diff_ = increment;
+  at( old_head ).next_ = new_head;
+  target.head_ = new_head;
+  changes_.commit( old_head , false );
+  changes_.archive( handle );
+  release_commit( old_head );
+  return version_type( this , new_head );
+}
+
+template< class Value , class Policy >
+ Value
+  archive_pool< Value , Policy >::value
+  (
+    handle_type
+     handle
+  )
+{
+  return compute_diff_to_current( touch( handle ).first_ );
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::version_type
+  archive_pool< Value , Policy >::current
+  (
+    handle_type
+     handle
+  )
+{
+  return version_type( this , touch( handle ).head_ );
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::version_type
+  archive_pool< Value , Policy >::reset
+  (
+    handle_type
+     handle ,
+    const Value &
+     initial_value
+  )
+{
+  if( slots_[ handle ].epoch_ == epoch_ )
+  {
+    release_archive( handle );
+  }
+  initialize( handle , initial_value );
+  return current( handle );
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::reset_all
+  (
+    const Value &
+     initial_value
+  )
+{
+  ++epoch_;
+  epoch_value_ = initial_value;
+  used_ = 0;
+  free_ = none;
+  commits_ = 0;
+}
+
+template< class Value , class Policy >
+ std::size_t
+  archive_pool< Value , Policy >::archives() const
+{
+  return archives_;
+}
+
+template< class Value , class Policy >
+ std::size_t
+  archive_pool< Value , Policy >::commits() const
+{
+  return commits_;
+}
+
+template< class Value , class Policy >
+ std::size_t
+  archive_pool< Value , Policy >::bytes() const
+{
+  return chunks_.size() * ( sizeof( commit ) << chunk_shift ) +
+         slots_.capacity() * sizeof( slot ) +
+         chunks_.capacity() * sizeof( commit * );
+}
+
+/*
+  Implementation of pool_changes<> class members
+*/
+
+template< class Index , bool Track >
+ void
+  pool_changes< Index , Track >::commit
+  (
+    Index
+     index ,
+    bool
+     released
+  )
+{
+}
+
+template< class Index , bool Track >
+ void
+  pool_changes< Index , Track >::archive
+  (
+    Index
+     handle
+  )
+{
+}
+
+template< class Index >
+ bool
+  pool_changes< Index , true >::assign
+  (
+    std::vector< std::uint64_t > &
+     bits ,
+    Index
+     index ,
+    bool
+     value
+  )
+{
+  const std::size_t word = index / 64;
+  const std::uint64_t bit = std::uint64_t( 1 ) << ( index % 64 );
+  if( word >= bits.size() )
+  {
+    bits.resize( word + 1 + bits.size() / 2 , 0 );
+  }
+  const bool before = ( bits[ word ] & bit ) != 0;
+  bits[ word ] = value ? bits[ word ] | bit : bits[ word ] & ~bit;
+  return before;
+}
+
+template< class Index >
+ void
+  pool_changes< Index , true >::commit
+  (
+    Index
+     index ,
+    bool
+     released
+  )
+{
+  assign( released_ , index , released );
+  if( ! assign( marked_commits_ , index , true ) )
+  {
+    commits_.push_back( index );
+  }
+}
+
+template< class Index >
+ void
+  pool_changes< Index , true >::archive
+  (
+    Index
+     handle
+  )
+{
+  if( ! assign( marked_archives_ , handle , true ) )
+  {
+    archives_.push_back( handle );
+  }
+}
+
+template< class Index >
+ bool
+  pool_changes< Index , true >::released
+  (
+    Index
+     index
+  ) const
+{
+  const std::size_t word = index / 64;
+  return word < released_.size() &&
+         ( released_[ word ] >> ( index % 64 ) & 1 ) != 0;
+}
+
+template< class Index >
+ const std::vector< Index > &
+  pool_changes< Index , true >::commits() const
+{
+  return commits_;
+}
+
+template< class Index >
+ const std::vector< Index > &
+  pool_changes< Index , true >::archives() const
+{
+  return archives_;
+}
+
+template< class Index >
+ void
+  pool_changes< Index , true >::clear()
+{
+  for( const auto index : commits_ )
+  {
+    marked_commits_[ index / 64 ] = 0;
+  }
+  for( const auto handle : archives_ )
+  {
+    marked_archives_[ handle / 64 ] = 0;
+  }
+  commits_.clear();
+  archives_.clear();
+}
+
+/*
+  Implementation of archive_pool<>::version class members
+*/
+
+template< class Value , class Policy >
+ Value
+  archive_pool< Value , Policy >::version::compute_diff_to_current
+  (
+    const version &
+     old
+  )
+{
+  if( ! old.valid() )
+  {
+    return Value();
+  }
+  return old.pool_->compute_diff_to_current( old.commit_ );
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::version::version
+  (
+    archive_type *
+     pool ,
+    index_type
+     position
+  )
+  : pool_( pool ) ,
+    commit_( position ) ,
+    epoch_( pool->epoch_ )
+{
+  acquire();
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::version::version()
+  : pool_() ,
+    commit_() ,
+    epoch_()
+{
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::version::version
+  (
+    const version &
+     other
+  )
+  : pool_( other.pool_ ) ,
+    commit_( other.commit_ ) ,
+    epoch_( other.epoch_ )
+{
+  acquire();
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::version::version
+  (
+    version &&
+     other
+  )
+  : pool_( other.pool_ ) ,
+    commit_( other.commit_ ) ,
+    epoch_( other.epoch_ )
+{
+  other.pool_ = nullptr;
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::version &
+  archive_pool< Value , Policy >::version::operator=
+  (
+    const version &
+     other
+  )
+{
+  other.acquire();
+  release();
+  pool_ = other.pool_;
+  commit_ = other.commit_;
+  epoch_ = other.epoch_;
+  return *this;
+}
+
+template< class Value , class Policy >
+ typename archive_pool< Value , Policy >::version &
+  archive_pool< Value , Policy >::version::operator=
+  (
+    version &&
+     other
+  )
+{
+  if( this != &other )
+  {
+    release();
+    pool_ = other.pool_;
+    commit_ = other.commit_;
+    epoch_ = other.epoch_;
+    other.pool_ = nullptr;
+  }
+  return *this;
+}
+
+template< class Value , class Policy >
+  archive_pool< Value , Policy >::version::~version()
+{
+  release();
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::version::acquire() const
+{
+  if( valid() )
+  {
+    ++pool_->at( commit_ ).references_;
+  }
+}
+
+template< class Value , class Policy >
+ void
+  archive_pool< Value , Policy >::version::release() const
+{
+  if( valid() )
+  {
+    pool_->release_commit( commit_ );
+  }
+}
+
+template< class Value , class Policy >
+ bool
+  archive_pool< Value , Policy >::version::valid() const
+{
+  return pool_ && epoch_ == pool_->epoch_;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "archived_pool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <forward_list>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include <malloc.h>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// Counts the bytes and blocks held on the free store,
+// as sized by the C library.
+std::size_t live_bytes = 0 , live_blocks = 0;
+
+void * operator new( std::size_t bytes )
+{
+  void * const memory = std::malloc( bytes );
+  if( ! memory )
+  {
+    throw std::bad_alloc();
+  }
+  live_bytes += malloc_usable_size( memory );
+  ++live_blocks;
+  return memory;
+}
+
+// Not inlined, so the compiler does not pair malloc() with delete.
+__attribute__(( noinline ))
+void operator delete( void * memory ) noexcept
+{
+  if( memory )
+  {
+    live_bytes -= malloc_usable_size( memory );
+    --live_blocks;
+    std::free( memory );
+  }
+}
+
+void report( const char * name , std::size_t counters ,
+             std::size_t bytes , std::size_t blocks ,
+             double built , double destroyed )
+{
+  std::cout << name << ": " << double( bytes ) / counters
+            << " bytes in " << double( blocks ) / counters
+            << " blocks per idle counter, built in " << built * 1e3
+            << " ms, destroyed in " << destroyed * 1e3 << " ms\n";
+}
+
+// The layout of archived<> before commits were kept in an arena:
+// a std::forward_list of commits and the version of the initial one.
+class list_counter
+{
+ public:
+  struct commit;
+  typedef std::forward_list< commit > storage_type;
+  struct commit
+  {
+    storage_type::iterator first;
+    int second;
+  };
+
+  storage_type storage_;
+  storage_type::iterator last_;
+
+  explicit list_counter( int initial )
+  {
+    storage_.push_front( commit{ storage_type::iterator() , 0 } );
+    storage_.front().first = storage_.begin();
+    last_ = storage_.begin();
+    increment_by( initial );
+  }
+
+  void increment_by( int increment )
+  {
+    storage_.front().second = increment;
+    const auto old_head = storage_.begin();
+    storage_.push_front( commit{ storage_type::iterator() , 0 } );
+    storage_.front().first = storage_.begin();
+    old_head->first = storage_.begin();
+  }
+};
+
+const std::size_t counters = 1000000;
+
+// Every counter is created and incremented once, then idles.
+void run_lists()
+{
+  const auto bytes = live_bytes , blocks = live_blocks;
+  auto start = bench_clock::now();
+  std::unique_ptr< std::vector< std::unique_ptr< list_counter > > > all(
+    new std::vector< std::unique_ptr< list_counter > >() );
+  all->reserve( counters );
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    all->emplace_back( new list_counter( 0 ) );
+    all->back()->increment_by( 1 );
+  }
+  const double built = seconds_since( start );
+  const auto used = live_bytes - bytes , used_blocks = live_blocks - blocks;
+
+  start = bench_clock::now();
+  all.reset();
+  report( "node per commit" , counters , used , used_blocks , built ,
+          seconds_since( start ) );
+}
+
+void run_archives()
+{
+  const auto bytes = live_bytes , blocks = live_blocks;
+  auto start = bench_clock::now();
+  std::unique_ptr< std::vector< archived< int > > > all(
+    new std::vector< archived< int > >() );
+  all->reserve( counters );
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    all->emplace_back( 0 );
+    all->back().increment_by( 1 );
+    all->back().clear_history();
+  }
+  const double built = seconds_since( start );
+  const auto used = live_bytes - bytes , used_blocks = live_blocks - blocks;
+
+  start = bench_clock::now();
+  all.reset();
+  report( "std::vector of archived<>" , counters , used , used_blocks , built ,
+          seconds_since( start ) );
+}
+
+void run_pool( std::size_t archives )
+{
+  const auto bytes = live_bytes , blocks = live_blocks;
+  auto start = bench_clock::now();
+  std::unique_ptr< archive_pool< int > > pool( new archive_pool< int >() );
+  std::vector< archive_pool< int >::handle_type > handles;
+  handles.reserve( archives );
+  for( std::size_t c = 0 ; c < archives ; ++c )
+  {
+    handles.push_back( pool->create( 0 ) );
+    pool->increment_by( handles.back() , 1 );
+    pool->value( handles.back() );
+  }
+  const double built = seconds_since( start );
+  const auto used = live_bytes - bytes , used_blocks = live_blocks - blocks;
+
+  start = bench_clock::now();
+  pool.reset();
+  report( archives == counters ? "archive_pool<>" : "archive_pool<>, 5x" ,
+          archives , used , used_blocks , built , seconds_since( start ) );
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << counters << " idle counters of int, "
+            << "counting what they hold on the free store.\n";
+
+  run_lists();
+  run_archives();
+  run_pool( counters );
+  run_pool( 5 * counters );
+
+  return 0;
+}
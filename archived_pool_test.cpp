@@ -0,0 +1,233 @@
+#include "archived_pool.h"
+
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// An int whose operator+= throws once a countdown runs out,
+// like a diff failing to allocate.
+class throwing
+{
+ public:
+  static int countdown;
+  int value;
+
+  throwing() : value( 0 ) {}
+  explicit throwing( int v ) : value( v ) {}
+
+  throwing & operator+= ( const throwing & other )
+  {
+    if( countdown > 0 && --countdown == 0 )
+    {
+      throw std::bad_alloc();
+    }
+    value += other.value;
+    return *this;
+  }
+};
+
+int throwing::countdown = 0;
+
+int main ( int argc , const char ** argv )
+{
+  const std::size_t archives = 10000;
+
+  archive_pool< int > tested_object_1;
+  std::vector< archive_pool< int >::handle_type > handles;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    handles.push_back( tested_object_1.create( static_cast< int >( a ) ) );
+  }
+
+  if( !check_equal( 2 * archives , tested_object_1.commits() ,
+                    "Commits after construction." ) )
+  {
+    return 1;
+  }
+
+  //Interleaved increments, with a version of every archive
+
+  std::cout << "Increment. \n";
+
+  std::vector< archive_pool< int >::version > versions;
+  for( const auto handle : handles )
+  {
+    versions.push_back( tested_object_1.current( handle ) );
+  }
+  for( int round = 0 ; round < 10 ; ++round )
+  {
+    for( std::size_t a = 0 ; a < archives ; ++a )
+    {
+      tested_object_1.increment_by( handles[ a ] , round + int( a % 3 ) );
+    }
+  }
+
+  for( std::size_t a = 0 ; a < archives ; a += 997 )
+  {
+    const int increments = 45 + 10 * int( a % 3 );
+    if( !check_equal( increments , diff_to_current( versions[ a ] ) ,
+                      "Diff to Current." ) ||
+        !check_equal( int( a ) + increments ,
+                      tested_object_1.value( handles[ a ] ) ,
+                      "Value." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Compression releases garbage, dropped versions free their commits
+
+  versions.clear();
+  for( const auto handle : handles )
+  {
+    tested_object_1.value( handle );
+  }
+  if( !check_equal( 2 * archives , tested_object_1.commits() ,
+                    "Commits after compression." ) )
+  {
+    return 1;
+  }
+
+  //Reset and destroy, reusing commits and handles
+
+  std::cout << "Reset and Destroy. \n";
+
+  const auto bytes = tested_object_1.bytes();
+  for( std::size_t a = 0 ; a < archives ; a += 2 )
+  {
+    tested_object_1.destroy( handles[ a ] );
+  }
+  for( std::size_t a = 1 ; a < archives ; a += 2 )
+  {
+    tested_object_1.reset( handles[ a ] , 7 );
+    tested_object_1.increment_by( handles[ a ] , 1 );
+    tested_object_1.value( handles[ a ] );
+  }
+  for( std::size_t a = 0 ; a < archives ; a += 2 )
+  {
+    handles[ a ] = tested_object_1.create( 3 );
+  }
+
+  if( !check_equal( archives , tested_object_1.archives() ,
+                    "Archives after Reset and Destroy." ) ||
+      !check_equal( 8 , tested_object_1.value( handles[ 1 ] ) ,
+                    "Value after Reset." ) ||
+      !check_equal( 3 , tested_object_1.value( handles[ 0 ] ) ,
+                    "Value after Destroy." ) ||
+      !check_equal( 2 * archives , tested_object_1.commits() ,
+                    "Commits after Reset and Destroy." ) ||
+      !check_equal( bytes , tested_object_1.bytes() ,
+                    "Bytes after Reset and Destroy." ) )
+  {
+    return 1;
+  }
+
+  //Group reset, archives reinitialized on their next use
+
+  std::cout << "Reset All. \n";
+
+  const auto before = tested_object_1.current( handles[ 1 ] );
+  tested_object_1.reset_all( 5 );
+  if( !check_equal( 0 , tested_object_1.commits() ,
+                    "Commits after Reset All." ) )
+  {
+    return 1;
+  }
+  const auto after = tested_object_1.current( handles[ 1 ] );
+  tested_object_1.increment_by( handles[ 1 ] , 2 );
+
+  if( !check_equal( false , before.valid() ,
+                    "Validity of an old Version." ) ||
+      !check_equal( 0 , diff_to_current( before ) ,
+                    "Diff to Current of an old Version." ) ||
+      !check_equal( true , after.valid() ,
+                    "Validity of a new Version." ) ||
+      !check_equal( 2 , diff_to_current( after ) ,
+                    "Diff to Current after Reset All." ) ||
+      !check_equal( 7 , tested_object_1.value( handles[ 1 ] ) ,
+                    "Value after Reset All." ) ||
+      !check_equal( 5 , tested_object_1.value( handles[ 2 ] ) ,
+                    "Value of an untouched Archive." ) )
+  {
+    return 1;
+  }
+
+  for( const auto handle : handles )
+  {
+    tested_object_1.increment_by( handle , 1 );
+    tested_object_1.value( handle );
+  }
+  // The version after keeps its commit and the successor.
+  if( !check_equal( 2 * archives + 2 , tested_object_1.commits() ,
+                    "Commits after reuse." ) ||
+      !check_equal( bytes , tested_object_1.bytes() ,
+                    "Bytes after reuse." ) )
+  {
+    return 1;
+  }
+
+  //Values that own memory
+
+  std::cout << "Strings. \n";
+
+  archive_pool< std::string > tested_object_2;
+  const auto text = tested_object_2.create( "a" );
+  const auto start = tested_object_2.current( text );
+  tested_object_2.increment_by( text , "b" );
+  tested_object_2.increment_by( text , "c" );
+  if( !check_equal( 0 , diff_to_current( start ).compare( "bc" ) ,
+                    "Diff to Current of Strings." ) ||
+      !check_equal( 0 , tested_object_2.value( text ).compare( "abc" ) ,
+                    "Value of Strings." ) )
+  {
+    return 1;
+  }
+
+  //A throwing operator+= leaves the history intact
+
+  std::cout << "Throwing Increment. \n";
+
+  archive_pool< throwing > tested_object_3;
+  const auto thrower = tested_object_3.create( throwing( 1 ) );
+  const auto early = tested_object_3.current( thrower );
+  for( int i = 0 ; i < 100 ; ++i )
+  {
+    tested_object_3.increment_by( thrower , throwing( 1 ) );
+  }
+  bool thrown = false;
+  throwing::countdown = 50;
+  try
+  {
+    diff_to_current( early );
+  } catch( const std::bad_alloc & ) {
+    thrown = true;
+  }
+  throwing::countdown = 0;
+  if( !check_equal( true , thrown , "Thrown by operator+=." ) ||
+      !check_equal( 100 , diff_to_current( early ).value ,
+                    "Diff to Current after a Throw." ) ||
+      !check_equal( 101 , tested_object_3.value( thrower ).value ,
+                    "Value after a Throw." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef ARCHIVED_PUBLISHED_H
+#define ARCHIVED_PUBLISHED_H
+
+#include "archived.h"
+#include "archived_seqlock.h"
+/** @file */
+
+/**
+ @brief The current value of an archived<>, published to reader threads.
+
+ # Overview
+
+ A published_view<Value,Policy> increments an archived<Value,Policy>
+ and keeps the running total of its value beside it.
+ Every increment_by() stores the total into a seqlock<>.
+
+ ## Readers:
+
+ value() may be called from any thread concurrently with
+ increment_by(). It copies the published total, without locking
+ and without touching the commits of the archive,
+ which value() of the archive walks and compresses.
+ It is lock-free, not wait-free: a reader retries while stores
+ overlap its copy, so a writer incrementing without pause can delay it.
+
+ Value has to be trivially copyable, it may be wider than any
+ atomic type. increment_by(), reset() and publish() must not be called
+ concurrently, and all other uses of the archive stay with the writer.
+ The total is only updated by the view, so after changing the archive
+ directly, e.g. by its increment_by(), reset() or clear_history(),
+ the writer has to call publish().
+*/
+template< class Value , class Policy = archived_defaults >
+class published_view
+{
+ public:
+  typedef archived< Value , Policy > archive_type;
+                                    /**< @brief The archive's type. */
+  typedef typename archive_type::version_type version_type;
+                                    /**< @brief The type of versions. */
+
+ private:
+  archive_type & archive_; /**< @internal @brief The incremented archive. */
+  Value total_; /**< @internal @brief The current value, writer side. */
+  seqlock< Value > published_; /**< @internal @brief The current value,
+                                    for readers. */
+
+ public:
+  /**
+   @brief Constructor that attaches to archive
+   and publishes its current value.
+  */
+  explicit published_view
+  (
+    archive_type &
+     archive /**< The archive to increment. */
+  );
+
+  published_view( const published_view & other ) = delete;
+  published_view & operator= ( const published_view & other ) = delete;
+
+  /**
+   @brief Increments the archive by increment
+   and publishes the new value.
+
+   @return The version returned by the archive.
+  */
+  version_type increment_by
+  (
+    const Value &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Resets the archive to initial_value
+   and publishes it.
+
+   @return The version returned by the archive.
+  */
+  version_type reset
+  (
+    const Value &
+     initial_value /**< The new value. */
+  );
+
+  /**
+   @brief Reads the value of the archive and publishes it,
+   after the archive was changed directly.
+  */
+  void publish();
+
+  /**
+   @brief Returns the last published value.
+   Lock-free, may be called from any thread.
+
+   @return The current value.
+  */
+  Value value() const;
+};
+
+
+
+/*
+  Implementation of published_view<> class members
+*/
+
+template< class Value , class Policy >
+  published_view< Value , Policy >::published_view
+  (
+    archive_type &
+     archive
+  )
+  : archive_( archive ) ,
+    total_( archive.value() ) ,
+    published_( total_ )
+{
+}
+
+template< class Value , class Policy >
+ typename published_view< Value , Policy >::version_type
+  published_view< Value , Policy >::increment_by
+  (
+    const Value &
+     increment
+  )
+{
+  const auto result = archive_.increment_by( increment );
+  total_ += increment;
+  published_.store( total_ );
+  return result;
+}
+
+template< class Value , class Policy >
+ typename published_view< Value , Policy >::version_type
+  published_view< Value , Policy >::reset
+  (
+    const Value &
+     initial_value
+  )
+{
+  const auto result = archive_.reset( initial_value );
+  publish();
+  return result;
+}
+
+template< class Value , class Policy >
+ void
+  published_view< Value , Policy >::publish()
+{
+  total_ = archive_.value();
+  published_.store( total_ );
+}
+
+template< class Value , class Policy >
+ Value
+  published_view< Value , Policy >::value() const
+{
+  return published_.load();
+}
+
+#endif
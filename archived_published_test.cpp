@@ -0,0 +1,112 @@
+#include "archived_published.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// A value wider than any atomic type, torn reads would mix its lanes.
+class lanes
+{
+ public:
+  std::int64_t lane[ 4 ];
+
+  lanes & operator+= ( const lanes & other )
+  {
+    for( int i = 0 ; i < 4 ; ++i ) lane[ i ] += other.lane[ i ];
+    return *this;
+  }
+};
+
+int main ( int argc , const char ** argv )
+{
+  const std::int64_t increments = 200000;
+
+  archived< lanes > tested_archive( lanes{ { 13 , 13 , 13 , 13 } } );
+  published_view< lanes > tested_object_1( tested_archive );
+
+  if( !check_equal( 13 , tested_object_1.value().lane[ 3 ] ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Increment, Concurrent Reader. \n";
+
+  const auto start = tested_archive.current();
+  std::atomic< bool > done( false );
+  std::int64_t torn = 0 , backwards = 0 , reads = 0;
+  std::thread reader( [ & ]()
+  {
+    std::int64_t previous = 13;
+    while( ! done.load( std::memory_order_acquire ) )
+    {
+      const auto seen = tested_object_1.value();
+      torn += seen.lane[ 0 ] != seen.lane[ 1 ] ||
+              seen.lane[ 0 ] != seen.lane[ 3 ];
+      backwards += seen.lane[ 0 ] < previous;
+      previous = seen.lane[ 0 ];
+      ++reads;
+    }
+  } );
+
+  for( std::int64_t i = 0 ; i < increments ; ++i )
+  {
+    tested_object_1.increment_by( lanes{ { 1 , 1 , 1 , 1 } } );
+  }
+  done.store( true , std::memory_order_release );
+  reader.join();
+
+  std::cout << reads << " reads. \n";
+  if( !check_equal( 0 , torn , "Torn reads." ) ||
+      !check_equal( 0 , backwards , "Reads going backwards." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( 13 + increments , tested_object_1.value().lane[ 2 ] ,
+                    "Published value." ) ||
+      !check_equal( 13 + increments , tested_archive.value().lane[ 2 ] ,
+                    "Value of the archive." ) ||
+      !check_equal( increments , diff_to_current( start ).lane[ 1 ] ,
+                    "Diff to Current of the archive." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Reset. \n";
+
+  tested_object_1.reset( lanes{ { 5 , 5 , 5 , 5 } } );
+  if( !check_equal( 5 , tested_object_1.value().lane[ 0 ] ,
+                    "Published value after reset." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Direct Use of the Archive. \n";
+
+  tested_archive.increment_by( lanes{ { 2 , 2 , 2 , 2 } } );
+  tested_object_1.publish();
+  if( !check_equal( 7 , tested_object_1.value().lane[ 1 ] ,
+                    "Published value after publish()." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
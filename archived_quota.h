@@ -0,0 +1,405 @@
+#ifndef ARCHIVED_QUOTA_H
+#define ARCHIVED_QUOTA_H
+
+#include "archived.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+/** @file */
+
+/**
+ @brief The policy of the archives of a quota_engine<>.
+*/
+class quota_policy : public archived_defaults
+{
+ public:
+  static const bool track_references = true;
+    /**< @brief clear_history() keeps the commits the versions
+         of the window reach, and releases the others. */
+};
+
+/**
+ @brief Per-key sliding window quotas, built on archived<> counters.
+
+ # Overview
+
+ A quota_engine<Key,Count> admits usage of a key while the usage
+ within the last window stays within the quota.
+
+ Every key owns an archived<Count>.
+ The window is divided into slices, and for every slice the engine
+ keeps the version at which the slice started.
+ The usage in the window is the diff_to_current() of the version
+ at the start of the oldest slice, so windows slide with the clock
+ instead of being reset by a timer.
+
+ ## Cost:
+
+ try_acquire() is O(1): one hash lookup, one diff_to_current()
+ and one increment_by().
+ When a slice ends, the versions of the slices that left the window
+ are replaced and clear_history() releases the commits only they
+ reached. The history thus shrinks to one commit per slice boundary,
+ and never grows beyond that plus the increments of one slice.
+
+ ## Threads:
+
+ Keys are distributed over independently locked shards,
+ so threads only contend on keys of the same shard.
+ Count has to support operator+, operator- and operator<.
+*/
+template< class Key , class Count = long ,
+          class Hash = std::hash< Key > ,
+          class Clock = std::chrono::steady_clock >
+class quota_engine
+{
+ public:
+  typedef Key key_type; /**< @brief The type of keys. */
+  typedef Count count_type; /**< @brief The type of usage counts. */
+  typedef typename Clock::time_point time_point; /**< @brief Timestamps. */
+  typedef typename Clock::duration duration; /**< @brief Durations. */
+
+ private:
+  class entry;
+  class shard;
+
+  typedef std::int64_t slice_type; /**< @internal @brief Number of a slice,
+                                        counted from the clock's epoch. */
+
+  Count quota_; /**< @internal @brief The usage admitted per window. */
+  duration slice_length_; /**< @internal @brief The length of a slice. */
+  std::size_t slices_; /**< @internal @brief The slices per window. */
+  std::vector< shard > shards_; /**< @internal @brief The shards. */
+
+  /**
+   @internal @brief Returns the shard responsible for key.
+  */
+  shard & shard_of
+  (
+    const Key &
+     key /**< The key. */
+  );
+
+  /**
+   @internal @brief Returns the number of the slice containing now.
+  */
+  slice_type slice_at
+  (
+    time_point
+     now /**< The time. */
+  ) const;
+
+ public:
+  /**
+   @brief Constructor.
+   The window has to be a multiple of the slice length implied
+   by slices, otherwise it is rounded down.
+  */
+  quota_engine
+  (
+    Count
+     quota , /**< The usage admitted per window. */
+    duration
+     window , /**< The length of the sliding window. */
+    std::size_t
+     slices = 8 , /**< The number of slices per window. */
+    std::size_t
+     shards = 64 /**< The number of independently locked shards. */
+  );
+
+  quota_engine( const quota_engine & other ) = delete;
+  quota_engine & operator= ( const quota_engine & other ) = delete;
+
+  /**
+   @brief Admits n units of usage for key, if the usage of key
+   within the window stays within the quota.
+   Admitted usage is counted, rejected usage is not.
+
+   @return true, if the usage was admitted.
+  */
+  bool try_acquire
+  (
+    const Key &
+     key , /**< The key. */
+    Count
+     n = Count( 1 ) , /**< The units of usage. */
+    time_point
+     now = Clock::now() /**< The time of the usage. */
+  );
+
+  /**
+   @brief Returns the usage of key within the window ending at now.
+
+   @return The usage of key.
+  */
+  Count usage
+  (
+    const Key &
+     key , /**< The key. */
+    time_point
+     now = Clock::now() /**< The end of the window. */
+  );
+
+  /**
+   @brief Forgets all keys without usage in the window ending at now.
+
+   @return The number of forgotten keys.
+  */
+  std::size_t evict_idle
+  (
+    time_point
+     now = Clock::now() /**< The end of the window. */
+  );
+};
+
+/**
+ @internal @brief The usage history of one key.
+*/
+template< class Key , class Count , class Hash , class Clock >
+class quota_engine< Key , Count , Hash , Clock >::entry
+{
+ public:
+  typedef archived< Count , quota_policy > archive_type; /**< @internal */
+  typedef typename archive_type::version_type version_type; /**< @internal */
+
+  archive_type usage_; /**< @internal @brief All admitted usage. */
+  std::vector< version_type > slice_starts_; /**< @internal @brief Version
+                                                   at the start of each slice,
+                                                   indexed by slice modulo
+                                                   the number of slices. */
+  slice_type slice_; /**< @internal @brief The newest slice seen. */
+
+  /**
+   @internal @brief Constructs an entry without usage.
+  */
+  entry
+  (
+    std::size_t
+     slices , /**< The slices per window. */
+    slice_type
+     slice /**< The current slice. */
+  );
+
+  /**
+   @internal @brief Advances to slice, dropping the slices
+   that left the window and the history only they reached.
+  */
+  void advance
+  (
+    slice_type
+     slice /**< The current slice. */
+  );
+
+  /**
+   @internal @brief Returns the usage within the window.
+  */
+  Count window_usage() const;
+};
+
+/**
+ @internal @brief A locked subset of the keys.
+*/
+template< class Key , class Count , class Hash , class Clock >
+class alignas( 64 ) quota_engine< Key , Count , Hash , Clock >::shard
+{
+ public:
+  std::mutex mutex_; /**< @internal @brief Guards entries_. */
+  std::unordered_map< Key , std::unique_ptr< entry > , Hash > entries_;
+                       /**< @internal @brief The keys of the shard. */
+};
+
+
+
+/*
+  Implementation of quota_engine<> class members
+*/
+
+template< class Key , class Count , class Hash , class Clock >
+  quota_engine< Key , Count , Hash , Clock >::quota_engine
+  (
+    Count
+     quota ,
+    duration
+     window ,
+    std::size_t
+     slices ,
+    std::size_t
+     shards
+  )
+  : quota_( quota ) ,
+    slice_length_( window / static_cast< typename duration::rep >( slices ) ) ,
+    slices_( slices ) ,
+    shards_( shards )
+{
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ typename quota_engine< Key , Count , Hash , Clock >::shard &
+  quota_engine< Key , Count , Hash , Clock >::shard_of
+  (
+    const Key &
+     key
+  )
+{
+  // Mix the hash, so shards and map buckets use different bits.
+  const std::uint64_t hash =
+    static_cast< std::uint64_t >( Hash()( key ) ) * 0x9e3779b97f4a7c15ULL;
+  return shards_[ ( hash >> 32 ) % shards_.size() ];
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ typename quota_engine< Key , Count , Hash , Clock >::slice_type
+  quota_engine< Key , Count , Hash , Clock >::slice_at
+  (
+    time_point
+     now
+  ) const
+{
+  return now.time_since_epoch() / slice_length_;
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ bool
+  quota_engine< Key , Count , Hash , Clock >::try_acquire
+  (
+    const Key &
+     key ,
+    Count
+     n ,
+    time_point
+     now
+  )
+{
+  const auto slice = slice_at( now );
+  auto & target = shard_of( key );
+  std::lock_guard< std::mutex > lock( target.mutex_ );
+
+  auto & found = target.entries_[ key ];
+  if( ! found )
+  {
+    found.reset( new entry( slices_ , slice ) );
+  }
+  found->advance( slice );
+
+  if( quota_ < found->window_usage() + n )
+  {
+    return false;
+  }
+  found->usage_.increment_by( n );
+  return true;
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ Count
+  quota_engine< Key , Count , Hash , Clock >::usage
+  (
+    const Key &
+     key ,
+    time_point
+     now
+  )
+{
+  auto & target = shard_of( key );
+  std::lock_guard< std::mutex > lock( target.mutex_ );
+
+  const auto found = target.entries_.find( key );
+  if( found == target.entries_.end() )
+  {
+    return Count();
+  }
+  found->second->advance( slice_at( now ) );
+  return found->second->window_usage();
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ std::size_t
+  quota_engine< Key , Count , Hash , Clock >::evict_idle
+  (
+    time_point
+     now
+  )
+{
+  const auto slice = slice_at( now );
+  std::size_t evicted = 0;
+
+  for( auto & current : shards_ )
+  {
+    std::lock_guard< std::mutex > lock( current.mutex_ );
+    auto position = current.entries_.begin();
+    while( position != current.entries_.end() )
+    {
+      position->second->advance( slice );
+      if( position->second->window_usage() == Count() )
+      {
+        position = current.entries_.erase( position );
+        ++evicted;
+      } else {
+        ++position;
+      }
+    }
+  }
+  return evicted;
+}
+
+/*
+  Implementation of quota_engine<>::entry class members
+*/
+
+template< class Key , class Count , class Hash , class Clock >
+  quota_engine< Key , Count , Hash , Clock >::entry::entry
+  (
+    std::size_t
+     slices ,
+    slice_type
+     slice
+  )
+  : usage_( Count() ) ,
+    slice_starts_( slices , usage_.current() ) ,
+    slice_( slice )
+{
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ void
+  quota_engine< Key , Count , Hash , Clock >::entry::advance
+  (
+    slice_type
+     slice
+  )
+{
+  if( slice <= slice_ )
+  {
+    return;
+  }
+
+  // The slices that entered the window start at the current version,
+  // replacing the versions of the slices that left it.
+  const auto slices = static_cast< slice_type >( slice_starts_.size() );
+  const auto start = usage_.current();
+  for( auto s = slice_ + 1 ; s <= slice && s <= slice_ + slices ; ++s )
+  {
+    slice_starts_[ static_cast< std::size_t >( ( s % slices + slices ) %
+                                               slices ) ] = start;
+  }
+  slice_ = slice;
+
+  // Compresses the remaining slice starts to one diff each.
+  usage_.clear_history();
+}
+
+template< class Key , class Count , class Hash , class Clock >
+ Count
+  quota_engine< Key , Count , Hash , Clock >::entry::window_usage() const
+{
+  const auto slices = static_cast< slice_type >( slice_starts_.size() );
+  const auto oldest = ( ( slice_ + 1 ) % slices + slices ) % slices;
+  return diff_to_current( slice_starts_[ static_cast< std::size_t >( oldest ) ] );
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include "archived_quota.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+const std::uint64_t keys = 1000000;
+const std::uint64_t decisions_per_thread = 4000000;
+
+// Each thread draws keys uniformly, while simulated time advances
+// by one millisecond per 1000 decisions, so windows keep sliding.
+void run( quota_engine< std::uint64_t > & engine , unsigned threads )
+{
+  std::vector< std::thread > workers;
+  std::vector< std::uint64_t > admitted( threads );
+
+  const auto start = bench_clock::now();
+  for( unsigned t = 0 ; t < threads ; ++t )
+  {
+    workers.emplace_back( [ & , t ]()
+    {
+      std::mt19937_64 random( t );
+      for( std::uint64_t i = 0 ; i < decisions_per_thread ; ++i )
+      {
+        const auto now = bench_clock::time_point(
+          std::chrono::milliseconds( 1000000 + i / 1000 ) );
+        admitted[ t ] += engine.try_acquire( random() % keys , 1 , now );
+      }
+    } );
+  }
+  for( auto & worker : workers )
+  {
+    worker.join();
+  }
+  const double elapsed = seconds_since( start );
+
+  std::uint64_t total_admitted = 0;
+  for( auto a : admitted ) total_admitted += a;
+
+  std::cout << threads << " thread(s): "
+            << threads * decisions_per_thread / elapsed / 1e6
+            << " M decisions/s, "
+            << total_admitted << " admitted\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << "quota_engine, " << keys << " keys, quota 3 per second.\n";
+
+  {
+    quota_engine< std::uint64_t > engine( 3 , std::chrono::seconds( 1 ) , 8 , 256 );
+
+    // Touch every key once, so the run measures steady state.
+    const auto warm = bench_clock::time_point( std::chrono::seconds( 999 ) );
+    const auto warm_start = bench_clock::now();
+    for( std::uint64_t k = 0 ; k < keys ; ++k )
+    {
+      engine.try_acquire( k , 1 , warm );
+    }
+    std::cout << "warm up: " << keys / seconds_since( warm_start ) / 1e6
+              << " M decisions/s\n";
+
+    run( engine , 1 );
+    const unsigned hardware = std::max( 1u , std::thread::hardware_concurrency() );
+    if( hardware > 1 )
+    {
+      run( engine , hardware );
+    }
+  }
+
+  return 0;
+}
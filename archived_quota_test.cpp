@@ -0,0 +1,93 @@
+#include "archived_quota.h"
+
+#include <string>
+#include <iostream>
+
+bool check_equal( long a , long b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+typedef std::chrono::steady_clock test_clock;
+
+test_clock::time_point at_second( long s )
+{
+  return test_clock::time_point( std::chrono::seconds( s ) );
+}
+
+int main ( int argc , const char ** argv )
+{
+  //Quota of 10 per 4 seconds, in slices of one second
+  quota_engine< std::string > tested_object_1( 10 , std::chrono::seconds( 4 ) ,
+                                               4 , 8 );
+
+  std::cout << "Acquire. \n";
+
+  if( !check_equal( true , tested_object_1.try_acquire( "a" , 6 , at_second( 100 ) ) ,
+                    "Within quota." ) ||
+      !check_equal( true , tested_object_1.try_acquire( "a" , 4 , at_second( 101 ) ) ,
+                    "Exactly the quota." ) ||
+      !check_equal( false , tested_object_1.try_acquire( "a" , 1 , at_second( 102 ) ) ,
+                    "Above quota." ) ||
+      !check_equal( true , tested_object_1.try_acquire( "b" , 10 , at_second( 102 ) ) ,
+                    "Keys are independent." ) ||
+      !check_equal( 10 , tested_object_1.usage( "a" , at_second( 103 ) ) ,
+                    "Usage within window." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Slide. \n";
+
+  //At 104 the slice of 100 left the window
+  if( !check_equal( 4 , tested_object_1.usage( "a" , at_second( 104 ) ) ,
+                    "Usage after the first slice left." ) ||
+      !check_equal( false , tested_object_1.try_acquire( "a" , 7 , at_second( 104 ) ) ,
+                    "Still above quota." ) ||
+      !check_equal( true , tested_object_1.try_acquire( "a" , 6 , at_second( 104 ) ) ,
+                    "Freed quota is admitted." ) ||
+      !check_equal( 6 , tested_object_1.usage( "a" , at_second( 105 ) ) ,
+                    "Usage after the second slice left." ) ||
+      !check_equal( 0 , tested_object_1.usage( "a" , at_second( 200 ) ) ,
+                    "Usage after a long pause." ) )
+  {
+    return 1;
+  }
+
+  //Many small acquisitions across many slices
+  long admitted = 0;
+  for( long t = 1000 ; t < 1100 ; ++t )
+  {
+    for( int i = 0 ; i < 5 ; ++i )
+    {
+      admitted += tested_object_1.try_acquire( "c" , 1 , at_second( t ) );
+    }
+  }
+  //Each slice admits what left the window: 10 per 4 seconds
+  if( !check_equal( 250 , admitted , "Admitted over 100 seconds." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Evict. \n";
+
+  if( !check_equal( 2 , tested_object_1.evict_idle( at_second( 1100 ) ) ,
+                    "Idle keys evicted." ) ||
+      !check_equal( 1 , tested_object_1.evict_idle( at_second( 2000 ) ) ,
+                    "Remaining key evicted after the window." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,164 @@
+#include "archived.h"
+#include "archived_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <forward_list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// The storage of archived<> before commits were kept in an arena:
+// one node per commit, freed one at a time by reset().
+class list_counter
+{
+ public:
+  struct commit;
+  typedef std::forward_list< commit > storage_type;
+  struct commit
+  {
+    storage_type::iterator first;
+    std::uint64_t second;
+  };
+
+  storage_type storage_;
+
+  explicit list_counter( std::uint64_t initial ) { reset( initial ); }
+
+  void increment_by( std::uint64_t increment )
+  {
+    storage_.front().second = increment;
+    const auto old_head = storage_.begin();
+    storage_.push_front( commit{ storage_type::iterator() , 0 } );
+    storage_.front().first = storage_.begin();
+    old_head->first = storage_.begin();
+  }
+
+  void reset( std::uint64_t initial )
+  {
+    storage_.clear();
+    storage_.push_front( commit{ storage_type::iterator() , 0 } );
+    storage_.front().first = storage_.begin();
+    increment_by( initial );
+  }
+};
+
+const std::size_t counters = 1000;
+const std::size_t increments_per_interval = 1000;
+const std::size_t intervals = 20;
+
+// Every interval increments each counter, then resets all of them,
+// as a service exporting per-interval counters does.
+template< class Counter >
+void run( const char * name )
+{
+  std::vector< std::unique_ptr< Counter > > all;
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    all.emplace_back( new Counter( 0 ) );
+  }
+
+  double increment_seconds = 0;
+  double reset_seconds = 0;
+  double worst_reset = 0;
+  for( std::size_t interval = 0 ; interval < intervals ; ++interval )
+  {
+    const auto increment_start = bench_clock::now();
+    for( std::size_t i = 0 ; i < increments_per_interval ; ++i )
+    {
+      for( auto & counter : all )
+      {
+        counter->increment_by( i );
+      }
+    }
+    increment_seconds += seconds_since( increment_start );
+
+    const auto reset_start = bench_clock::now();
+    for( auto & counter : all )
+    {
+      counter->reset( 0 );
+    }
+    const double pause = seconds_since( reset_start );
+    reset_seconds += pause;
+    worst_reset = std::max( worst_reset , pause );
+  }
+
+  std::cout << name << ": "
+            << intervals * counters * increments_per_interval /
+               increment_seconds / 1e6
+            << " M increments/s, reset of all counters "
+            << reset_seconds / intervals * 1e3 << " ms on average, "
+            << worst_reset * 1e3 << " ms at worst\n";
+}
+
+// The same, with all counters in one archive_pool<>,
+// reset one by one or together by reset_all().
+void run_pool( const char * name , bool group )
+{
+  archive_pool< std::uint64_t > pool;
+  std::vector< archive_pool< std::uint64_t >::handle_type > all;
+  for( std::size_t c = 0 ; c < counters ; ++c )
+  {
+    all.push_back( pool.create( 0 ) );
+  }
+
+  double increment_seconds = 0;
+  double reset_seconds = 0;
+  double worst_reset = 0;
+  for( std::size_t interval = 0 ; interval < intervals ; ++interval )
+  {
+    const auto increment_start = bench_clock::now();
+    for( std::size_t i = 0 ; i < increments_per_interval ; ++i )
+    {
+      for( const auto counter : all )
+      {
+        pool.increment_by( counter , i );
+      }
+    }
+    increment_seconds += seconds_since( increment_start );
+
+    const auto reset_start = bench_clock::now();
+    if( group )
+    {
+      pool.reset_all( 0 );
+    } else {
+      for( const auto counter : all )
+      {
+        pool.reset( counter , 0 );
+      }
+    }
+    const double pause = seconds_since( reset_start );
+    reset_seconds += pause;
+    worst_reset = std::max( worst_reset , pause );
+  }
+
+  std::cout << name << ": "
+            << intervals * counters * increments_per_interval /
+               increment_seconds / 1e6
+            << " M increments/s, reset of all counters "
+            << reset_seconds / intervals * 1e3 << " ms on average, "
+            << worst_reset * 1e3 << " ms at worst\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << counters << " counters, " << increments_per_interval
+            << " increments each per interval, " << intervals
+            << " intervals.\n";
+
+  run< list_counter >( "node per commit" );
+  run< archived< std::uint64_t > >( "archived<>" );
+  run_pool( "archive_pool<>, reset()" , false );
+  run_pool( "archive_pool<>, reset_all()" , true );
+
+  return 0;
+}
@@ -0,0 +1,326 @@
+#ifndef ARCHIVED_ROLLUP_H
+#define ARCHIVED_ROLLUP_H
+
+#include "archived.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+/** @file */
+
+/**
+ @brief A tree of archived<> counters, where every node
+ accumulates the increments of its subtree.
+
+ # Overview
+
+ A rollup_archive<Value> holds one archived<Value> per node of a tree,
+ e.g. host, service and cluster.
+ Incrementing a node increments it and all its ancestors.
+
+ ## Deferred propagation:
+
+ increment_by() only adds the increment to a pending value of the node,
+ in O(1) and without creating a commit.
+ Pending values are propagated in one batch before a node is queried:
+ deepest nodes first, each dirty node commits its pending value once
+ and hands it on to its parent.
+
+ A burst of increments thus costs one commit per touched node
+ and query, independent of the tree's depth times the number
+ of increments. Versions are taken per node, so the diff of a cluster
+ is one diff_to_current() on the cluster's archive, not one per leaf.
+
+ rollup_archive<>::diff_to_current() flushes first, so it sees
+ every increment. The free diff_to_current() on a version of a node
+ only sees the increments up to the last query or flush().
+*/
+template< class Value >
+class rollup_archive
+{
+ public:
+  typedef std::size_t node_id; /**< @brief Identifies a node. */
+  typedef archived< Value > archive_type;
+                            /**< @brief The archive type of a node. */
+  typedef typename archive_type::version_type version_type;
+                            /**< @brief The type of versions. */
+
+  static const node_id root = 0; /**< @brief The root node. */
+
+ private:
+  class node;
+
+  std::vector< node > nodes_; /**< @internal @brief All nodes,
+                                   indexed by node_id. */
+  std::vector< std::vector< node_id > > dirty_; /**< @internal @brief Nodes
+                                                     with a pending value,
+                                                     by depth. */
+
+  /**
+   @internal @brief Adds increment to the pending value of id.
+  */
+  void defer
+  (
+    node_id
+     id , /**< The node. */
+    const Value &
+     increment /**< The value to add. */
+  );
+
+ public:
+  /**
+   @brief Constructor that creates the root with initial_value.
+  */
+  explicit rollup_archive
+  (
+    const Value &
+     initial_value /**< The initial value of the root. */
+  );
+
+  rollup_archive( const rollup_archive & other ) = delete;
+  rollup_archive & operator= ( const rollup_archive & other ) = delete;
+
+  /**
+   @brief Adds a child of parent with value zero.
+
+   @return The id of the new node.
+  */
+  node_id add_node
+  (
+    node_id
+     parent /**< The parent of the new node. */
+  );
+
+  /**
+   @brief Increments id and all its ancestors by increment.
+   The ancestors are updated lazily.
+  */
+  void increment_by
+  (
+    node_id
+     id , /**< The node to increment. */
+    const Value &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value of id,
+   including the increments of its subtree.
+
+   @return The current value of id.
+  */
+  Value value
+  (
+    node_id
+     id /**< The node. */
+  );
+
+  /**
+   @brief Returns a new version of id.
+   diff_to_current() of the version yields the increments
+   of the subtree of id since now.
+
+   @return A new version.
+  */
+  version_type current
+  (
+    node_id
+     id /**< The node. */
+  );
+
+  /**
+   @brief Commits all pending increments, then returns
+   the increments of the subtree of the version's node
+   since the version was taken.
+
+   @return The difference from the version to the current value.
+  */
+  Value diff_to_current
+  (
+    const version_type &
+     since /**< A version of a node of this rollup_archive<>. */
+  );
+
+  /**
+   @brief Commits all pending increments, deepest nodes first.
+   Queries through the rollup_archive<> do this implicitly,
+   the free diff_to_current() on a version of a node does not.
+  */
+  void flush();
+
+  /**
+   @brief Brings all nodes up to date and returns the archive of id.
+   The archive is only current until the next increment_by().
+
+   @return The archive of id.
+  */
+  archive_type & archive
+  (
+    node_id
+     id /**< The node. */
+  );
+};
+
+/**
+ @internal @brief A node of the tree.
+*/
+template< class Value >
+class rollup_archive< Value >::node
+{
+ public:
+  node_id parent_; /**< @internal @brief The parent, root for the root. */
+  std::size_t depth_; /**< @internal @brief Distance to the root. */
+  std::unique_ptr< archive_type > archive_; /**< @internal @brief The
+                                                 committed value. */
+  Value pending_; /**< @internal @brief Increments not yet committed. */
+  bool dirty_; /**< @internal @brief Whether pending_ holds increments. */
+};
+
+
+
+/*
+  Implementation of rollup_archive<> class members
+*/
+
+template< class Value >
+ const typename rollup_archive< Value >::node_id
+  rollup_archive< Value >::root;
+
+template< class Value >
+  rollup_archive< Value >::rollup_archive
+  (
+    const Value &
+     initial_value
+  )
+  : nodes_() ,
+    dirty_( 1 )
+{
+  nodes_.push_back( node{ root , 0 ,
+                          std::unique_ptr< archive_type >(
+                            new archive_type( initial_value ) ) ,
+                          Value() , false } );
+}
+
+template< class Value >
+ typename rollup_archive< Value >::node_id
+  rollup_archive< Value >::add_node
+  (
+    node_id
+     parent
+  )
+{
+  const auto depth = nodes_[ parent ].depth_ + 1;
+  if( dirty_.size() <= depth )
+  {
+    dirty_.resize( depth + 1 );
+  }
+
+  nodes_.push_back( node{ parent , depth ,
+                          std::unique_ptr< archive_type >(
+                            new archive_type( Value() ) ) ,
+                          Value() , false } );
+  return nodes_.size() - 1;
+}
+
+template< class Value >
+ void
+  rollup_archive< Value >::defer
+  (
+    node_id
+     id ,
+    const Value &
+     increment
+  )
+{
+  auto & target = nodes_[ id ];
+  if( target.dirty_ )
+  {
+    target.pending_ += increment;
+  } else {
+    target.pending_ = increment;
+    target.dirty_ = true;
+    dirty_[ target.depth_ ].push_back( id );
+  }
+}
+
+template< class Value >
+ void
+  rollup_archive< Value >::flush()
+{
+  for( auto depth = dirty_.size() ; depth-- > 0 ; )
+  {
+    for( const auto id : dirty_[ depth ] )
+    {
+      auto & current = nodes_[ id ];
+      current.archive_->increment_by( current.pending_ );
+      if( id != root )
+      {
+        defer( current.parent_ , current.pending_ );
+      }
+      current.pending_ = Value();
+      current.dirty_ = false;
+    }
+    dirty_[ depth ].clear();
+  }
+}
+
+template< class Value >
+ void
+  rollup_archive< Value >::increment_by
+  (
+    node_id
+     id ,
+    const Value &
+     increment
+  )
+{
+  defer( id , increment );
+}
+
+template< class Value >
+ Value
+  rollup_archive< Value >::value
+  (
+    node_id
+     id
+  )
+{
+  return archive( id ).value();
+}
+
+template< class Value >
+ typename rollup_archive< Value >::version_type
+  rollup_archive< Value >::current
+  (
+    node_id
+     id
+  )
+{
+  return archive( id ).current();
+}
+
+template< class Value >
+ Value
+  rollup_archive< Value >::diff_to_current
+  (
+    const version_type &
+     since
+  )
+{
+  flush();
+  return ::diff_to_current( since );
+}
+
+template< class Value >
+ typename rollup_archive< Value >::archive_type &
+  rollup_archive< Value >::archive
+  (
+    node_id
+     id
+  )
+{
+  flush();
+  return *nodes_[ id ].archive_;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "archived_rollup.h"
+
+#include <vector>
+#include <iostream>
+
+bool check_equal( int a , int b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+int main ( int argc , const char ** argv )
+{
+  typedef rollup_archive<int>::node_id node_id;
+
+  // provide the test data: cluster -> 2 services -> 3 hosts each
+  int initial_value = 13;
+  rollup_archive<int> tested_object_1( initial_value );
+
+  std::vector< node_id > parents = { rollup_archive<int>::root };
+  std::vector< node_id > services , hosts;
+  for( int s = 0 ; s < 2 ; ++s )
+  {
+    services.push_back( tested_object_1.add_node( rollup_archive<int>::root ) );
+    parents.push_back( rollup_archive<int>::root );
+    for( int h = 0 ; h < 3 ; ++h )
+    {
+      hosts.push_back( tested_object_1.add_node( services.back() ) );
+      parents.push_back( services.back() );
+    }
+  }
+  const std::size_t nodes = parents.size();
+
+  //Check if initial values are correct
+  if( !check_equal( initial_value , tested_object_1.value( 0 ) ,
+                    "Root value after construction." ) ||
+      !check_equal( 0 , tested_object_1.value( hosts[ 0 ] ) ,
+                    "Host value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Versions of every node, taken between bursts of increments
+  std::vector< std::vector< rollup_archive<int>::version_type > > versions;
+  std::vector< std::vector< int > > control_values;
+
+  std::cout << "Increment. \n";
+
+  for( int burst = 0 ; burst < 5 ; ++burst )
+  {
+    versions.push_back( std::vector< rollup_archive<int>::version_type >() );
+    control_values.push_back( std::vector< int >( nodes ) );
+    for( node_id n = 0 ; n < nodes ; ++n )
+    {
+      versions.back().push_back( tested_object_1.current( n ) );
+    }
+
+    for( int i = 0 ; i < 20 ; ++i )
+    {
+      // Mostly hosts, sometimes services directly.
+      const node_id target = ( i % 7 == 0 ) ? services[ i % 2 ]
+                                            : hosts[ ( i * burst ) % 6 ];
+      const int increment = i + burst;
+      tested_object_1.increment_by( target , increment );
+
+      for( auto & control : control_values )
+      {
+        for( node_id n = target ; ; n = parents[ n ] )
+        {
+          control[ n ] += increment;
+          if( n == rollup_archive<int>::root ) break;
+        }
+      }
+    }
+  }
+
+  std::cout << "Increment Check. \n";
+
+  tested_object_1.flush();
+
+  for( std::size_t b = 0 ; b < versions.size() ; ++b )
+  {
+    for( node_id n = 0 ; n < nodes ; ++n )
+    {
+      if( !check_equal( control_values[ b ][ n ] ,
+                        diff_to_current( versions[ b ][ n ] ) ,
+                        "Diff to Current of a node." ) )
+      {
+        return 1;
+      }
+    }
+  }
+
+  //Root value includes everything
+  int total = initial_value;
+  for( node_id n = 0 ; n < nodes ; ++n )
+  {
+    if( parents[ n ] == rollup_archive<int>::root && n != 0 )
+    {
+      total += tested_object_1.value( n );
+    }
+  }
+  if( !check_equal( total , tested_object_1.value( 0 ) ,
+                    "Root value is the sum of its children." ) )
+  {
+    return 1;
+  }
+
+  std::cout << "Unflushed Increment. \n";
+
+  const auto cluster = tested_object_1.current( rollup_archive<int>::root );
+  const auto service = tested_object_1.current( services[ 1 ] );
+  tested_object_1.increment_by( hosts[ 4 ] , 5 );
+
+  if( !check_equal( 0 , diff_to_current( cluster ) ,
+                    "Free diff before flush." ) ||
+      !check_equal( 5 , tested_object_1.diff_to_current( cluster ) ,
+                    "Cluster diff of an unflushed leaf increment." ) ||
+      !check_equal( 5 , tested_object_1.diff_to_current( service ) ,
+                    "Service diff of an unflushed leaf increment." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,517 @@
+#ifndef ARCHIVED_ROPE_H
+#define ARCHIVED_ROPE_H
+
+#include "archived.h"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+/** @file */
+
+/**
+ @brief A sequence built from immutable, shared chunks.
+
+ # Overview
+
+ A rope<Sequence> is a value type for archived<> that behaves like
+ a Sequence (e.g. std::string or std::vector<>) under operator+=,
+ but never copies the appended data.
+
+ Every increment is stored as an immutable chunk.
+ Appending one rope to another links both chunk lists in O(1),
+ so the path compression in archived<> does not concatenate
+ ever-growing sequences.
+
+ The chunks of a rope can be visited in order without copying them
+ (see begin_chunks() and end_chunks()).
+ A contiguous Sequence is only built by materialize().
+
+ ## Sharing:
+
+ Ropes share their chunks.
+ Copying a rope, and thus returning it from diff_to_current(),
+ costs O(1) regardless of its size.
+*/
+template< class Sequence >
+class rope
+{
+ public:
+  class const_chunk_iterator;
+
+  typedef Sequence sequence_type; /**< @brief The type of a chunk. */
+  typedef typename Sequence::size_type size_type;
+                                  /**< @brief The type of lengths. */
+
+ private:
+  class node;
+
+  typedef std::shared_ptr< const node > node_pointer;
+                            /**< @internal @brief A shared, immutable node. */
+
+  node_pointer root_; /**< @internal @brief The root of the chunk tree.
+                           Empty ropes have no root. */
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed rope is empty.
+  */
+  rope();
+
+  /**
+   @brief Constructor that stores chunk as the only chunk.
+   An empty chunk yields an empty rope.
+  */
+  explicit rope
+  (
+    Sequence
+     chunk /**< The initial chunk. */
+  );
+
+  /**
+   @brief Appends the chunks of other to the chunks of *this.
+   No chunk is copied.
+
+   @return A reference to *this
+  */
+  rope & operator+=
+  (
+    const rope &
+     other /**< The rope to append. */
+  );
+
+  /**
+   @brief Returns the accumulated length of all chunks.
+
+   @return The length of the rope.
+  */
+  size_type size() const;
+
+  /**
+   @brief Checks whether the rope has no elements.
+
+   @return true, if size() is zero.
+  */
+  bool empty() const;
+
+  /**
+   @brief Returns an iterator to the first chunk.
+   The chunks are visited in the order they were appended.
+
+   @return An iterator to the first chunk.
+  */
+  const_chunk_iterator begin_chunks() const;
+
+  /**
+   @brief Returns an iterator past the last chunk.
+
+   @return An iterator past the last chunk.
+  */
+  const_chunk_iterator end_chunks() const;
+
+  /**
+   @brief Copies all chunks into a single contiguous Sequence.
+
+   @return The concatenation of all chunks.
+  */
+  Sequence materialize() const;
+};
+
+/**
+ @brief An archived<> that treats its Sequence value as an append log.
+
+ Increments are appended as immutable chunks, see rope<>.
+*/
+template< class Sequence >
+using append_log = archived< rope< Sequence > >;
+
+/**
+ @internal @brief A node of the chunk tree.
+ A leaf holds a chunk, an inner node concatenates its children.
+*/
+template< class Sequence >
+class rope< Sequence >::node
+{
+ public:
+  node_pointer left_; /**< @internal @brief The first part of an inner node. */
+  node_pointer right_; /**< @internal @brief The second part of an inner node. */
+  Sequence chunk_; /**< @internal @brief The chunk of a leaf. */
+  size_type size_; /**< @internal @brief Accumulated length of the subtree. */
+
+  /**
+   @internal @brief Constructs a leaf holding chunk.
+  */
+  explicit node
+  (
+    Sequence &&
+     chunk /**< The chunk of the leaf. */
+  );
+
+  /**
+   @internal @brief Constructs an inner node concatenating left and right.
+  */
+  node
+  (
+    const node_pointer &
+     left , /**< The first part. */
+    const node_pointer &
+     right /**< The second part. */
+  );
+
+  /**
+   @internal @brief Destructor.
+   Releases uniquely owned descendants iteratively,
+   since path compression builds trees as deep as the commit chain.
+  */
+  ~node();
+
+  /**
+   @internal @brief Checks whether the node is a leaf.
+  */
+  bool is_leaf() const;
+};
+
+/**
+ @brief A forward iterator over the chunks of a rope<>.
+ Dereferencing yields a reference to the chunk stored in the rope.
+*/
+template< class Sequence >
+class rope< Sequence >::const_chunk_iterator
+{
+ public:
+  typedef std::forward_iterator_tag iterator_category;
+                                  /**< @brief Iterator category. */
+  typedef Sequence value_type; /**< @brief The type of a chunk. */
+  typedef std::ptrdiff_t difference_type; /**< @brief Difference type. */
+  typedef const Sequence * pointer; /**< @brief Pointer to a chunk. */
+  typedef const Sequence & reference; /**< @brief Reference to a chunk. */
+
+ private:
+  friend rope< Sequence >; /**< @internal */
+
+  std::vector< const node * > pending_; /**< @internal @brief Subtrees
+                                             still to be visited,
+                                             current leaf last. */
+
+  /**
+   @internal @brief Constructs an iterator to the first leaf below root.
+  */
+  explicit const_chunk_iterator
+  (
+    const node *
+     root /**< The root of the tree, may be null. */
+  );
+
+  /**
+   @internal @brief Expands inner nodes on top of pending_
+   until a leaf is on top.
+  */
+  void descend();
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed iterator is an end iterator.
+  */
+  const_chunk_iterator();
+
+  /**
+   @brief Returns the current chunk.
+
+   @return A reference to the current chunk.
+  */
+  reference operator*() const;
+
+  /**
+   @brief Returns the current chunk.
+
+   @return A pointer to the current chunk.
+  */
+  pointer operator->() const;
+
+  /**
+   @brief Advances to the next chunk.
+
+   @return A reference to *this
+  */
+  const_chunk_iterator & operator++();
+
+  /**
+   @brief Advances to the next chunk.
+
+   @return A copy of *this before advancing.
+  */
+  const_chunk_iterator operator++( int );
+
+  /**
+   @brief Checks whether both iterators reference the same chunk.
+
+   @return true, if both reference the same chunk.
+  */
+  bool operator==
+  (
+    const const_chunk_iterator &
+     other /**< The iterator to compare with. */
+  ) const;
+
+  /**
+   @brief Checks whether the iterators reference different chunks.
+
+   @return true, if the iterators differ.
+  */
+  bool operator!=
+  (
+    const const_chunk_iterator &
+     other /**< The iterator to compare with. */
+  ) const;
+};
+
+
+
+/*
+  Implementation of rope<> class members
+*/
+
+template< class Sequence >
+  rope< Sequence >::rope()
+  : root_()
+{
+}
+
+template< class Sequence >
+  rope< Sequence >::rope
+  (
+    Sequence
+     chunk
+  )
+  : root_()
+{
+  if( ! chunk.empty() )
+  {
+    root_ = std::make_shared< node >( std::move( chunk ) );
+  }
+}
+
+template< class Sequence >
+ rope< Sequence > &
+  rope< Sequence >::operator+=
+  (
+    const rope< Sequence > &
+     other
+  )
+{
+  if( ! other.root_ )
+  {
+    return *this;
+  }
+
+  if( ! root_ )
+  {
+    root_ = other.root_;
+  } else {
+    root_ = std::make_shared< node >( root_ , other.root_ );
+  }
+  return *this;
+}
+
+template< class Sequence >
+ typename rope< Sequence >::size_type
+  rope< Sequence >::size() const
+{
+  return root_ ? root_->size_ : 0;
+}
+
+template< class Sequence >
+ bool
+  rope< Sequence >::empty() const
+{
+  return ! root_;
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator
+  rope< Sequence >::begin_chunks() const
+{
+  return const_chunk_iterator( root_.get() );
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator
+  rope< Sequence >::end_chunks() const
+{
+  return const_chunk_iterator();
+}
+
+template< class Sequence >
+ Sequence
+  rope< Sequence >::materialize() const
+{
+  Sequence result;
+  result.reserve( size() );
+
+  const auto chunks_end = end_chunks();
+  for( auto chunk = begin_chunks() ; chunk != chunks_end ; ++chunk )
+  {
+    result.insert( result.end() , chunk->begin() , chunk->end() );
+  }
+  return result;
+}
+
+/*
+  Implementation of rope<>::node class members
+*/
+
+template< class Sequence >
+  rope< Sequence >::node::node
+  (
+    Sequence &&
+     chunk
+  )
+  : left_() ,
+    right_() ,
+    chunk_( std::move( chunk ) ) ,
+    size_( chunk_.size() )
+{
+}
+
+template< class Sequence >
+  rope< Sequence >::node::node
+  (
+    const node_pointer &
+     left ,
+    const node_pointer &
+     right
+  )
+  : left_( left ) ,
+    right_( right ) ,
+    chunk_() ,
+    size_( left->size_ + right->size_ )
+{
+}
+
+template< class Sequence >
+  rope< Sequence >::node::~node()
+{
+  std::vector< node_pointer > released;
+  if( left_ ) released.push_back( std::move( left_ ) );
+  if( right_ ) released.push_back( std::move( right_ ) );
+
+  while( ! released.empty() )
+  {
+    node_pointer current = std::move( released.back() );
+    released.pop_back();
+
+    if( current.use_count() == 1 )
+    {
+      // Sole owner: detach the children before current dies,
+      // so its destructor does not recurse. Nodes are created
+      // non-const and only shared as const, so this cast is defined.
+      node & owned = const_cast< node & >( *current );
+      if( owned.left_ ) released.push_back( std::move( owned.left_ ) );
+      if( owned.right_ ) released.push_back( std::move( owned.right_ ) );
+    }
+  }
+}
+
+template< class Sequence >
+ bool
+  rope< Sequence >::node::is_leaf() const
+{
+  return ! left_;
+}
+
+/*
+  Implementation of rope<>::const_chunk_iterator class members
+*/
+
+template< class Sequence >
+  rope< Sequence >::const_chunk_iterator::const_chunk_iterator
+  (
+    const node *
+     root
+  )
+  : pending_()
+{
+  if( root )
+  {
+    pending_.push_back( root );
+    descend();
+  }
+}
+
+template< class Sequence >
+  rope< Sequence >::const_chunk_iterator::const_chunk_iterator()
+  : pending_()
+{
+}
+
+template< class Sequence >
+ void
+  rope< Sequence >::const_chunk_iterator::descend()
+{
+  while( ! pending_.empty() && ! pending_.back()->is_leaf() )
+  {
+    const node * inner = pending_.back();
+    pending_.pop_back();
+    pending_.push_back( inner->right_.get() );
+    pending_.push_back( inner->left_.get() );
+  }
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator::reference
+  rope< Sequence >::const_chunk_iterator::operator*() const
+{
+  return pending_.back()->chunk_;
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator::pointer
+  rope< Sequence >::const_chunk_iterator::operator->() const
+{
+  return &pending_.back()->chunk_;
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator &
+  rope< Sequence >::const_chunk_iterator::operator++()
+{
+  pending_.pop_back();
+  descend();
+  return *this;
+}
+
+template< class Sequence >
+ typename rope< Sequence >::const_chunk_iterator
+  rope< Sequence >::const_chunk_iterator::operator++( int )
+{
+  auto previous = *this;
+  ++( *this );
+  return previous;
+}
+
+template< class Sequence >
+ bool
+  rope< Sequence >::const_chunk_iterator::operator==
+  (
+    const const_chunk_iterator &
+     other
+  ) const
+{
+  return pending_ == other.pending_;
+}
+
+template< class Sequence >
+ bool
+  rope< Sequence >::const_chunk_iterator::operator!=
+  (
+    const const_chunk_iterator &
+     other
+  ) const
+{
+  return ! ( *this == other );
+}
+
+#endif
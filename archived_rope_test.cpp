@@ -0,0 +1,130 @@
+#include "archived_rope.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+bool check_equal( const std::string & a , const std::string & b ,
+                  const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+bool check_equal( std::size_t a , std::size_t b , const std::string & msg )
+{
+  return check_equal( std::to_string( a ) , std::to_string( b ) , msg );
+}
+
+int main ( int argc , const char ** argv )
+{
+  // provide the test data
+  std::vector<std::string> test_data = { "ab" , "" , "cde" , "f" , "ghij" };
+  std::string initial_value = "log:";
+  const rope<std::string> initial_rope( initial_value );
+
+  //Test constructor
+  append_log<std::string> tested_object_1( initial_rope );
+
+  if( !check_equal( initial_value ,
+                    tested_object_1.value().materialize() ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Test the increment and calculation of diff;
+  std::vector< append_log<std::string>::version > version_vector;
+  std::vector<std::string> control_values;
+
+  version_vector.push_back( tested_object_1.current() );
+  control_values.push_back( "" );
+
+  std::cout << "Increment, First Run. \n";
+
+  for( const auto & increment : test_data )
+  {
+    version_vector.push_back(
+      tested_object_1.increment_by( rope<std::string>( increment ) ) );
+
+    for( auto & control_value : control_values )
+    {
+      control_value += increment;
+    }
+    control_values.push_back( "" );
+  }
+
+  std::cout << "Increment Check, First Run. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    const auto diff = diff_to_current( version_vector[ i ] );
+
+    if( !check_equal( control_values[ i ] ,
+                      diff.materialize() ,
+                      "Diffs to Current, First Run." ) ||
+        !check_equal( control_values[ i ].size() ,
+                      diff.size() ,
+                      "Diff length, First Run." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Check the chunk view
+  const auto full_diff = diff_to_current( version_vector.front() );
+  std::string from_chunks;
+  std::size_t chunk_count = 0;
+  for( auto chunk = full_diff.begin_chunks() ;
+       chunk != full_diff.end_chunks() ; ++chunk , ++chunk_count )
+  {
+    from_chunks += *chunk;
+  }
+
+  if( !check_equal( 4 , chunk_count , "Number of chunks, empty one skipped." ) ||
+      !check_equal( control_values.front() , from_chunks ,
+                    "Concatenated chunk view." ) )
+  {
+    return 1;
+  }
+
+  //Self appends share the chunk tree
+  rope<std::string> doubled( "xy" );
+  doubled += doubled;
+  doubled += doubled;
+
+  if( !check_equal( "xyxyxyxy" , doubled.materialize() , "Self append." ) )
+  {
+    return 1;
+  }
+
+  //Long chains: compression and destruction must not recurse per chunk
+  const std::size_t long_run = 10000;
+  {
+    append_log<std::string> tested_object_2( ( rope<std::string>() ) );
+    const auto start = tested_object_2.current();
+
+    for( std::size_t i = 0 ; i < long_run ; ++i )
+    {
+      tested_object_2.increment_by( rope<std::string>( "." ) );
+    }
+
+    if( !check_equal( long_run ,
+                      diff_to_current( start ).size() ,
+                      "Length of a long append log." ) )
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+#ifndef ARCHIVED_SEQLOCK_H
+#define ARCHIVED_SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+/** @file */
+
+/**
+ @brief A value published by one writer to many readers.
+
+ # Overview
+
+ A seqlock<T> holds a trivially copyable T of any size.
+ A single writer replaces it with store(),
+ any number of readers take consistent copies with load().
+
+ The writer is wait-free, it never waits for readers.
+ Readers are lock-free, not wait-free: a reader retries
+ if a store() overlapped its copy, so a writer storing without pause
+ can delay it, though some store always completes.
+
+ The value is kept in relaxed atomic words, so concurrent
+ loads and stores are free of data races.
+*/
+template< class T >
+class seqlock
+{
+  static_assert( std::is_trivially_copyable< T >::value ,
+                 "seqlock<T> requires a trivially copyable T" );
+
+ public:
+  typedef T value_type; /**< @brief The type of the published value. */
+
+ private:
+  typedef std::uint64_t word_type; /**< @internal @brief A storage word. */
+
+  static const std::size_t words =
+    ( sizeof( T ) + sizeof( word_type ) - 1 ) / sizeof( word_type );
+                            /**< @internal @brief Number of storage words. */
+
+  std::atomic< std::uint64_t > sequence_; /**< @internal @brief Odd while
+                                               a store is in progress. */
+  std::atomic< word_type > words_[ words ]; /**< @internal @brief The value. */
+
+ public:
+  /**
+   @brief Constructor that publishes initial_value.
+  */
+  explicit seqlock
+  (
+    const T &
+     initial_value = T() /**< The initial value. */
+  );
+
+  seqlock( const seqlock< T > & other ) = delete;
+  seqlock< T > & operator= ( const seqlock< T > & other ) = delete;
+
+  /**
+   @brief Publishes value.
+   Must only be called by one thread at a time.
+  */
+  void store
+  (
+    const T &
+     value /**< The new value. */
+  );
+
+  /**
+   @brief Returns a consistent copy of the last published value.
+   Safe to call from any thread, concurrently with store().
+
+   @return The last published value.
+  */
+  T load() const;
+};
+
+
+
+/*
+  Implementation of seqlock<> class members
+*/
+
+template< class T >
+  seqlock< T >::seqlock
+  (
+    const T &
+     initial_value
+  )
+  : sequence_( 0 )
+{
+  for( auto & word : words_ )
+  {
+    word.store( 0 , std::memory_order_relaxed );
+  }
+  store( initial_value );
+}
+
+template< class T >
+ void
+  seqlock< T >::store
+  (
+    const T &
+     value
+  )
+{
+  word_type buffer[ words ] = {};
+  std::memcpy( buffer , &value , sizeof( T ) );
+
+  const auto sequence = sequence_.load( std::memory_order_relaxed );
+  sequence_.store( sequence + 1 , std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+
+  for( std::size_t i = 0 ; i < words ; ++i )
+  {
+    words_[ i ].store( buffer[ i ] , std::memory_order_relaxed );
+  }
+
+  sequence_.store( sequence + 2 , std::memory_order_release );
+}
+
+template< class T >
+ T
+  seqlock< T >::load() const
+{
+  word_type buffer[ words ];
+  for( ;; )
+  {
+    const auto before = sequence_.load( std::memory_order_acquire );
+    if( before & 1 )
+    {
+      continue;
+    }
+
+    for( std::size_t i = 0 ; i < words ; ++i )
+    {
+      buffer[ i ] = words_[ i ].load( std::memory_order_relaxed );
+    }
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( sequence_.load( std::memory_order_relaxed ) == before )
+    {
+      break;
+    }
+  }
+
+  T value;
+  std::memcpy( &value , buffer , sizeof( T ) );
+  return value;
+}
+
+#endif
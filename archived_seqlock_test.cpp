@@ -0,0 +1,74 @@
+#include "archived_seqlock.h"
+
+#include <atomic>
+#include <thread>
+#include <iostream>
+
+bool check_equal( long a , long b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// Wider than any native atomic, with an invariant between its members.
+class triple
+{
+ public:
+  long a;
+  long b;
+  long c;
+};
+
+int main ( int argc , const char ** argv )
+{
+  //Test constructor
+  seqlock< triple > tested_object_1( triple{ 1 , 2 , 3 } );
+
+  if( !check_equal( 3 , tested_object_1.load().c ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Concurrent readers see only complete stores
+  const long stores = 200000;
+  std::atomic< long > torn_reads( 0 );
+  std::atomic< bool > done( false );
+
+  std::thread reader( [ & ]()
+  {
+    while( ! done.load() )
+    {
+      const auto value = tested_object_1.load();
+      if( value.b != 2 * value.a || value.c != 3 * value.a )
+      {
+        ++torn_reads;
+      }
+    }
+  } );
+
+  for( long i = 1 ; i <= stores ; ++i )
+  {
+    tested_object_1.store( triple{ i , 2 * i , 3 * i } );
+  }
+  done.store( true );
+  reader.join();
+
+  if( !check_equal( 0 , torn_reads.load() , "Torn reads." ) ||
+      !check_equal( stores , tested_object_1.load().a ,
+                    "Value after stores." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,640 @@
+#ifndef ARCHIVED_SKETCH_H
+#define ARCHIVED_SKETCH_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+/** @file */
+
+/**
+ @brief A HyperLogLog sketch estimating the number of distinct items.
+
+ # Overview
+
+ A hyperloglog<Precision> is a value type for archived<> that estimates
+ the number of distinct items inserted into it,
+ using 2^Precision registers.
+ operator+= merges two sketches by taking the register-wise maximum,
+ so the diff_to_current() of an archived<hyperloglog<>> estimates
+ the distinct items inserted since that version.
+
+ ## Storage:
+
+ A sketch stores its non-zero registers sparsely, as sorted
+ register/rank pairs, as long as that is smaller than the dense
+ register array. A commit that saw a few items thus costs a few pairs
+ instead of 2^Precision bytes.
+ Dense sketches are merged with SIMD byte maxima (AVX2 or SSE2).
+*/
+template< unsigned Precision = 14 >
+class hyperloglog
+{
+ public:
+  typedef std::size_t size_type; /**< @brief The type of register indices. */
+
+  static const size_type registers = size_type( 1 ) << Precision;
+                            /**< @brief The number of registers. */
+
+ private:
+  typedef std::pair< std::uint32_t , std::uint8_t > entry_type;
+                            /**< @internal @brief A non-zero register. */
+  typedef std::vector< entry_type > sparse_type;
+                            /**< @internal @brief Sorted non-zero registers. */
+  typedef std::vector< std::uint8_t > dense_type;
+                            /**< @internal @brief All registers. */
+
+  static const size_type dense_threshold =
+    registers / ( 2 * sizeof( entry_type ) ) + 1;
+                            /**< @internal @brief Number of sparse entries
+                                 at which the dense array is used. */
+
+  sparse_type sparse_; /**< @internal @brief The non-zero registers,
+                            if the sketch is sparse. */
+  dense_type dense_; /**< @internal @brief All registers,
+                          if the sketch is dense, empty otherwise. */
+
+  /**
+   @internal @brief Switches to the dense representation.
+  */
+  void densify();
+
+  /**
+   @internal @brief Raises dense registers to the sparse entries.
+  */
+  void scatter
+  (
+    const sparse_type &
+     entries /**< The entries to merge. */
+  );
+
+  /**
+   @internal @brief Sets destination to the byte-wise maximum
+   of destination and source.
+  */
+  static void max_dense
+  (
+    std::uint8_t *
+     destination , /**< The registers that are raised. */
+    const std::uint8_t *
+     source , /**< The registers to merge. */
+    size_type
+     n /**< The number of registers. */
+  );
+
+  /**
+   @internal @brief Counts the leading zero bits of a non-zero x.
+  */
+  static unsigned leading_zeros
+  (
+    std::uint64_t
+     x /**< A non-zero word. */
+  );
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed sketch is empty and sparse.
+  */
+  hyperloglog();
+
+  /**
+   @brief Inserts an item, given by an integral key.
+   The key is hashed before insertion.
+  */
+  void insert
+  (
+    std::uint64_t
+     key /**< The item. */
+  );
+
+  /**
+   @brief Inserts an item, given by a well mixed 64 bit hash.
+  */
+  void insert_hash
+  (
+    std::uint64_t
+     hash /**< The hash of the item. */
+  );
+
+  /**
+   @brief Merges other into *this.
+
+   @return A reference to *this
+  */
+  hyperloglog & operator+=
+  (
+    const hyperloglog &
+     other /**< The sketch to merge. */
+  );
+
+  /**
+   @brief Estimates the number of distinct inserted items.
+
+   @return The estimated cardinality.
+  */
+  double estimate() const;
+
+  /**
+   @brief Checks whether the sketch uses the dense representation.
+
+   @return true, if the sketch is dense.
+  */
+  bool is_dense() const;
+};
+
+/**
+ @brief A mergeable sketch of quantiles with bounded relative error.
+
+ # Overview
+
+ A quantile_sketch<AccuracyPerMille> is a value type for archived<>
+ that approximates the quantiles of non-negative samples,
+ such as latencies.
+ Samples are counted in logarithmic buckets, so every quantile
+ is returned with a relative error of at most AccuracyPerMille / 1000.
+ Samples that are not positive are counted as zero.
+
+ operator+= adds the bucket counts of two sketches.
+ Only non-empty buckets are stored, so commits stay small.
+*/
+template< unsigned AccuracyPerMille = 10 >
+class quantile_sketch
+{
+ public:
+  typedef std::uint64_t count_type; /**< @brief The type of sample counts. */
+
+ private:
+  typedef std::pair< std::int32_t , count_type > entry_type;
+                            /**< @internal @brief A non-empty bucket. */
+  typedef std::vector< entry_type > buckets_type;
+                            /**< @internal @brief Sorted non-empty buckets. */
+
+  buckets_type buckets_; /**< @internal @brief The non-empty buckets. */
+  count_type zeros_; /**< @internal @brief Number of non-positive samples. */
+  count_type total_; /**< @internal @brief Number of all samples. */
+
+  /**
+   @internal @brief Returns the logarithm base of the buckets.
+  */
+  static double gamma();
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed sketch is empty.
+  */
+  quantile_sketch();
+
+  /**
+   @brief Adds n samples of value sample.
+  */
+  void insert
+  (
+    double
+     sample , /**< The sample. */
+    count_type
+     n = 1 /**< The number of samples. */
+  );
+
+  /**
+   @brief Merges other into *this.
+
+   @return A reference to *this
+  */
+  quantile_sketch & operator+=
+  (
+    const quantile_sketch &
+     other /**< The sketch to merge. */
+  );
+
+  /**
+   @brief Returns the number of samples.
+
+   @return The number of samples.
+  */
+  count_type count() const;
+
+  /**
+   @brief Returns the approximate q-quantile.
+   q is clamped to [0,1]. An empty sketch,
+   or one of zero samples only, returns 0.
+
+   @return The approximate q-quantile.
+  */
+  double quantile
+  (
+    double
+     q /**< The quantile, in [0,1]. */
+  ) const;
+};
+
+
+
+/*
+  Implementation of hyperloglog<> class members
+*/
+
+template< unsigned Precision >
+  hyperloglog< Precision >::hyperloglog()
+  : sparse_() ,
+    dense_()
+{
+}
+
+template< unsigned Precision >
+ void
+  hyperloglog< Precision >::densify()
+{
+  dense_.assign( registers , 0 );
+  scatter( sparse_ );
+  sparse_type().swap( sparse_ );
+}
+
+template< unsigned Precision >
+ void
+  hyperloglog< Precision >::scatter
+  (
+    const sparse_type &
+     entries
+  )
+{
+  for( const auto & entry : entries )
+  {
+    auto & target = dense_[ entry.first ];
+    target = std::max( target , entry.second );
+  }
+}
+
+template< unsigned Precision >
+ void
+  hyperloglog< Precision >::max_dense
+  (
+    std::uint8_t *
+     destination ,
+    const std::uint8_t *
+     source ,
+    size_type
+     n
+  )
+{
+  size_type i = 0;
+#if defined( __AVX2__ )
+  for( ; i + 32 <= n ; i += 32 )
+  {
+    const auto d = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( destination + i ) );
+    const auto s = _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( source + i ) );
+    _mm256_storeu_si256( reinterpret_cast< __m256i * >( destination + i ) ,
+                         _mm256_max_epu8( d , s ) );
+  }
+#elif defined( __SSE2__ )
+  for( ; i + 16 <= n ; i += 16 )
+  {
+    const auto d = _mm_loadu_si128(
+      reinterpret_cast< const __m128i * >( destination + i ) );
+    const auto s = _mm_loadu_si128(
+      reinterpret_cast< const __m128i * >( source + i ) );
+    _mm_storeu_si128( reinterpret_cast< __m128i * >( destination + i ) ,
+                      _mm_max_epu8( d , s ) );
+  }
+#endif
+  for( ; i < n ; ++i )
+  {
+    destination[ i ] = std::max( destination[ i ] , source[ i ] );
+  }
+}
+
+template< unsigned Precision >
+ unsigned
+  hyperloglog< Precision >::leading_zeros
+  (
+    std::uint64_t
+     x
+  )
+{
+#if defined( __GNUC__ )
+  return __builtin_clzll( x );
+#else
+  unsigned zeros = 0;
+  while( ! ( x & ( std::uint64_t( 1 ) << 63 ) ) )
+  {
+    x <<= 1;
+    ++zeros;
+  }
+  return zeros;
+#endif
+}
+
+template< unsigned Precision >
+ void
+  hyperloglog< Precision >::insert
+  (
+    std::uint64_t
+     key
+  )
+{
+  // splitmix64 finalizer
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ULL;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+  insert_hash( key );
+}
+
+template< unsigned Precision >
+ void
+  hyperloglog< Precision >::insert_hash
+  (
+    std::uint64_t
+     hash
+  )
+{
+  const auto index = static_cast< std::uint32_t >( hash >> ( 64 - Precision ) );
+  const auto rank = static_cast< std::uint8_t >(
+    leading_zeros( ( hash << Precision ) |
+                   ( std::uint64_t( 1 ) << ( Precision - 1 ) ) ) + 1 );
+
+  if( is_dense() )
+  {
+    dense_[ index ] = std::max( dense_[ index ] , rank );
+    return;
+  }
+
+  const auto position =
+    std::lower_bound( sparse_.begin() , sparse_.end() , index ,
+                      []( const entry_type & entry , std::uint32_t i )
+                      {
+                        return entry.first < i;
+                      } );
+
+  if( position != sparse_.end() && position->first == index )
+  {
+    position->second = std::max( position->second , rank );
+  } else {
+    sparse_.insert( position , entry_type( index , rank ) );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+}
+
+template< unsigned Precision >
+ hyperloglog< Precision > &
+  hyperloglog< Precision >::operator+=
+  (
+    const hyperloglog< Precision > &
+     other
+  )
+{
+  if( other.is_dense() )
+  {
+    if( is_dense() )
+    {
+      max_dense( dense_.data() , other.dense_.data() , registers );
+    } else {
+      sparse_type entries;
+      entries.swap( sparse_ );
+      dense_ = other.dense_;
+      scatter( entries );
+    }
+  } else if( is_dense() ) {
+    scatter( other.sparse_ );
+  } else if( ! other.sparse_.empty() ) {
+    sparse_type merged;
+    merged.reserve( sparse_.size() + other.sparse_.size() );
+
+    auto mine = sparse_.cbegin();
+    auto theirs = other.sparse_.cbegin();
+    const auto mine_end = sparse_.cend();
+    const auto theirs_end = other.sparse_.cend();
+
+    while( mine != mine_end && theirs != theirs_end )
+    {
+      if( mine->first < theirs->first )
+      {
+        merged.push_back( *mine++ );
+      } else if( theirs->first < mine->first ) {
+        merged.push_back( *theirs++ );
+      } else {
+        merged.push_back( entry_type( mine->first ,
+                                      std::max( mine->second ,
+                                                theirs->second ) ) );
+        ++mine;
+        ++theirs;
+      }
+    }
+    merged.insert( merged.end() , mine , mine_end );
+    merged.insert( merged.end() , theirs , theirs_end );
+
+    sparse_.swap( merged );
+    if( sparse_.size() >= dense_threshold )
+    {
+      densify();
+    }
+  }
+  return *this;
+}
+
+template< unsigned Precision >
+ double
+  hyperloglog< Precision >::estimate() const
+{
+  const double m = static_cast< double >( registers );
+
+  double sum = 0.0;
+  size_type zeros = 0;
+  if( is_dense() )
+  {
+    for( const auto rank : dense_ )
+    {
+      sum += std::ldexp( 1.0 , -static_cast< int >( rank ) );
+      zeros += ( rank == 0 );
+    }
+  } else {
+    zeros = registers - sparse_.size();
+    sum = static_cast< double >( zeros );
+    for( const auto & entry : sparse_ )
+    {
+      sum += std::ldexp( 1.0 , -static_cast< int >( entry.second ) );
+    }
+  }
+
+  double alpha = 0.7213 / ( 1.0 + 1.079 / m );
+  if( registers == 16 ) alpha = 0.673;
+  if( registers == 32 ) alpha = 0.697;
+  if( registers == 64 ) alpha = 0.709;
+
+  const double raw = alpha * m * m / sum;
+  if( raw <= 2.5 * m && zeros != 0 )
+  {
+    // Small range correction: linear counting.
+    return m * std::log( m / static_cast< double >( zeros ) );
+  }
+  return raw;
+}
+
+template< unsigned Precision >
+ bool
+  hyperloglog< Precision >::is_dense() const
+{
+  return ! dense_.empty();
+}
+
+/*
+  Implementation of quantile_sketch<> class members
+*/
+
+template< unsigned AccuracyPerMille >
+ double
+  quantile_sketch< AccuracyPerMille >::gamma()
+{
+  const double accuracy = AccuracyPerMille / 1000.0;
+  return ( 1.0 + accuracy ) / ( 1.0 - accuracy );
+}
+
+template< unsigned AccuracyPerMille >
+  quantile_sketch< AccuracyPerMille >::quantile_sketch()
+  : buckets_() ,
+    zeros_() ,
+    total_()
+{
+}
+
+template< unsigned AccuracyPerMille >
+ void
+  quantile_sketch< AccuracyPerMille >::insert
+  (
+    double
+     sample ,
+    count_type
+     n
+  )
+{
+  total_ += n;
+  if( ! ( sample > 0.0 ) )
+  {
+    zeros_ += n;
+    return;
+  }
+
+  const auto key = static_cast< std::int32_t >(
+    std::ceil( std::log( sample ) / std::log( gamma() ) ) );
+
+  const auto position =
+    std::lower_bound( buckets_.begin() , buckets_.end() , key ,
+                      []( const entry_type & entry , std::int32_t k )
+                      {
+                        return entry.first < k;
+                      } );
+
+  if( position != buckets_.end() && position->first == key )
+  {
+    position->second += n;
+  } else {
+    buckets_.insert( position , entry_type( key , n ) );
+  }
+}
+
+template< unsigned AccuracyPerMille >
+ quantile_sketch< AccuracyPerMille > &
+  quantile_sketch< AccuracyPerMille >::operator+=
+  (
+    const quantile_sketch< AccuracyPerMille > &
+     other
+  )
+{
+  if( ! other.buckets_.empty() )
+  {
+    buckets_type merged;
+    merged.reserve( buckets_.size() + other.buckets_.size() );
+
+    auto mine = buckets_.cbegin();
+    auto theirs = other.buckets_.cbegin();
+    const auto mine_end = buckets_.cend();
+    const auto theirs_end = other.buckets_.cend();
+
+    while( mine != mine_end && theirs != theirs_end )
+    {
+      if( mine->first < theirs->first )
+      {
+        merged.push_back( *mine++ );
+      } else if( theirs->first < mine->first ) {
+        merged.push_back( *theirs++ );
+      } else {
+        merged.push_back( entry_type( mine->first ,
+                                      mine->second + theirs->second ) );
+        ++mine;
+        ++theirs;
+      }
+    }
+    merged.insert( merged.end() , mine , mine_end );
+    merged.insert( merged.end() , theirs , theirs_end );
+
+    buckets_.swap( merged );
+  }
+
+  zeros_ += other.zeros_;
+  total_ += other.total_;
+  return *this;
+}
+
+template< unsigned AccuracyPerMille >
+ typename quantile_sketch< AccuracyPerMille >::count_type
+  quantile_sketch< AccuracyPerMille >::count() const
+{
+  return total_;
+}
+
+template< unsigned AccuracyPerMille >
+ double
+  quantile_sketch< AccuracyPerMille >::quantile
+  (
+    double
+     q
+  ) const
+{
+  if( total_ == 0 || buckets_.empty() )
+  {
+    return 0.0;
+  }
+  // Also maps NaN to 0.
+  if( ! ( q > 0.0 ) )
+  {
+    q = 0.0;
+  } else if( q > 1.0 ) {
+    q = 1.0;
+  }
+
+  // Zero based rank of the requested sample.
+  const auto rank = static_cast< count_type >( q * ( total_ - 1 ) );
+  count_type seen = zeros_;
+  if( rank < seen )
+  {
+    return 0.0;
+  }
+
+  const double base = gamma();
+  for( const auto & entry : buckets_ )
+  {
+    seen += entry.second;
+    if( rank < seen )
+    {
+      return 2.0 * std::pow( base , entry.first ) / ( base + 1.0 );
+    }
+  }
+  return 2.0 * std::pow( base , buckets_.back().first ) / ( base + 1.0 );
+}
+
+#endif
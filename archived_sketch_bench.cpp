@@ -0,0 +1,197 @@
+#include "archived_sketch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include <iostream>
+
+// Exact distinct counting: set union as increment.
+class exact_distinct
+{
+ public:
+  std::unordered_set<std::uint64_t> items;
+
+  exact_distinct & operator+=( const exact_distinct & other )
+  {
+    items.insert( other.items.begin() , other.items.end() );
+    return *this;
+  }
+};
+
+// Exact quantiles: all samples, appended.
+class exact_quantiles
+{
+ public:
+  std::vector<double> samples;
+
+  exact_quantiles & operator+=( const exact_quantiles & other )
+  {
+    samples.insert( samples.end() ,
+                    other.samples.begin() , other.samples.end() );
+    return *this;
+  }
+
+  double quantile( double q ) const
+  {
+    auto sorted = samples;
+    const auto n = static_cast< std::size_t >( q * ( sorted.size() - 1 ) );
+    std::nth_element( sorted.begin() , sorted.begin() + n , sorted.end() );
+    return sorted[ n ];
+  }
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+const std::size_t commits = 200;
+const std::size_t items_per_commit = 200;
+const std::size_t queried_versions = 20;
+
+template< class Value , class Insert , class Query >
+void run( const char * name , Insert insert , Query query )
+{
+  std::mt19937_64 random( 42 );
+  archived< Value > archive( ( Value() ) );
+  std::vector< typename archived< Value >::version > versions;
+
+  const auto increment_start = bench_clock::now();
+  for( std::size_t c = 0 ; c < commits ; ++c )
+  {
+    if( c % ( commits / queried_versions ) == 0 )
+    {
+      versions.push_back( archive.current() );
+    }
+
+    Value increment;
+    for( std::size_t i = 0 ; i < items_per_commit ; ++i )
+    {
+      insert( increment , random );
+    }
+    archive.increment_by( increment );
+  }
+  const double increment_time = seconds_since( increment_start );
+
+  const auto query_start = bench_clock::now();
+  double checksum = 0.0;
+  for( const auto & v : versions )
+  {
+    checksum += query( diff_to_current( v ) );
+  }
+  const double query_time = seconds_since( query_start );
+
+  std::cout << name << ": "
+            << commits * items_per_commit / increment_time / 1e6
+            << " M items/s inserted, "
+            << versions.size() / query_time
+            << " diff queries/s (checksum " << checksum << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  // Items are drawn from a universe of 10^5, so streams repeat.
+  auto insert_key = []( hyperloglog< 14 > & h , std::mt19937_64 & r )
+  {
+    h.insert( r() % 100000 );
+  };
+  auto insert_exact_key = []( exact_distinct & e , std::mt19937_64 & r )
+  {
+    e.items.insert( r() % 100000 );
+  };
+
+  std::cout << "Distinct counting, " << commits << " commits of "
+            << items_per_commit << " items.\n";
+
+  run< hyperloglog< 14 > >( "hyperloglog<14>" , insert_key ,
+    []( const hyperloglog< 14 > & h ) { return h.estimate(); } );
+  run< exact_distinct >( "exact set      " , insert_exact_key ,
+    []( const exact_distinct & e ) { return double( e.items.size() ); } );
+
+  // Accuracy of the distinct counts since several versions.
+  {
+    std::mt19937_64 random( 7 );
+    archived< hyperloglog< 14 > > sketch( ( hyperloglog< 14 >() ) );
+    archived< exact_distinct > exact( ( exact_distinct() ) );
+    std::vector< archived< hyperloglog< 14 > >::version > sketch_versions;
+    std::vector< archived< exact_distinct >::version > exact_versions;
+
+    for( std::size_t c = 0 ; c < commits ; ++c )
+    {
+      if( c % ( commits / 10 ) == 0 )
+      {
+        sketch_versions.push_back( sketch.current() );
+        exact_versions.push_back( exact.current() );
+      }
+      hyperloglog< 14 > h;
+      exact_distinct e;
+      for( std::size_t i = 0 ; i < items_per_commit ; ++i )
+      {
+        const auto key = random() % 100000;
+        h.insert( key );
+        e.items.insert( key );
+      }
+      sketch.increment_by( h );
+      exact.increment_by( e );
+    }
+
+    double worst = 0.0;
+    for( std::size_t i = 0 ; i < sketch_versions.size() ; ++i )
+    {
+      const double truth =
+        double( diff_to_current( exact_versions[ i ] ).items.size() );
+      const double error =
+        std::fabs( diff_to_current( sketch_versions[ i ] ).estimate() - truth )
+        / truth;
+      worst = std::max( worst , error );
+    }
+    std::cout << "hyperloglog<14> worst relative error: " << worst << "\n";
+  }
+
+  auto insert_sample = []( quantile_sketch<> & s , std::mt19937_64 & r )
+  {
+    s.insert( std::exp( ( r() % 10000 ) / 1000.0 ) );
+  };
+  auto insert_exact_sample = []( exact_quantiles & e , std::mt19937_64 & r )
+  {
+    e.samples.push_back( std::exp( ( r() % 10000 ) / 1000.0 ) );
+  };
+
+  std::cout << "Quantiles, " << commits << " commits of "
+            << items_per_commit << " samples.\n";
+
+  run< quantile_sketch<> >( "quantile_sketch<10>" , insert_sample ,
+    []( const quantile_sketch<> & s ) { return s.quantile( 0.99 ); } );
+  run< exact_quantiles >( "exact samples      " , insert_exact_sample ,
+    []( const exact_quantiles & e ) { return e.quantile( 0.99 ); } );
+
+  // Accuracy of the quantiles since the first version.
+  {
+    std::mt19937_64 random( 7 );
+    quantile_sketch<> sketch;
+    exact_quantiles exact;
+    for( std::size_t i = 0 ; i < commits * items_per_commit / 10 ; ++i )
+    {
+      const double sample = std::exp( ( random() % 10000 ) / 1000.0 );
+      sketch.insert( sample );
+      exact.samples.push_back( sample );
+    }
+
+    double worst = 0.0;
+    for( double q : { 0.5 , 0.9 , 0.99 , 0.999 } )
+    {
+      const double truth = exact.quantile( q );
+      worst = std::max( worst ,
+                        std::fabs( sketch.quantile( q ) - truth ) / truth );
+    }
+    std::cout << "quantile_sketch<10> worst relative error: " << worst << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "archived_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <vector>
+#include <iostream>
+
+bool check_close( double a , double b , double relative_error ,
+                  const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( std::fabs( a - b ) <= relative_error * std::fabs( a ) )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+int main ( int argc , const char ** argv )
+{
+  typedef hyperloglog< 12 > tested_hll;
+  typedef quantile_sketch< 10 > tested_quantiles;
+
+  //Distinct counts since a version
+  archived< tested_hll > tested_object_1( ( tested_hll() ) );
+
+  std::vector< archived< tested_hll >::version > version_vector;
+  std::vector< std::set<std::uint64_t> > control_values;
+
+  std::cout << "Increment, HyperLogLog. \n";
+
+  for( std::uint64_t step = 0 ; step < 20 ; ++step )
+  {
+    version_vector.push_back( tested_object_1.current() );
+    control_values.push_back( std::set<std::uint64_t>() );
+
+    tested_hll increment;
+    for( std::uint64_t i = 0 ; i < 50 * step ; ++i )
+    {
+      // Overlapping key ranges, so merges see repeated items.
+      const std::uint64_t key = step * 37 + i;
+      increment.insert( key );
+      for( auto & control : control_values )
+      {
+        control.insert( key );
+      }
+    }
+    tested_object_1.increment_by( increment );
+  }
+
+  std::cout << "Increment Check, HyperLogLog. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    if( !check_close( control_values[ i ].size() ,
+                      diff_to_current( version_vector[ i ] ).estimate() ,
+                      0.06 ,
+                      "Distinct Items since Version." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_close( 1.0 ,
+                    diff_to_current( version_vector[ 0 ] ).is_dense() ,
+                    0.0 ,
+                    "Large Sketch is dense." ) )
+  {
+    return 1;
+  }
+
+  //Quantiles since a version
+  archived< tested_quantiles > tested_object_2( ( tested_quantiles() ) );
+  const auto quantile_start = tested_object_2.current();
+  std::vector<double> samples;
+
+  std::cout << "Increment, Quantiles. \n";
+
+  for( int step = 0 ; step < 100 ; ++step )
+  {
+    tested_quantiles increment;
+    for( int i = 0 ; i < 10 ; ++i )
+    {
+      const double sample = 1.0 + ( ( step * 7919 + i * 104729 ) % 10000 );
+      increment.insert( sample );
+      samples.push_back( sample );
+    }
+    tested_object_2.increment_by( increment );
+  }
+
+  std::sort( samples.begin() , samples.end() );
+  const auto quantiles = diff_to_current( quantile_start );
+
+  if( !check_close( samples.size() , quantiles.count() , 0.0 ,
+                    "Number of Samples." ) )
+  {
+    return 1;
+  }
+
+  for( double q : { 0.0 , 0.1 , 0.5 , 0.9 , 0.99 , 1.0 } )
+  {
+    const double exact =
+      samples[ static_cast< std::size_t >( q * ( samples.size() - 1 ) ) ];
+    if( !check_close( exact , quantiles.quantile( q ) , 0.0101 ,
+                      "Quantile since Version." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Out of range quantiles are clamped
+  if( !check_close( quantiles.quantile( 0.0 ) , quantiles.quantile( -0.5 ) ,
+                    0.0 , "Quantile below 0." ) ||
+      !check_close( quantiles.quantile( 1.0 ) , quantiles.quantile( 1.5 ) ,
+                    0.0 , "Quantile above 1." ) )
+  {
+    return 1;
+  }
+
+  //Zero samples only
+  tested_quantiles zeros;
+  zeros.insert( 0.0 , 5 );
+  for( double q : { -1.0 , 0.0 , 0.5 , 1.0 , 2.0 } )
+  {
+    if( !check_close( 0.0 , zeros.quantile( q ) , 0.0 ,
+                      "Quantile of zero samples." ) )
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
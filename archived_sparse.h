@@ -0,0 +1,412 @@
+#ifndef ARCHIVED_SPARSE_H
+#define ARCHIVED_SPARSE_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+/** @file */
+
+/**
+ @brief A sparse vector of Value, indexed by Index.
+
+ # Overview
+
+ A sparse_vector<Value,Index> is a value type for archived<> that holds
+ updates to a few coordinates of a large vector, such as sparse
+ gradients or feature counts.
+ operator+= adds the coordinates of two sparse vectors.
+
+ ## Storage:
+
+ A sparse vector stores its coordinates as two arrays, the sorted
+ indices and their values. It never switches to a dense array:
+ a commit that updates k coordinates costs k indices and values,
+ independent of the dimension of the vector.
+ A dense copy is only made on request, by densify().
+
+ ## Merging:
+
+ operator+= is a merge-join of the sorted indices. Runs of indices
+ below the next index of the other operand are copied as a whole;
+ for 32 bit indices they are found eight at a time with AVX2,
+ if available. Coordinates that add up to zero are kept.
+*/
+template< class Value = float , class Index = std::uint32_t >
+class sparse_vector
+{
+ public:
+  typedef std::size_t size_type; /**< @brief The type of sizes. */
+  typedef Index index_type; /**< @brief The type of coordinates. */
+  typedef Value value_type; /**< @brief The type of values. */
+
+ private:
+  std::vector< Index > indices_; /**< @internal @brief The sorted indices
+                                      of the stored coordinates. */
+  std::vector< Value > values_; /**< @internal @brief The values,
+                                     in the order of indices_. */
+
+  /**
+   @internal @brief Returns the first position in [from,to)
+   whose index is not below bound, or to.
+   Generic version.
+
+   @return The end of the run below bound.
+  */
+  template< class Element >
+  static size_type run_end
+  (
+    const Element *
+     indices , /**< The sorted indices. */
+    size_type
+     from , /**< The start of the run. */
+    size_type
+     to , /**< The end of the indices. */
+    Element
+     bound /**< The first index not in the run. */
+  );
+
+#if defined( __AVX2__ )
+  /**
+   @internal @brief Returns the first position in [from,to)
+   whose index is not below bound, or to.
+   AVX2 version for 32 bit indices.
+
+   @return The end of the run below bound.
+  */
+  static size_type run_end
+  (
+    const std::uint32_t *
+     indices , /**< The sorted indices. */
+    size_type
+     from , /**< The start of the run. */
+    size_type
+     to , /**< The end of the indices. */
+    std::uint32_t
+     bound /**< The first index not in the run. */
+  );
+#endif
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed sparse vector is zero.
+  */
+  sparse_vector();
+
+  /**
+   @brief Adds value to the coordinate index.
+   Takes O(1) if index is above all stored indices,
+   O(size()) otherwise.
+  */
+  void add
+  (
+    Index
+     index , /**< The coordinate. */
+    const Value &
+     value /**< The value to add. */
+  );
+
+  /**
+   @brief Adds the coordinates of other to the coordinates of *this.
+   Takes O(size()+other.size()).
+
+   @return A reference to *this
+  */
+  sparse_vector & operator+=
+  (
+    const sparse_vector &
+     other /**< The sparse vector to add. */
+  );
+
+  /**
+   @brief Returns the value of a coordinate.
+
+   @return The value at index, zero if it is not stored.
+  */
+  Value get
+  (
+    Index
+     index /**< The coordinate. */
+  ) const;
+
+  /**
+   @brief Returns the number of stored coordinates.
+
+   @return The number of stored coordinates.
+  */
+  size_type size() const;
+
+  /**
+   @brief Returns the sorted indices of the stored coordinates.
+
+   @return The indices.
+  */
+  const std::vector< Index > & indices() const;
+
+  /**
+   @brief Returns the values of the stored coordinates,
+   in the order of indices().
+
+   @return The values.
+  */
+  const std::vector< Value > & values() const;
+
+  /**
+   @brief Returns a dense copy of the first dimension coordinates.
+
+   @return dimension values, zero where nothing is stored.
+  */
+  std::vector< Value > densify
+  (
+    size_type
+     dimension /**< The number of coordinates. */
+  ) const;
+};
+
+/**
+ @brief An archived<> of sparse vectors.
+ Each commit stores only the coordinates it changed,
+ diff_to_current() merges them without densifying.
+*/
+template< class Value = float , class Index = std::uint32_t >
+using sparse_vector_archive = archived< sparse_vector< Value , Index > >;
+
+
+
+/*
+  Implementation of sparse_vector<> class members
+*/
+
+template< class Value , class Index >
+  sparse_vector< Value , Index >::sparse_vector()
+  : indices_() ,
+    values_()
+{
+}
+
+template< class Value , class Index >
+template< class Element >
+ typename sparse_vector< Value , Index >::size_type
+  sparse_vector< Value , Index >::run_end
+  (
+    const Element *
+     indices ,
+    size_type
+     from ,
+    size_type
+     to ,
+    Element
+     bound
+  )
+{
+  while( from != to && indices[ from ] < bound )
+  {
+    ++from;
+  }
+  return from;
+}
+
+#if defined( __AVX2__ )
+template< class Value , class Index >
+ typename sparse_vector< Value , Index >::size_type
+  sparse_vector< Value , Index >::run_end
+  (
+    const std::uint32_t *
+     indices ,
+    size_type
+     from ,
+    size_type
+     to ,
+    std::uint32_t
+     bound
+  )
+{
+  // Flipping the sign bit makes the signed comparison unsigned.
+  const auto sign = _mm256_set1_epi32( INT32_MIN );
+  const auto limit = _mm256_xor_si256(
+    _mm256_set1_epi32( static_cast< int >( bound ) ) , sign );
+  for( ; from + 8 <= to ; from += 8 )
+  {
+    const auto block = _mm256_xor_si256( _mm256_loadu_si256(
+      reinterpret_cast< const __m256i * >( indices + from ) ) , sign );
+    // The indices are sorted, the lanes below bound are a prefix.
+    const unsigned below = static_cast< unsigned >( _mm256_movemask_ps(
+      _mm256_castsi256_ps( _mm256_cmpgt_epi32( limit , block ) ) ) );
+    if( below != 0xff )
+    {
+      return from + static_cast< size_type >( __builtin_ctz( ~below ) );
+    }
+  }
+  while( from != to && indices[ from ] < bound )
+  {
+    ++from;
+  }
+  return from;
+}
+#endif
+
+template< class Value , class Index >
+ void
+  sparse_vector< Value , Index >::add
+  (
+    Index
+     index ,
+    const Value &
+     value
+  )
+{
+  if( indices_.empty() || indices_.back() < index )
+  {
+    indices_.push_back( index );
+    values_.push_back( value );
+    return;
+  }
+
+  const auto position =
+    std::lower_bound( indices_.begin() , indices_.end() , index );
+  const auto offset = position - indices_.begin();
+  if( *position == index )
+  {
+    values_[ offset ] += value;
+  } else {
+    indices_.insert( position , index );
+    values_.insert( values_.begin() + offset , value );
+  }
+}
+
+template< class Value , class Index >
+ sparse_vector< Value , Index > &
+  sparse_vector< Value , Index >::operator+=
+  (
+    const sparse_vector< Value , Index > &
+     other
+  )
+{
+  if( other.indices_.empty() )
+  {
+    return *this;
+  }
+  if( indices_.empty() || indices_.back() < other.indices_.front() )
+  {
+    // Disjoint and in order: no merge needed.
+    indices_.insert( indices_.end() ,
+                     other.indices_.begin() , other.indices_.end() );
+    values_.insert( values_.end() ,
+                    other.values_.begin() , other.values_.end() );
+    return *this;
+  }
+
+  // Sized for the worst case, written through pointers
+  // and shrunk to the merged size.
+  std::vector< Index > indices( indices_.size() + other.indices_.size() );
+  std::vector< Value > values( indices.size() );
+  Index * index_out = indices.data();
+  Value * value_out = values.data();
+
+  const Index * const mine = indices_.data();
+  const Index * const theirs = other.indices_.data();
+  const Value * const mine_values = values_.data();
+  const Value * const theirs_values = other.values_.data();
+  const size_type mine_end = indices_.size();
+  const size_type theirs_end = other.indices_.size();
+  size_type i = 0 , j = 0;
+
+  while( i != mine_end && j != theirs_end )
+  {
+    if( mine[ i ] < theirs[ j ] )
+    {
+      const auto end = run_end( mine , i , mine_end , theirs[ j ] );
+      index_out = std::copy( mine + i , mine + end , index_out );
+      value_out = std::copy( mine_values + i , mine_values + end , value_out );
+      i = end;
+    } else if( theirs[ j ] < mine[ i ] ) {
+      const auto end = run_end( theirs , j , theirs_end , mine[ i ] );
+      index_out = std::copy( theirs + j , theirs + end , index_out );
+      value_out = std::copy( theirs_values + j , theirs_values + end ,
+                             value_out );
+      j = end;
+    } else {
+      *index_out++ = mine[ i ];
+      *value_out = mine_values[ i ];
+      *value_out++ += theirs_values[ j ];
+      ++i;
+      ++j;
+    }
+  }
+  index_out = std::copy( mine + i , mine + mine_end , index_out );
+  value_out = std::copy( mine_values + i , mine_values + mine_end ,
+                         value_out );
+  index_out = std::copy( theirs + j , theirs + theirs_end , index_out );
+  value_out = std::copy( theirs_values + j , theirs_values + theirs_end ,
+                         value_out );
+  indices.resize( index_out - indices.data() );
+  values.resize( value_out - values.data() );
+
+  indices_.swap( indices );
+  values_.swap( values );
+  return *this;
+}
+
+template< class Value , class Index >
+ Value
+  sparse_vector< Value , Index >::get
+  (
+    Index
+     index
+  ) const
+{
+  const auto position =
+    std::lower_bound( indices_.begin() , indices_.end() , index );
+  if( position != indices_.end() && *position == index )
+  {
+    return values_[ position - indices_.begin() ];
+  }
+  return Value();
+}
+
+template< class Value , class Index >
+ typename sparse_vector< Value , Index >::size_type
+  sparse_vector< Value , Index >::size() const
+{
+  return indices_.size();
+}
+
+template< class Value , class Index >
+ const std::vector< Index > &
+  sparse_vector< Value , Index >::indices() const
+{
+  return indices_;
+}
+
+template< class Value , class Index >
+ const std::vector< Value > &
+  sparse_vector< Value , Index >::values() const
+{
+  return values_;
+}
+
+template< class Value , class Index >
+ std::vector< Value >
+  sparse_vector< Value , Index >::densify
+  (
+    size_type
+     dimension
+  ) const
+{
+  std::vector< Value > result( dimension , Value() );
+  for( size_type k = 0 ; k < indices_.size() && indices_[ k ] < dimension ;
+       ++k )
+  {
+    result[ indices_[ k ] ] += values_[ k ];
+  }
+  return result;
+}
+
+#endif
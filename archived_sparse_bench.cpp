@@ -0,0 +1,150 @@
+#include "archived_sparse.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+const std::size_t dimension = 1000000;
+const std::size_t coordinates_per_update = dimension / 100;
+const std::size_t updates = 100;
+const std::size_t workers = 8;
+
+// The archived< std::vector< float > > the request started from.
+class dense_vector
+{
+ public:
+  std::vector< float > values;
+
+  dense_vector & operator+= ( const dense_vector & other )
+  {
+    if( values.empty() )
+    {
+      values.assign( dimension , 0.0f );
+    }
+    for( std::size_t k = 0 ; k < other.values.size() ; ++k )
+    {
+      values[ k ] += other.values[ k ];
+    }
+    return *this;
+  }
+};
+
+// About 1% of the coordinates, skewed towards low indices
+// like frequent features.
+std::vector< std::uint32_t > draw( std::mt19937_64 & random )
+{
+  std::uniform_real_distribution< double > uniform( 0.0 , 1.0 );
+  std::vector< std::uint32_t > indices;
+  while( indices.size() < coordinates_per_update )
+  {
+    for( std::size_t k = indices.size() ; k < coordinates_per_update ; ++k )
+    {
+      indices.push_back( static_cast< std::uint32_t >(
+        dimension * std::pow( uniform( random ) , 2.0 ) ) );
+    }
+    std::sort( indices.begin() , indices.end() );
+    indices.erase( std::unique( indices.begin() , indices.end() ) ,
+                   indices.end() );
+  }
+  return indices;
+}
+
+dense_vector make_dense( const std::vector< std::uint32_t > & indices )
+{
+  dense_vector result;
+  result.values.assign( dimension , 0.0f );
+  for( const auto index : indices )
+  {
+    result.values[ index ] += 1.0f;
+  }
+  return result;
+}
+
+sparse_vector< float > make_sparse( const std::vector< std::uint32_t > & indices )
+{
+  sparse_vector< float > result;
+  for( const auto index : indices )
+  {
+    result.add( index , 1.0f );
+  }
+  return result;
+}
+
+// Updates are committed one at a time; after every update one
+// of the workers, in turn, pulls the delta since its last pull.
+template< class Vector , class Make , class Read >
+void run( const char * name , Make make , Read read )
+{
+  std::mt19937_64 random( 1 );
+  std::vector< std::vector< std::uint32_t > > drawn;
+  for( std::size_t u = 0 ; u < updates ; ++u )
+  {
+    drawn.push_back( draw( random ) );
+  }
+
+  archived< Vector > archive( ( Vector() ) );
+  std::vector< typename archived< Vector >::version > pulled(
+    workers , archive.current() );
+
+  double commit_seconds = 0 , pull_seconds = 0;
+  double total = 0;
+  for( std::size_t u = 0 ; u < updates ; ++u )
+  {
+    const Vector update = make( drawn[ u ] );
+    auto start = bench_clock::now();
+    archive.increment_by( update );
+    commit_seconds += seconds_since( start );
+
+    start = bench_clock::now();
+    auto & worker = pulled[ u % workers ];
+    total += read( diff_to_current( worker ) );
+    worker = archive.current();
+    pull_seconds += seconds_since( start );
+  }
+
+  std::cout << name << ": " << commit_seconds / updates * 1e6
+            << " us/commit, " << pull_seconds / updates * 1e6
+            << " us/pull (checksum " << total << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << dimension << " dimensions, " << updates << " updates of "
+            << coordinates_per_update << " coordinates, " << workers
+            << " workers pulling in turn.\n";
+
+  run< dense_vector >( "archived< dense vector >" , make_dense ,
+    []( const dense_vector & delta )
+    {
+      double sum = 0;
+      for( const auto value : delta.values ) sum += value;
+      return sum;
+    } );
+  run< sparse_vector< float > >( "sparse_vector_archive<>" , make_sparse ,
+    []( const sparse_vector< float > & delta )
+    {
+      double sum = 0;
+      for( const auto value : delta.values() ) sum += value;
+      return sum;
+    } );
+
+  std::mt19937_64 random( 2 );
+  auto merged = make_sparse( draw( random ) );
+  const auto start = bench_clock::now();
+  const auto dense = merged.densify( dimension );
+  std::cout << "densify() on request: " << seconds_since( start ) * 1e6
+            << " us (" << dense.size() << " coordinates)\n";
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include "archived_sparse.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+const std::size_t dimension = 5000;
+typedef sparse_vector< std::int64_t > tested_vector;
+
+int main ( int argc , const char ** argv )
+{
+  //Test constructor
+  sparse_vector_archive< std::int64_t > tested_object_1( ( tested_vector() ) );
+
+  if( !check_equal( 0 , tested_object_1.value().size() ,
+                    "Value after construction." ) )
+  {
+    return 1;
+  }
+
+  //Test the increment and calculation of diff;
+  std::vector< sparse_vector_archive< std::int64_t >::version > version_vector;
+  std::vector< std::vector< std::int64_t > > control_values;
+
+  version_vector.push_back( tested_object_1.current() );
+  control_values.push_back( std::vector< std::int64_t >( dimension ) );
+
+  std::cout << "Increment, First Run. \n";
+
+  // Updates of a few scattered coordinates and of dense runs,
+  // so merges copy both short and long runs.
+  std::mt19937 random( 1 );
+  for( std::size_t step = 0 ; step < 60 ; ++step )
+  {
+    tested_vector increment;
+    const std::size_t start = random() % dimension;
+    const std::size_t length = step % 3 == 0 ? 100 : 1;
+    for( std::size_t k = 0 ; k < 30 ; ++k )
+    {
+      const std::size_t index = ( start + k * length ) % dimension;
+      increment.add( static_cast< std::uint32_t >( index ) ,
+                     std::int64_t( step ) - 20 );
+      increment.add( static_cast< std::uint32_t >( index ) , 1 );
+      for( auto & control : control_values )
+      {
+        control[ index ] += std::int64_t( step ) - 19;
+      }
+    }
+
+    version_vector.push_back( tested_object_1.increment_by( increment ) );
+    control_values.push_back( std::vector< std::int64_t >( dimension ) );
+  }
+
+  std::cout << "Increment Check, First Run. \n";
+
+  for( std::size_t i = 0 ; i < version_vector.size() ; ++i )
+  {
+    const auto diff = diff_to_current( version_vector[ i ] );
+    const auto dense = diff.densify( dimension );
+
+    for( std::size_t k = 0 ; k < dimension ; ++k )
+    {
+      if( dense[ k ] != control_values[ i ][ k ] ||
+          diff.get( static_cast< std::uint32_t >( k ) ) != dense[ k ] )
+      {
+        return !check_equal( control_values[ i ][ k ] , dense[ k ] ,
+                             "Coordinate of Diff to Current, First Run." );
+      }
+    }
+    for( std::size_t k = 1 ; k < diff.size() ; ++k )
+    {
+      if( diff.indices()[ k - 1 ] >= diff.indices()[ k ] )
+      {
+        return !check_equal( diff.indices()[ k - 1 ] + 1 ,
+                             diff.indices()[ k ] ,
+                             "Sorted indices, First Run." );
+      }
+    }
+  }
+
+  //Only updated coordinates are stored
+  if( !check_equal( 30 , diff_to_current( version_vector[ 59 ] ).size() ,
+                    "Size of a short diff." ) )
+  {
+    return 1;
+  }
+
+  //Sum with itself
+  auto doubled = diff_to_current( version_vector[ 0 ] );
+  const auto size = doubled.size();
+  doubled += doubled;
+  if( !check_equal( size , doubled.size() , "Size of the sum." ) )
+  {
+    return 1;
+  }
+  for( std::size_t k = 0 ; k < dimension ; ++k )
+  {
+    if( doubled.get( static_cast< std::uint32_t >( k ) ) !=
+        2 * control_values[ 0 ][ k ] )
+    {
+      return !check_equal( 2 * control_values[ 0 ][ k ] ,
+                           doubled.get( static_cast< std::uint32_t >( k ) ) ,
+                           "Doubled coordinate." );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,407 @@
+#ifndef ARCHIVED_SPSC_H
+#define ARCHIVED_SPSC_H
+
+#include "archived.h"
+
+#include <atomic>
+/** @file */
+
+/**
+ @brief An archived<> with exactly one writer thread
+ and one reader thread, synchronized by acquire and release only.
+
+ # Overview
+
+ A spsc_archived<Value,Policy> is incremented by one thread,
+ the writer, and queried by another, the reader.
+ Neither takes a lock, and the writer never waits for the reader.
+
+ ## Publication:
+
+ increment_by() writes the diff into the head commit,
+ then publishes the commit's successor with a release store.
+ The reader loads successors with acquire, so it reads a diff
+ only after the store that made the commit a non-head one.
+ A commit the reader sees as head is never read beyond its link.
+
+ ## Compression:
+
+ Only the reader compresses paths, like archived<> does.
+ Once a commit is not the head anymore, the writer never touches it
+ again, so its diff and successor belong to the reader.
+ The head is never modified by the reader.
+
+ ## Threads:
+
+ increment_by() is called by the writer. value(), current(), and all
+ uses of versions, including diff_to_current(), by the reader.
+ reset() must not run concurrently with any other member.
+
+ Commits are kept in a chunk_arena<> with Policy::pages, and only
+ released by reset(): the history grows with every increment.
+*/
+template< class Value , class Policy = archived_defaults >
+class spsc_archived
+{
+ public:
+  class version;
+
+  typedef Value value_type; /**< @brief The archived value's type. */
+  typedef version version_type; /**< @brief The type of versions provided. */
+
+ private:
+  class commit;
+
+  typedef chunk_arena< commit , typename Policy::pages > storage_type;
+                            /**< @internal @brief The container for commits. */
+
+  friend version_type; /**< @internal */
+
+  alignas( 64 ) storage_type storage_; /**< @internal @brief Storage for
+                                            commits, written by the writer. */
+  commit * head_; /**< @internal @brief The head commit, writer side. */
+  alignas( 64 ) std::atomic< commit * > published_; /**< @internal @brief A
+                                                         recent head commit,
+                                                         for the reader. */
+  alignas( 64 ) commit * first_; /**< @internal @brief The initial commit,
+                                      reader side. */
+
+  /**
+   @internal @brief Compresses the path from old to the head,
+   reader side. If Value::operator+= throws, the links of the
+   commits not folded yet are restored.
+
+   @return The diff of old to the current value.
+  */
+  static Value compute_diff_to_current
+  (
+    commit *
+     old /**< The old commit to be updated. */
+  );
+
+ public:
+  /**
+   @brief Constructor that initializes the archive with initial_value.
+  */
+  explicit spsc_archived
+  (
+    const Value &
+     initial_value /**< The initial value. */
+  );
+
+  spsc_archived( const spsc_archived & other ) = delete;
+  spsc_archived & operator= ( const spsc_archived & other ) = delete;
+
+  /**
+   @brief Increments the value by increment. Writer side.
+   Unlike archived<>, no version is returned:
+   versions belong to the reader, see current().
+  */
+  void increment_by
+  (
+    const Value &
+     increment /**< The value to increment by. */
+  );
+
+  /**
+   @brief Returns the current value. Reader side.
+
+   @return the current value.
+  */
+  Value value() const;
+
+  /**
+   @brief Returns a new version. Reader side.
+
+   @return A new version.
+  */
+  version_type current() const;
+
+  /**
+   @brief Clears the stored history data.
+   Sets current value to initial_value.
+   All associated versions are invalidated.
+   Neither thread may use the archive meanwhile.
+  */
+  void reset
+  (
+    const Value &
+     initial_value /**< The new value. */
+  );
+};
+
+/**
+ @internal @brief A commit: the diff and the published successor,
+ nullptr while the commit is the head.
+*/
+template< class Value , class Policy >
+class spsc_archived< Value , Policy >::commit
+{
+ public:
+  std::atomic< commit * > next_; /**< @internal @brief The successor. */
+  Value diff_; /**< @internal @brief The diff. */
+
+  /**
+   @internal @brief Constructs a head commit.
+  */
+  commit();
+
+  /**
+   @internal @brief Overwrites a commit kept by the arena.
+   Only used while no thread reads the archive.
+  */
+  commit & operator=
+  (
+    commit &&
+     other /**< The new commit. */
+  );
+};
+
+/**
+ @brief A version of a spsc_archived<>, owned by the reader.
+ A version is only valid as long as the associated
+ spsc_archived<> exists and is not reset.
+*/
+template< class Value , class Policy >
+class spsc_archived< Value , Policy >::version
+{
+ public:
+  typedef Value value_type; /**< @brief The archived value's type. */
+  typedef spsc_archived< Value , Policy > archive_type;
+                            /**< @brief The associated archive's type. */
+
+ private:
+  friend spsc_archived< Value , Policy >; /**< @internal */
+
+  commit * commit_; /**< @internal @brief The first commit after
+                         the version. */
+
+  /**
+   @internal @brief Computes the diff of old to the current value.
+  */
+  static Value compute_diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  );
+
+  /**
+   @internal @brief A constructor initializing commit_.
+  */
+  explicit version
+  (
+    commit *
+     position /**< The first commit after the version. */
+  );
+
+ public:
+  /**
+   @brief Default Constructor.
+   A default constructed version is not valid.
+  */
+  version();
+
+  /**
+   @brief Computes the difference of old and current value.
+   Reader side.
+
+   @return The value difference between old and current version.
+  */
+  friend Value diff_to_current
+  (
+    const version &
+     old /**< An old version. */
+  )
+  {
+    return compute_diff_to_current( old );
+  }
+};
+
+
+
+/*
+  Implementation of spsc_archived<> class members
+*/
+
+template< class Value , class Policy >
+ Value
+  spsc_archived< Value , Policy >::compute_diff_to_current
+  (
+    commit *
+     old
+  )
+{
+  commit * next = old->next_.load( std::memory_order_acquire );
+  if( ! next )
+  {
+    return Value();
+  }
+
+  // Walk to the last commit before the head, reversing the links.
+  // A commit is the head while its successor is unpublished,
+  // its diff is only read after acquiring its successor.
+  commit * previous = nullptr;
+  commit * current = old;
+  for( ;; )
+  {
+    commit * const after = next->next_.load( std::memory_order_acquire );
+    if( ! after )
+    {
+      break;
+    }
+    current->next_.store( previous , std::memory_order_relaxed );
+    previous = current;
+    current = next;
+    next = after;
+  }
+
+  // Every commit on the way refers to the head instead of current.
+  const auto head = next;
+  while( previous )
+  {
+    const auto before = previous->next_.load( std::memory_order_relaxed );
+    try
+    {
+      previous->diff_ += current->diff_;
+    } catch( ... ) {
+      // Point the reversed commits to their successors again.
+      while( previous )
+      {
+        const auto reversed =
+          previous->next_.load( std::memory_order_relaxed );
+        previous->next_.store( current , std::memory_order_relaxed );
+        current = previous;
+        previous = reversed;
+      }
+      throw;
+    }
+    previous->next_.store( head , std::memory_order_relaxed );
+    current = previous;
+    previous = before;
+  }
+  return old->diff_;
+}
+
+template< class Value , class Policy >
+  spsc_archived< Value , Policy >::spsc_archived
+  (
+    const Value &
+     initial_value
+  )
+  : storage_() ,
+    head_() ,
+    published_() ,
+    first_()
+{
+  reset( initial_value );
+}
+
+template< class Value , class Policy >
+ void
+  spsc_archived< Value , Policy >::increment_by
+  (
+    const Value &
+     increment
+  )
+{
+  const auto fresh = storage_.create();
+  head_->diff_ = increment;
+  head_->next_.store( fresh , std::memory_order_release );
+  head_ = fresh;
+  published_.store( fresh , std::memory_order_release );
+}
+
+template< class Value , class Policy >
+ Value
+  spsc_archived< Value , Policy >::value() const
+{
+  return compute_diff_to_current( first_ );
+}
+
+template< class Value , class Policy >
+ typename spsc_archived< Value , Policy >::version_type
+  spsc_archived< Value , Policy >::current() const
+{
+  // The writer links a commit before it publishes it,
+  // so the head may be ahead of published_.
+  auto head = published_.load( std::memory_order_acquire );
+  while( const auto next = head->next_.load( std::memory_order_acquire ) )
+  {
+    head = next;
+  }
+  return version_type( head );
+}
+
+template< class Value , class Policy >
+ void
+  spsc_archived< Value , Policy >::reset
+  (
+    const Value &
+     initial_value
+  )
+{
+  storage_.clear();
+  head_ = storage_.create();
+  first_ = head_;
+  published_.store( head_ , std::memory_order_release );
+
+  increment_by( initial_value );
+}
+
+/*
+  Implementation of spsc_archived<>::commit class members
+*/
+
+template< class Value , class Policy >
+  spsc_archived< Value , Policy >::commit::commit()
+  : next_( nullptr ) ,
+    diff_()
+{
+}
+
+template< class Value , class Policy >
+ typename spsc_archived< Value , Policy >::commit &
+  spsc_archived< Value , Policy >::commit::operator=
+  (
+    commit &&
+     other
+  )
+{
+  next_.store( other.next_.load( std::memory_order_relaxed ) ,
+               std::memory_order_relaxed );
+  diff_ = std::move( other.diff_ );
+  return *this;
+}
+
+/*
+  Implementation of spsc_archived<>::version class members
+*/
+
+template< class Value , class Policy >
+ Value
+  spsc_archived< Value , Policy >::version::compute_diff_to_current
+  (
+    const version &
+     old
+  )
+{
+  return archive_type::compute_diff_to_current( old.commit_ );
+}
+
+template< class Value , class Policy >
+  spsc_archived< Value , Policy >::version::version
+  (
+    commit *
+     position
+  )
+  : commit_( position )
+{
+}
+
+template< class Value , class Policy >
+  spsc_archived< Value , Policy >::version::version()
+  : commit_()
+{
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include "archived_spsc.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <iostream>
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+const std::int64_t round_trips = 200000;
+const std::int64_t increments = 10000000;
+
+// Spins, yielding so the other thread gets to run on few CPUs.
+template< class Done >
+void spin_until( Done done )
+{
+  while( ! done() )
+  {
+    std::this_thread::yield();
+  }
+}
+
+// An archived<> guarded by a mutex, as used before spsc_archived<>.
+class locked_archive
+{
+ public:
+  mutable std::mutex mutex;
+  archived< std::int64_t > archive;
+
+  locked_archive() : mutex() , archive( 0 ) {}
+
+  void increment_by( std::int64_t increment )
+  {
+    std::lock_guard< std::mutex > lock( mutex );
+    archive.increment_by( increment );
+  }
+
+  std::int64_t value() const
+  {
+    std::lock_guard< std::mutex > lock( mutex );
+    return archive.value();
+  }
+};
+
+// The writer increments, the reader answers once it sees the increment,
+// and the writer waits for the answer before the next increment.
+template< class Archive >
+void ping_pong( Archive & archive , const char * name )
+{
+  std::atomic< std::int64_t > answer( 0 );
+  std::thread reader( [ & ]()
+  {
+    for( std::int64_t seen = 1 ; seen <= round_trips ; ++seen )
+    {
+      spin_until( [ & ](){ return archive.value() == seen; } );
+      answer.store( seen , std::memory_order_release );
+    }
+  } );
+
+  const auto start = bench_clock::now();
+  for( std::int64_t sent = 1 ; sent <= round_trips ; ++sent )
+  {
+    archive.increment_by( 1 );
+    spin_until( [ & ](){
+      return answer.load( std::memory_order_acquire ) == sent; } );
+  }
+  const double elapsed = seconds_since( start );
+  reader.join();
+
+  std::cout << name << ", ping-pong: "
+            << elapsed * 1e9 / round_trips << " ns/round trip\n";
+}
+
+// The writer increments as fast as it can while the reader polls.
+template< class Archive >
+void throughput( Archive & archive , const char * name )
+{
+  std::atomic< bool > done( false );
+  std::int64_t polls = 0;
+  std::thread reader( [ & ]()
+  {
+    while( ! done.load( std::memory_order_acquire ) )
+    {
+      polls += archive.value() > 0;
+      std::this_thread::yield();
+    }
+  } );
+
+  const auto start = bench_clock::now();
+  for( std::int64_t i = 0 ; i < increments ; ++i )
+  {
+    archive.increment_by( 1 );
+  }
+  const double elapsed = seconds_since( start );
+  done.store( true , std::memory_order_release );
+  reader.join();
+
+  std::cout << name << ", writer: "
+            << increments / elapsed / 1e6 << " M increments/s with "
+            << polls << " polls\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << std::thread::hardware_concurrency() << " CPU(s).\n";
+
+  {
+    spsc_archived< std::int64_t > archive( 0 );
+    ping_pong( archive , "spsc_archived<>" );
+  }
+  {
+    locked_archive archive;
+    ping_pong( archive , "archived<> and mutex" );
+  }
+  {
+    spsc_archived< std::int64_t > archive( 0 );
+    throughput( archive , "spsc_archived<>" );
+  }
+  {
+    locked_archive archive;
+    throughput( archive , "archived<> and mutex" );
+  }
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include "archived_spsc.h"
+
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+#include <iostream>
+
+bool check_equal( std::int64_t a , std::int64_t b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+// An int whose operator+= throws once a countdown runs out,
+// like a diff failing to allocate.
+class throwing
+{
+ public:
+  static int countdown;
+  int value;
+
+  throwing() : value( 0 ) {}
+  explicit throwing( int v ) : value( v ) {}
+
+  throwing & operator+= ( const throwing & other )
+  {
+    if( countdown > 0 && --countdown == 0 )
+    {
+      throw std::bad_alloc();
+    }
+    value += other.value;
+    return *this;
+  }
+};
+
+int throwing::countdown = 0;
+
+int main ( int argc , const char ** argv )
+{
+  const std::int64_t initial_value = 13 , increments = 200000;
+
+  spsc_archived< std::int64_t > tested_object_1( initial_value );
+
+  //Single thread
+
+  std::cout << "Increment, Single Thread. \n";
+
+  std::vector< spsc_archived< std::int64_t >::version > version_vector;
+  std::vector< std::int64_t > control_values;
+  std::int64_t total = initial_value;
+  for( std::int64_t i = 0 ; i < 1000 ; ++i )
+  {
+    if( i % 100 == 0 )
+    {
+      version_vector.push_back( tested_object_1.current() );
+      control_values.push_back( total );
+    }
+    tested_object_1.increment_by( i % 7 );
+    total += i % 7;
+  }
+
+  for( std::size_t v = version_vector.size() ; v-- > 0 ; )
+  {
+    if( !check_equal( total - control_values[ v ] ,
+                      diff_to_current( version_vector[ v ] ) ,
+                      "Diffs to Current, Single Thread." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( total , tested_object_1.value() ,
+                    "Value, Single Thread." ) )
+  {
+    return 1;
+  }
+
+  //Writer and reader thread
+
+  std::cout << "Increment, Two Threads. \n";
+
+  version_vector.clear();
+  tested_object_1.reset( initial_value );
+  const auto first = tested_object_1.current();
+
+  std::thread writer( [ & ]()
+  {
+    for( std::int64_t i = 0 ; i < increments ; ++i )
+    {
+      tested_object_1.increment_by( 1 );
+    }
+  } );
+
+  // A version's diff never exceeds what was incremented since
+  // a value read before it was taken.
+  std::int64_t previous = initial_value , violations = 0;
+  while( previous < initial_value + increments )
+  {
+    const auto before = tested_object_1.value();
+    const auto taken = tested_object_1.current();
+    const auto diff = diff_to_current( taken );
+    const auto after = tested_object_1.value();
+    if( before < previous || after - diff < before )
+    {
+      ++violations;
+    }
+    previous = after;
+  }
+  writer.join();
+
+  if( !check_equal( 0 , violations , "Violations, Two Threads." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( increments , diff_to_current( first ) ,
+                    "Diff to Current, Two Threads." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( initial_value + increments , tested_object_1.value() ,
+                    "Value, Two Threads." ) )
+  {
+    return 1;
+  }
+
+  //A throwing operator+= leaves the history intact
+
+  std::cout << "Throwing Increment. \n";
+
+  spsc_archived< throwing > tested_object_2( ( throwing( 1 ) ) );
+  const auto early = tested_object_2.current();
+  for( int i = 0 ; i < 100 ; ++i )
+  {
+    tested_object_2.increment_by( throwing( 1 ) );
+  }
+  bool thrown = false;
+  throwing::countdown = 50;
+  try
+  {
+    diff_to_current( early );
+  } catch( const std::bad_alloc & ) {
+    thrown = true;
+  }
+  throwing::countdown = 0;
+  if( !check_equal( true , thrown , "Thrown by operator+=." ) ||
+      !check_equal( 100 , diff_to_current( early ).value ,
+                    "Diff to Current after a Throw." ) ||
+      !check_equal( 101 , tested_object_2.value().value ,
+                    "Value after a Throw." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include "archived.h"
 
+#include <new>
+#include <type_traits>
 #include <vector>
 #include <numeric>
 #include <iostream>
@@ -19,6 +21,120 @@ bool check_equal( int a , int b , const std::string & msg )
   }
 }
 
+// Counts references, so clear_history() keeps versions.
+class counting : public archived_defaults
+{
+ public:
+  static const bool track_references = true;
+};
+
+// Keeps the diffs apart from the commits.
+class split : public archived_defaults
+{
+ public:
+  static const bool split_payload = true;
+};
+
+// A diff spanning several cache lines.
+class wide
+{
+ public:
+  int lanes[ 32 ];
+
+  wide() : lanes() {}
+
+  explicit wide( int value ) : lanes()
+  {
+    for( auto & lane : lanes ) lane = value;
+  }
+
+  wide & operator+= ( const wide & other )
+  {
+    for( int i = 0 ; i < 32 ; ++i ) lanes[ i ] += other.lanes[ i ];
+    return *this;
+  }
+};
+
+// An int whose operator+= throws once a countdown runs out,
+// like a diff failing to allocate.
+class throwing
+{
+ public:
+  static int countdown;
+  int value;
+
+  throwing() : value( 0 ) {}
+  explicit throwing( int v ) : value( v ) {}
+
+  throwing & operator+= ( const throwing & other )
+  {
+    if( countdown > 0 && --countdown == 0 )
+    {
+      throw std::bad_alloc();
+    }
+    value += other.value;
+    return *this;
+  }
+};
+
+int throwing::countdown = 0;
+
+// Compresses with Compression, and counts references.
+template< class Compression >
+class compressing : public archived_defaults
+{
+ public:
+  typedef Compression compression;
+  static const bool track_references = true;
+};
+
+// Queries versions in a scattered order between increments,
+// then checks that compaction still finds all garbage.
+template< class Compression >
+bool check_compression( const std::string & name )
+{
+  typedef archived< int , compressing< Compression > > archive_type;
+
+  archive_type archive( 0 );
+  std::vector< typename archive_type::version > versions;
+  std::vector< int > taken_at;
+  int total = 0;
+  for( int i = 0 ; i < 2000 ; ++i )
+  {
+    if( i % 10 == 0 )
+    {
+      versions.push_back( archive.current() );
+      taken_at.push_back( total );
+    }
+    archive.increment_by( i % 5 );
+    total += i % 5;
+
+    const std::size_t queried = ( i * 7919 ) % versions.size();
+    if( diff_to_current( versions[ queried ] ) != total - taken_at[ queried ] )
+    {
+      return check_equal( total - taken_at[ queried ] ,
+                          diff_to_current( versions[ queried ] ) ,
+                          "Diff to Current, " + name + "." );
+    }
+  }
+
+  for( std::size_t v = 0 ; v < versions.size() ; v += 3 )
+  {
+    if( !check_equal( total - taken_at[ v ] , diff_to_current( versions[ v ] ) ,
+                      "Diffs to Current, " + name + "." ) )
+    {
+      return false;
+    }
+  }
+
+  versions.clear();
+  archive.clear_history();
+  // The initial commit and the head.
+  return check_equal( 2 , static_cast< int >( archive.commits() ) ,
+                      "Commits after Clear History, " + name + "." ) &&
+         check_equal( total , archive.value() , "Value, " + name + "." );
+}
+
 int main ( int argc , const char ** argv )
 {
   // provide the test data
@@ -88,6 +204,369 @@ int main ( int argc , const char ** argv )
     }
   }
 
+  //Second Run: a history spanning many arena chunks
+
+  std::cout << "Increment, Second Run. \n";
+  std::cout.flush();
+
+  archived< int , counting > tested_object_2( initial_value );
+  std::vector< archived< int , counting >::version > long_versions;
+  const int long_history = 20000;
+
+  for( int i = 0 ; i < long_history ; ++i )
+  {
+    if( i % 1000 == 0 )
+    {
+      long_versions.push_back( tested_object_2.current() );
+    }
+    tested_object_2.increment_by( i % 7 );
+  }
+
+  std::cout << "Increment Check, Second Run. \n";
+  std::cout.flush();
+
+  int long_final_value = initial_value;
+  for( int i = 0 ; i < long_history ; ++i )
+  {
+    long_final_value += i % 7;
+  }
+
+  for( std::size_t v = long_versions.size() ; v-- > 0 ; )
+  {
+    int should_be = 0;
+    for( int i = static_cast< int >( v ) * 1000 ; i < long_history ; ++i )
+    {
+      should_be += i % 7;
+    }
+    if( !check_equal( should_be ,
+                      diff_to_current( long_versions[ v ] ) ,
+                      "Diffs to Current, Second Run." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( long_final_value ,
+                    tested_object_2.value() ,
+                    "Value, Second Run." ) )
+  {
+    return 1;
+  }
+
+  //Clear the history, keeping every other version
+
+  std::cout << "Clear History. \n";
+  std::cout.flush();
+
+  for( std::size_t v = 1 ; v < long_versions.size() ; v += 2 )
+  {
+    long_versions[ v ] = archived< int , counting >::version();
+  }
+  const auto cleared = tested_object_2.clear_history();
+
+  // The kept versions, the initial commit and the head.
+  if( !check_equal( static_cast< int >( ( long_versions.size() + 1 ) / 2 + 2 ) ,
+                    static_cast< int >( tested_object_2.commits() ) ,
+                    "Commits after Clear History." ) )
+  {
+    return 1;
+  }
+
+  tested_object_2.increment_by( 5 );
+  for( std::size_t v = 0 ; v < long_versions.size() ; v += 2 )
+  {
+    int should_be = 5;
+    for( int i = static_cast< int >( v ) * 1000 ; i < long_history ; ++i )
+    {
+      should_be += i % 7;
+    }
+    if( !check_equal( should_be ,
+                      diff_to_current( long_versions[ v ] ) ,
+                      "Diffs to Current, Clear History." ) )
+    {
+      return 1;
+    }
+  }
+
+  if( !check_equal( 5 , diff_to_current( cleared ) ,
+                    "Diff to Current of cleared version." ) )
+  {
+    return 1;
+  }
+
+  if( !check_equal( long_final_value + 5 ,
+                    tested_object_2.value() ,
+                    "Value, Clear History." ) )
+  {
+    return 1;
+  }
+
+  //Third Run: large diffs kept apart from the commits, across resets
+
+  std::cout << "Increment, Third Run. \n";
+  std::cout.flush();
+
+  const wide wide_initial_value( initial_value );
+  archived< wide , split > tested_object_3( wide_initial_value );
+  for( int round = 0 ; round < 3 ; ++round )
+  {
+    std::vector< archived< wide , split >::version > wide_versions;
+    for( int i = 0 ; i < long_history ; ++i )
+    {
+      if( i % 1000 == 0 )
+      {
+        wide_versions.push_back( tested_object_3.current() );
+      }
+      tested_object_3.increment_by( wide( i % 7 ) );
+    }
+
+    for( std::size_t v = wide_versions.size() ; v-- > 0 ; )
+    {
+      int should_be = 0;
+      for( int i = static_cast< int >( v ) * 1000 ; i < long_history ; ++i )
+      {
+        should_be += i % 7;
+      }
+      const auto diff = diff_to_current( wide_versions[ v ] );
+      if( !check_equal( should_be , diff.lanes[ v % 32 ] ,
+                        "Diffs to Current, Third Run." ) )
+      {
+        return 1;
+      }
+    }
+
+    if( !check_equal( long_final_value , tested_object_3.value().lanes[ 31 ] ,
+                      "Value, Third Run." ) )
+    {
+      return 1;
+    }
+    wide_versions.clear();
+    tested_object_3.reset( wide_initial_value );
+  }
+
+  //A throwing operator+= leaves the history intact
+
+  std::cout << "Throwing Increment. \n";
+  std::cout.flush();
+
+  {
+    archived< throwing > tested_object_5( ( throwing( initial_value ) ) );
+    std::vector< archived< throwing >::version > throwing_versions;
+    for( int i = 0 ; i < 100 ; ++i )
+    {
+      throwing_versions.push_back( tested_object_5.current() );
+      tested_object_5.increment_by( throwing( i ) );
+    }
+
+    bool thrown = false;
+    throwing::countdown = 50;
+    try
+    {
+      diff_to_current( throwing_versions[ 10 ] );
+    } catch( const std::bad_alloc & ) {
+      thrown = true;
+    }
+    throwing::countdown = 0;
+    if( !check_equal( true , thrown , "Thrown by operator+=." ) )
+    {
+      return 1;
+    }
+
+    for( int v = 0 ; v < 100 ; v += 7 )
+    {
+      if( !check_equal( ( 99 * 100 - v * ( v - 1 ) ) / 2 ,
+                        diff_to_current( throwing_versions[ v ] ).value ,
+                        "Diff to Current after a Throw." ) )
+      {
+        return 1;
+      }
+    }
+    if( !check_equal( initial_value + 99 * 100 / 2 ,
+                      tested_object_5.value().value ,
+                      "Value after a Throw." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Without reference counts, versions may outlive their archive
+
+  std::cout << "Untracked. \n";
+  std::cout.flush();
+
+  archived< int >::version outliving;
+  {
+    archived< int > tested_object_4( initial_value );
+    tested_object_4.increment_by( 2 );
+    outliving = tested_object_4.current();
+    tested_object_4.increment_by( 3 );
+    while( ! tested_object_4.compact( 16 ) )
+    {
+    }
+    // Nothing is released: the initial commit, three increments.
+    if( !check_equal( 4 , static_cast< int >( tested_object_4.commits() ) ,
+                      "Commits after Compaction, Untracked." ) ||
+        !check_equal( 3 , diff_to_current( outliving ) ,
+                      "Diff to Current, Untracked." ) )
+    {
+      return 1;
+    }
+    // A new history from the current value.
+    tested_object_4.clear_history();
+    if( !check_equal( 2 , static_cast< int >( tested_object_4.commits() ) ,
+                      "Commits after Clear History, Untracked." ) ||
+        !check_equal( initial_value + 5 , tested_object_4.value() ,
+                      "Value after Clear History, Untracked." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Moving archives, e.g. within a growing vector
+
+  std::cout << "Moving. \n";
+  std::cout.flush();
+
+  // Lets containers move archives and versions with the strong guarantee.
+  static_assert( std::is_nothrow_move_constructible< archived< int > >::value ,
+                 "archived<> moves without throwing." );
+  static_assert( std::is_nothrow_move_assignable< archived< int > >::value ,
+                 "archived<> move assigns without throwing." );
+  static_assert( std::is_nothrow_move_constructible<
+                   archived< int >::version >::value ,
+                 "Versions move without throwing." );
+
+  std::vector< archived< int > > moved_objects;
+  std::vector< archived< int >::version > moved_versions;
+  for( int i = 0 ; i < 100 ; ++i )
+  {
+    moved_objects.emplace_back( i );
+    moved_versions.push_back( moved_objects.back().current() );
+    for( auto & moved : moved_objects )
+    {
+      moved.increment_by( 1 );
+    }
+  }
+
+  for( int i = 0 ; i < 100 ; i += 9 )
+  {
+    if( !check_equal( 100 - i , diff_to_current( moved_versions[ i ] ) ,
+                      "Diff to Current after Moving." ) ||
+        !check_equal( 100 , moved_objects[ i ].value() ,
+                      "Value after Moving." ) )
+    {
+      return 1;
+    }
+  }
+
+  moved_versions.resize( 1 );
+  for( int i = 1 ; i < 100 ; ++i )
+  {
+    moved_objects[ i ].increment_by( i );
+  }
+  moved_objects[ 0 ].increment_by( 5 );
+  moved_objects.erase( moved_objects.begin() + 1 ,
+                       moved_objects.begin() + 50 );
+  if( !check_equal( 105 , diff_to_current( moved_versions[ 0 ] ) ,
+                    "Diff to Current after Move Assignment." ) ||
+      !check_equal( 100 + 50 , moved_objects[ 1 ].value() ,
+                    "Value after Move Assignment." ) )
+  {
+    return 1;
+  }
+  moved_versions.clear();
+
+  //Move assigning over archives with live versions
+
+  std::cout << "Move Assignment over Versions. \n";
+  std::cout.flush();
+
+  {
+    typedef archived< int , compressing< full_compression > > counted_type;
+    counted_type target( 1 ) , source( 2 );
+    target.increment_by( 3 );
+    const auto target_version = target.current();
+    target.increment_by( 4 );
+    const auto source_version = source.current();
+    source.increment_by( 5 );
+
+    target = std::move( source );
+    target.increment_by( 6 );
+    // The old history of target lives on in source.
+    if( !check_equal( 4 , diff_to_current( target_version ) ,
+                      "Diff to Current of the overwritten history." ) ||
+        !check_equal( 11 , diff_to_current( source_version ) ,
+                      "Diff to Current of the moved history." ) ||
+        !check_equal( 13 , target.value() ,
+                      "Value after Move Assignment over Versions." ) )
+    {
+      return 1;
+    }
+  }
+
+  {
+    archived< int > target( 1 ) , source( 2 );
+    const auto target_version = target.increment_by( 3 );
+    target = std::move( source );
+    if( !check_equal( 2 , target.value() ,
+                      "Value after Move Assignment over Versions, "
+                      "Untracked." ) )
+    {
+      return 1;
+    }
+  }
+
+  //Compression strategies
+
+  std::cout << "Compression strategies. \n";
+  std::cout.flush();
+
+  if( !check_compression< full_compression >( "full compression" ) ||
+      !check_compression< path_halving >( "path halving" ) ||
+      !check_compression< path_splitting >( "path splitting" ) ||
+      !check_compression< no_compression >( "no compression" ) ||
+      !check_compression< adaptive_compression >( "adaptive compression" ) ||
+      !check_compression< deamortized_compression >(
+        "deamortized compression" ) )
+  {
+    return 1;
+  }
+
+  //Skip links release garbage right away and survive compaction
+
+  std::cout << "Skip links. \n";
+
+  archived< int , compressing< deamortized_compression > > tested_object_6( 0 );
+  for( int i = 0 ; i < 4096 ; ++i )
+  {
+    tested_object_6.increment_by( 1 );
+    tested_object_6.compact( 16 );
+  }
+  // The initial commit links to the 4096th increment, then the head.
+  if( !check_equal( 3 , static_cast< int >( tested_object_6.commits() ) ,
+                    "Commits with Skip links." ) ||
+      !check_equal( 4096 , tested_object_6.value() ,
+                    "Value with Skip links." ) )
+  {
+    return 1;
+  }
+
+  const auto skipping = tested_object_6.current();
+  for( int i = 0 ; i < 1000 ; ++i )
+  {
+    tested_object_6.increment_by( 2 );
+    tested_object_6.compact( 16 );
+  }
+  tested_object_6.clear_history();
+  tested_object_6.increment_by( 3 );
+  if( !check_equal( 2003 , diff_to_current( skipping ) ,
+                    "Diff to Current with Skip links." ) ||
+      !check_equal( 6099 , tested_object_6.value() ,
+                    "Value after Clear History with Skip links." ) )
+  {
+    return 1;
+  }
+
   return 0;
 }
 
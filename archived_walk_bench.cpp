@@ -0,0 +1,361 @@
+#include "archived.h"
+#include "archived_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#if defined( __linux__ )
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock bench_clock;
+
+double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// A hardware event counter of the calling thread, if the kernel grants one.
+class perf_counter
+{
+ public:
+  int fd;
+
+  perf_counter( std::uint32_t type , std::uint64_t config ) : fd( -1 )
+  {
+#if defined( __linux__ )
+    perf_event_attr attributes;
+    std::memset( &attributes , 0 , sizeof( attributes ) );
+    attributes.size = sizeof( attributes );
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    fd = static_cast< int >( syscall( __NR_perf_event_open , &attributes ,
+                                      0 , -1 , -1 , 0 ) );
+#endif
+  }
+
+  ~perf_counter()
+  {
+#if defined( __linux__ )
+    if( fd >= 0 ) close( fd );
+#endif
+  }
+
+  void start()
+  {
+#if defined( __linux__ )
+    if( fd >= 0 )
+    {
+      ioctl( fd , PERF_EVENT_IOC_RESET , 0 );
+      ioctl( fd , PERF_EVENT_IOC_ENABLE , 0 );
+    }
+#endif
+  }
+
+  std::string stop()
+  {
+#if defined( __linux__ )
+    std::uint64_t count = 0;
+    if( fd >= 0 )
+    {
+      ioctl( fd , PERF_EVENT_IOC_DISABLE , 0 );
+      if( read( fd , &count , sizeof( count ) ) == sizeof( count ) )
+      {
+        return std::to_string( count );
+      }
+    }
+#endif
+    return "n/a";
+  }
+};
+
+// The layout before arenas: one heap node per commit.
+class list_commit
+{
+ public:
+  list_commit * next;
+  std::int64_t diff;
+};
+
+// Walks read-only in diff_to_current(), value() compresses.
+class reading_policy : public archived_defaults
+{
+ public:
+  typedef no_compression compression;
+};
+
+class huge_page_policy : public reading_policy
+{
+ public:
+  typedef huge_pages pages;
+};
+
+// archive_pool<> folds without prefetching.
+class chasing_policy : public archived_defaults
+{
+ public:
+  static const std::size_t prefetch_distance = 0;
+};
+
+const std::size_t history = std::size_t( 1 ) << 22;
+const std::size_t eviction_bytes = std::size_t( 128 ) << 20;
+
+std::vector< char > eviction_buffer( eviction_bytes );
+
+// Streams through a buffer larger than the last level cache.
+void evict_caches()
+{
+  for( std::size_t i = 0 ; i < eviction_buffer.size() ; i += 64 )
+  {
+    eviction_buffer[ i ] += 1;
+  }
+}
+
+// The events counted around each measurement.
+class walk_counters
+{
+ public:
+  perf_counter misses;
+  perf_counter l1d_misses;
+  perf_counter dtlb_misses;
+
+#if defined( __linux__ )
+  walk_counters()
+    : misses( PERF_TYPE_HARDWARE , PERF_COUNT_HW_CACHE_MISSES ) ,
+      l1d_misses( PERF_TYPE_HW_CACHE ,
+                  PERF_COUNT_HW_CACHE_L1D |
+                  ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                  ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) ) ,
+      dtlb_misses( PERF_TYPE_HW_CACHE ,
+                   PERF_COUNT_HW_CACHE_DTLB |
+                   ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                   ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ) )
+  {
+  }
+#else
+  walk_counters() : misses( 0 , 0 ) , l1d_misses( 0 , 0 ) , dtlb_misses( 0 , 0 )
+  {
+  }
+#endif
+
+  void start()
+  {
+    misses.start();
+    l1d_misses.start();
+    dtlb_misses.start();
+  }
+
+  std::string stop()
+  {
+    const auto llc = misses.stop();
+    const auto l1d = l1d_misses.stop();
+    const auto dtlb = dtlb_misses.stop();
+    return "cache misses " + llc + ", L1D read misses " + l1d +
+           ", dTLB read misses " + dtlb;
+  }
+};
+
+// Both layouts walk the same history twice, cold: first reading it,
+// then reversing and folding it like value() does,
+// writing a diff and a link per commit.
+// Then versions taken every 16 commits are queried in random order.
+// value() compressed each of them straight to the head, so a query
+// is one hop: this measures the scattered commits of the versions.
+template< class Policy >
+void run( const std::string & name )
+{
+  typedef archived< std::int64_t , Policy > archive_type;
+
+  archive_type archive( 0 );
+  const auto first = archive.current();
+  std::vector< typename archive_type::version_type > versions;
+  for( std::size_t i = 0 ; i < history ; ++i )
+  {
+    if( i % 16 == 0 )
+    {
+      versions.push_back( archive.current() );
+    }
+    archive.increment_by( static_cast< std::int64_t >( i & 7 ) );
+  }
+  std::shuffle( versions.begin() , versions.end() , std::mt19937_64( 1 ) );
+  evict_caches();
+
+  walk_counters counters;
+  counters.start();
+  auto start = bench_clock::now();
+  const auto read = diff_to_current( first );
+  double elapsed = seconds_since( start );
+
+  std::cout << name << ", read: "
+            << elapsed * 1e9 / history << " ns/commit, "
+            << counters.stop() << " (total " << read << ")\n";
+
+  evict_caches();
+  counters.start();
+  start = bench_clock::now();
+  const auto total = archive.value();
+  elapsed = seconds_since( start );
+
+  std::cout << name << ", fold: "
+            << elapsed * 1e9 / history << " ns/commit, "
+            << counters.stop() << " (total " << total << ")\n";
+
+  evict_caches();
+  counters.start();
+  start = bench_clock::now();
+  std::int64_t sum = 0;
+  for( const auto & version : versions )
+  {
+    sum += diff_to_current( version );
+  }
+  elapsed = seconds_since( start );
+
+  std::cout << name << ", random queries: "
+            << elapsed * 1e9 / versions.size() << " ns/query, "
+            << counters.stop() << " (sum " << sum << ")\n";
+}
+
+// Node per commit, the histories of archives incremented round robin,
+// walked like archived<> does: read, then reversed and folded.
+void run_heap_nodes( std::size_t archives )
+{
+  std::vector< list_commit * > heads( archives ) , firsts( archives );
+  std::vector< list_commit * > nodes;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    heads[ a ] = firsts[ a ] = new list_commit{ nullptr , 0 };
+    heads[ a ]->next = heads[ a ];
+    nodes.push_back( heads[ a ] );
+  }
+  for( std::size_t i = 0 ; i < history ; ++i )
+  {
+    auto & head = heads[ i % archives ];
+    const auto fresh = new list_commit{ nullptr , 0 };
+    nodes.push_back( fresh );
+    fresh->next = fresh;
+    head->diff = static_cast< std::int64_t >( i & 7 );
+    head->next = fresh;
+    head = fresh;
+  }
+  evict_caches();
+
+  auto start = bench_clock::now();
+  std::int64_t read = 0;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    for( auto current = firsts[ a ] ; current->next != current ;
+         current = current->next )
+    {
+      read += current->diff;
+    }
+  }
+  double elapsed = seconds_since( start );
+
+  std::cout << "heap nodes, " << archives << " interleaved histories, read: "
+            << elapsed * 1e9 / history << " ns/commit"
+            << " (total " << read << ")\n";
+
+  evict_caches();
+  start = bench_clock::now();
+  std::int64_t total = 0;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    list_commit * previous = nullptr;
+    list_commit * current = firsts[ a ];
+    while( current->next->next != current->next )
+    {
+      const auto next = current->next;
+      current->next = previous;
+      previous = current;
+      current = next;
+    }
+    const auto head = current->next;
+    while( previous )
+    {
+      const auto before = previous->next;
+      previous->diff += current->diff;
+      previous->next = head;
+      current = previous;
+      previous = before;
+    }
+    total += firsts[ a ]->diff;
+  }
+  elapsed = seconds_since( start );
+
+  std::cout << "heap nodes, " << archives << " interleaved histories, fold: "
+            << elapsed * 1e9 / history << " ns/commit"
+            << " (total " << total << ")\n";
+
+  for( const auto node : nodes )
+  {
+    delete node;
+  }
+}
+
+// The histories of archives incremented in random order in one pool,
+// so every path jumps irregularly over the commits of all archives.
+// value() of each archive folds its whole path.
+template< class Policy >
+void run_pool( const std::string & name , std::size_t archives )
+{
+  typedef archive_pool< std::int64_t , Policy > pool_type;
+
+  pool_type pool;
+  std::vector< typename pool_type::handle_type > handles;
+  for( std::size_t a = 0 ; a < archives ; ++a )
+  {
+    handles.push_back( pool.create( 0 ) );
+  }
+  std::mt19937_64 random( 1 );
+  for( std::size_t i = 0 ; i < history ; ++i )
+  {
+    pool.increment_by( handles[ random() % archives ] ,
+                       static_cast< std::int64_t >( i & 7 ) );
+  }
+  evict_caches();
+
+  walk_counters counters;
+  counters.start();
+  const auto start = bench_clock::now();
+  std::int64_t total = 0;
+  for( const auto handle : handles )
+  {
+    total += pool.value( handle );
+  }
+  const double elapsed = seconds_since( start );
+
+  std::cout << name << ", " << archives << " shuffled histories, fold: "
+            << elapsed * 1e9 / history << " ns/commit, "
+            << counters.stop() << " (total " << total << ")\n";
+}
+
+int main ( int argc , const char ** argv )
+{
+  std::cout << "Cold walk of " << history << " uncompressed commits.\n";
+
+  for( int repetition = 0 ; repetition < 2 ; ++repetition )
+  {
+    run_heap_nodes( 1 );
+    run_heap_nodes( 64 );
+    run< reading_policy >( "arena" );
+    run< huge_page_policy >( "arena in huge pages" );
+    run_pool< chasing_policy >( "pool" , 64 );
+    run_pool< archived_defaults >( "pool, prefetch 16" , 64 );
+    run_pool< chasing_policy >( "pool" , 4096 );
+    run_pool< archived_defaults >( "pool, prefetch 16" , 4096 );
+  }
+
+  return 0;
+}
@@ -0,0 +1,295 @@
+#ifndef ARCHIVED_WATCH_H
+#define ARCHIVED_WATCH_H
+
+#include "archived.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+/** @file */
+
+/**
+ @brief Threshold watches on the diffs of an archived<>.
+
+ # Overview
+
+ A watch_registry<Value> increments an archived<Value> and fires
+ callbacks once the diff_to_current() of a version reaches a threshold,
+ without polling the versions.
+
+ The registry requires monotone increments: Value has to support
+ operator+, operator- and operator<, and increments must not be negative.
+ Then the diff of a version reaches its threshold exactly when
+ the running total reaches a fixed trigger value, which is computed
+ once when the watch is added.
+
+ ## Cost:
+
+ Pending watches are kept in a heap ordered by trigger value.
+ increment_by() compares the running total with the smallest trigger,
+ so it costs O(log n) per fired watch and O(1) otherwise.
+ Cancelled watches stay in the heap until they would fire,
+ unless they outnumber the live ones: then the heap is rebuilt
+ without them, so it holds at most twice the pending watches.
+
+ All increments of the archived<> have to pass through the registry.
+*/
+template< class Value >
+class watch_registry
+{
+ public:
+  typedef archived< Value > archive_type; /**< @brief The archive's type. */
+  typedef typename archive_type::version_type version_type;
+                                    /**< @brief The type of versions. */
+  typedef std::uint64_t watch_id; /**< @brief Identifies a watch. */
+  typedef std::function< void( watch_id , const Value & ) > callback_type;
+                                    /**< @brief Called with the watch and
+                                         the diff that reached the threshold. */
+
+ private:
+  class watch;
+
+  /**
+   @internal @brief Orders watches by descending trigger,
+   so the heap yields the smallest trigger first.
+  */
+  class later_trigger
+  {
+   public:
+    /**
+     @internal @brief Compares the triggers of two watches.
+    */
+    bool operator()
+    (
+      const watch &
+       a , /**< The first watch. */
+      const watch &
+       b /**< The second watch. */
+    ) const;
+  };
+
+  archive_type & archive_; /**< @internal @brief The incremented archive. */
+  Value total_; /**< @internal @brief Sum of the increments
+                     since the registry was created. */
+  watch_id next_id_; /**< @internal @brief The id of the next watch. */
+  std::vector< watch > pending_; /**< @internal @brief Heap of the watches
+                                      that did not fire yet. */
+  std::unordered_set< watch_id > live_; /**< @internal @brief Watches that
+                                             are neither fired nor cancelled. */
+  std::size_t cancelled_; /**< @internal @brief Cancelled watches
+                               still in pending_. */
+
+  /**
+   @internal @brief Fires all pending watches whose trigger
+   is not above the running total.
+  */
+  void fire();
+
+  /**
+   @internal @brief Rebuilds the heap from the live watches.
+  */
+  void drop_cancelled();
+
+ public:
+  /**
+   @brief Constructor that attaches to archive.
+  */
+  explicit watch_registry
+  (
+    archive_type &
+     archive /**< The archive to increment. */
+  );
+
+  watch_registry( const watch_registry & other ) = delete;
+  watch_registry & operator= ( const watch_registry & other ) = delete;
+
+  /**
+   @brief Adds a watch that fires once, when the diff_to_current()
+   of since reaches threshold.
+   If it already did, callback is called immediately.
+
+   @return The id of the watch.
+  */
+  watch_id add
+  (
+    const version_type &
+     since , /**< A valid version of the archive,
+                  taken after the registry was created. */
+    const Value &
+     threshold , /**< The diff at which the watch fires. */
+    callback_type
+     callback /**< Called when the watch fires. */
+  );
+
+  /**
+   @brief Removes a pending watch. Unknown or fired watches are ignored.
+  */
+  void cancel
+  (
+    watch_id
+     id /**< The watch to remove. */
+  );
+
+  /**
+   @brief Increments the archive by increment
+   and fires the watches that reach their threshold.
+
+   @return The version returned by the archive.
+  */
+  version_type increment_by
+  (
+    const Value &
+     increment /**< The value to increment by, not negative. */
+  );
+
+  /**
+   @brief Returns the number of pending watches.
+
+   @return The number of pending watches.
+  */
+  std::size_t pending() const;
+};
+
+/**
+ @internal @brief A pending watch.
+*/
+template< class Value >
+class watch_registry< Value >::watch
+{
+ public:
+  Value trigger_; /**< @internal @brief The running total at which
+                       the watch fires. */
+  Value base_; /**< @internal @brief The running total at the version. */
+  watch_id id_; /**< @internal @brief The id of the watch. */
+  callback_type callback_; /**< @internal @brief Called on firing. */
+};
+
+
+
+/*
+  Implementation of watch_registry<> class members
+*/
+
+template< class Value >
+ bool
+  watch_registry< Value >::later_trigger::operator()
+  (
+    const watch &
+     a ,
+    const watch &
+     b
+  ) const
+{
+  return b.trigger_ < a.trigger_;
+}
+
+template< class Value >
+  watch_registry< Value >::watch_registry
+  (
+    archive_type &
+     archive
+  )
+  : archive_( archive ) ,
+    total_() ,
+    next_id_( 0 ) ,
+    pending_() ,
+    live_() ,
+    cancelled_( 0 )
+{
+}
+
+template< class Value >
+ void
+  watch_registry< Value >::fire()
+{
+  while( ! pending_.empty() && ! ( total_ < pending_.front().trigger_ ) )
+  {
+    std::pop_heap( pending_.begin() , pending_.end() , later_trigger() );
+    watch fired = std::move( pending_.back() );
+    pending_.pop_back();
+
+    if( ! live_.erase( fired.id_ ) )
+    {
+      --cancelled_;
+      continue;
+    }
+    // Callbacks may add watches, so the queue is consistent here.
+    fired.callback_( fired.id_ , total_ - fired.base_ );
+  }
+}
+
+template< class Value >
+ typename watch_registry< Value >::watch_id
+  watch_registry< Value >::add
+  (
+    const version_type &
+     since ,
+    const Value &
+     threshold ,
+    callback_type
+     callback
+  )
+{
+  const auto id = next_id_++;
+  const Value base = total_ - diff_to_current( since );
+
+  pending_.push_back( watch{ base + threshold , base , id ,
+                             std::move( callback ) } );
+  std::push_heap( pending_.begin() , pending_.end() , later_trigger() );
+  live_.insert( id );
+  fire();
+  return id;
+}
+
+template< class Value >
+ void
+  watch_registry< Value >::cancel
+  (
+    watch_id
+     id
+  )
+{
+  if( live_.erase( id ) && ++cancelled_ > live_.size() )
+  {
+    drop_cancelled();
+  }
+}
+
+template< class Value >
+ void
+  watch_registry< Value >::drop_cancelled()
+{
+  pending_.erase( std::remove_if( pending_.begin() , pending_.end() ,
+                                  [ this ]( const watch & queued )
+                                  {
+                                    return live_.count( queued.id_ ) == 0;
+                                  } ) ,
+                  pending_.end() );
+  std::make_heap( pending_.begin() , pending_.end() , later_trigger() );
+  cancelled_ = 0;
+}
+
+template< class Value >
+ typename watch_registry< Value >::version_type
+  watch_registry< Value >::increment_by
+  (
+    const Value &
+     increment
+  )
+{
+  const auto result = archive_.increment_by( increment );
+  total_ = total_ + increment;
+  fire();
+  return result;
+}
+
+template< class Value >
+ std::size_t
+  watch_registry< Value >::pending() const
+{
+  return live_.size();
+}
+
+#endif
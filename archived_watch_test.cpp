@@ -0,0 +1,157 @@
+#include "archived_watch.h"
+
+#include <vector>
+#include <iostream>
+
+bool check_equal( long a , long b , const std::string & msg )
+{
+  std::cout << msg << ' '
+            << "First Value: " << a << ", "
+            << "Second Value: " << b << ". ";
+  if( a == b )
+  {
+    std::cout << "OK. \n";
+    return true;
+  } else {
+    std::cout << "Error. \n";
+    return false;
+  }
+}
+
+int main ( int argc , const char ** argv )
+{
+  // provide the test data
+  std::vector<int> test_data = { 3 , 4 , 7 , 9 , 4 , 5 , 7 , 94 };
+  int initial_value = 13;
+
+  archived<int> tested_archive( initial_value );
+  watch_registry<int> tested_object_1( tested_archive );
+
+  //Watches on the versions before every increment, fired ids per step
+  std::vector< archived<int>::version > version_vector;
+  std::vector< long > fired_at( 3 * test_data.size() , -1 );
+  std::vector< long > fired_diff( 3 * test_data.size() , -1 );
+  long step = 0;
+
+  auto record = [ & ]( watch_registry<int>::watch_id id , const int & diff )
+  {
+    fired_at[ id ] = step;
+    fired_diff[ id ] = diff;
+  };
+
+  std::cout << "Increment. \n";
+
+  for( ; step < static_cast< long >( test_data.size() ) ; ++step )
+  {
+    version_vector.push_back( tested_archive.current() );
+    tested_object_1.add( version_vector.back() , 10 , record );
+    tested_object_1.add( version_vector.back() , 20 , record );
+    tested_object_1.add( version_vector.back() , 1000 , record );
+    tested_object_1.increment_by( test_data[ step ] );
+  }
+
+  std::cout << "Watch Check. \n";
+
+  //Compare with polling
+  for( std::size_t v = 0 ; v < version_vector.size() ; ++v )
+  {
+    const int thresholds[] = { 10 , 20 , 1000 };
+    for( int t = 0 ; t < 3 ; ++t )
+    {
+      long control = -1;
+      long sum = 0;
+      for( std::size_t i = v ; i < test_data.size() ; ++i )
+      {
+        sum += test_data[ i ];
+        if( sum >= thresholds[ t ] )
+        {
+          control = i;
+          break;
+        }
+      }
+
+      if( !check_equal( control , fired_at[ 3 * v + t ] ,
+                        "Step at which the watch fired." ) )
+      {
+        return 1;
+      }
+      if( control >= 0 &&
+          !check_equal( sum , fired_diff[ 3 * v + t ] ,
+                        "Diff passed to the callback." ) )
+      {
+        return 1;
+      }
+    }
+  }
+
+  if( !check_equal( 8 , tested_object_1.pending() ,
+                    "Watches still pending." ) )
+  {
+    return 1;
+  }
+
+  //Watches that already reached their threshold fire immediately
+  long immediate = 0;
+  tested_object_1.add( version_vector.front() , 50 ,
+                       [ & ]( watch_registry<int>::watch_id , const int & diff )
+                       {
+                         immediate = diff;
+                       } );
+  if( !check_equal( diff_to_current( version_vector.front() ) , immediate ,
+                    "Immediate firing." ) )
+  {
+    return 1;
+  }
+
+  //Cancelled watches do not fire
+  bool cancelled_fired = false;
+  const auto id = tested_object_1.add(
+    tested_archive.current() , 1 ,
+    [ & ]( watch_registry<int>::watch_id , const int & )
+    {
+      cancelled_fired = true;
+    } );
+  tested_object_1.cancel( id );
+  tested_object_1.increment_by( 5 );
+
+  if( !check_equal( false , cancelled_fired , "Cancelled watch." ) ||
+      !check_equal( 8 , tested_object_1.pending() ,
+                    "Watches pending after cancel." ) )
+  {
+    return 1;
+  }
+
+  //Cancelling most watches keeps the others
+  std::vector< watch_registry<int>::watch_id > many;
+  long many_fired = 0;
+  for( int w = 0 ; w < 1000 ; ++w )
+  {
+    many.push_back( tested_object_1.add(
+      tested_archive.current() , 1 + w % 7 ,
+      [ & ]( watch_registry<int>::watch_id , const int & )
+      {
+        ++many_fired;
+      } ) );
+  }
+  for( int w = 0 ; w < 1000 ; ++w )
+  {
+    if( w % 10 != 0 )
+    {
+      tested_object_1.cancel( many[ w ] );
+    }
+  }
+  if( !check_equal( 8 + 100 , tested_object_1.pending() ,
+                    "Watches pending after cancelling many." ) )
+  {
+    return 1;
+  }
+  tested_object_1.increment_by( 7 );
+  if( !check_equal( 100 , many_fired , "Watches left fired." ) ||
+      !check_equal( 8 , tested_object_1.pending() ,
+                    "Watches pending after firing." ) )
+  {
+    return 1;
+  }
+
+  return 0;
+}